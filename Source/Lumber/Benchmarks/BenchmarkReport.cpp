@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BenchmarkReport.h"
+#include "HAL/MemoryBase.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include <atomic>
+
+FBenchmarkCase& FBenchmarkReport::AddCase(const FString& CaseName) {
+	FBenchmarkCase& NewCase = Cases.AddDefaulted_GetRef();
+	NewCase.Name = CaseName;
+	return NewCase;
+}
+
+void FBenchmarkReport::Log() const {
+	for (const FBenchmarkCase& Case : Cases) {
+		UE_LOG(LogTemp, Display, TEXT("%s"), *Case.Name);
+		for (const FBenchmarkMetric& Metric : Case.Metrics) {
+			UE_LOG(LogTemp, Display, TEXT("    %-24s %14.3f"), *Metric.Name, Metric.Value);
+		}
+	}
+}
+
+bool FBenchmarkReport::SaveBaseline(const FString& FilePath) const {
+	TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject());
+
+	// Where and when the baseline was recorded, compared runs on other machines can't be expected to match it
+	TSharedPtr<FJsonObject> MetaObject = MakeShareable(new FJsonObject());
+	MetaObject->SetStringField(TEXT("CPU"), FPlatformMisc::GetCPUBrand().TrimStartAndEnd());
+	MetaObject->SetStringField(TEXT("Recorded"), FDateTime::UtcNow().ToIso8601());
+	JsonObject->SetObjectField(TEXT("_Meta"), MetaObject);
+	for (const FBenchmarkCase& Case : Cases) {
+		TSharedPtr<FJsonObject> CaseObject = MakeShareable(new FJsonObject());
+		for (const FBenchmarkMetric& Metric : Case.Metrics) {
+			CaseObject->SetNumberField(Metric.Name, Metric.Value);
+		}
+		JsonObject->SetObjectField(Case.Name, CaseObject);
+	}
+
+	FString JsonString;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonString);
+	return FJsonSerializer::Serialize(JsonObject.ToSharedRef(), Writer) && FFileHelper::SaveStringToFile(JsonString, *FilePath);
+}
+
+int32 FBenchmarkReport::CompareToBaseline(const FString& FilePath, double Tolerance) const {
+	FString JsonString;
+	if (!FFileHelper::LoadFileToString(JsonString, *FilePath)) {
+		UE_LOG(LogTemp, Error, TEXT("REGRESSION: no benchmark baseline at %s, run with -WriteBaseline on the reference machine and check it in"), *FilePath);
+		return 1;
+	}
+
+	TSharedPtr<FJsonObject> Baseline;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
+	if (!FJsonSerializer::Deserialize(Reader, Baseline) || !Baseline.IsValid()) {
+		UE_LOG(LogTemp, Error, TEXT("REGRESSION: benchmark baseline %s couldn't be read"), *FilePath);
+		return 1;
+	}
+
+	int32 NumRegressions = 0;
+	for (const FBenchmarkCase& Case : Cases) {
+		const TSharedPtr<FJsonObject>* BaselineCase = nullptr;
+		Baseline->TryGetObjectField(Case.Name, BaselineCase);
+
+		for (const FBenchmarkMetric& Metric : Case.Metrics) {
+			// A metric without a baseline would otherwise never be checked, so it fails until the baseline is recorded
+			double BaselineValue = 0;
+			if (BaselineCase == nullptr || !(*BaselineCase)->TryGetNumberField(Metric.Name, BaselineValue)) {
+				UE_LOG(LogTemp, Error, TEXT("REGRESSION: %s %s has no baseline in %s, record it with -WriteBaseline on the reference machine"), *Case.Name, *Metric.Name, *FilePath);
+				NumRegressions++;
+				continue;
+			}
+
+			// A baseline of 0 would make any relative tolerance flag every positive value
+			const double AllowedChange = FMath::Max(FMath::Abs(BaselineValue) * Tolerance, Metric.AbsoluteThreshold);
+			const bool bRegressed = Metric.bHigherIsBetter
+				? Metric.Value < BaselineValue - AllowedChange
+				: Metric.Value > BaselineValue + AllowedChange;
+			const double Change = BaselineValue != 0 ? (Metric.Value - BaselineValue) / BaselineValue * 100.0 : 0;
+
+			if (bRegressed) {
+				UE_LOG(LogTemp, Error, TEXT("REGRESSION: %s %s is %.3f, baseline %.3f (%+.1f%%, allowed %.3f)"),
+					*Case.Name, *Metric.Name, Metric.Value, BaselineValue, Change, AllowedChange);
+				NumRegressions++;
+			}
+			else {
+				UE_LOG(LogTemp, Display, TEXT("%s %s %.3f, baseline %.3f (%+.1f%%)"), *Case.Name, *Metric.Name, Metric.Value, BaselineValue, Change);
+			}
+		}
+	}
+
+	return NumRegressions;
+}
+
+FBenchmarkReport FBenchmarkReport::GetMedian(const TArray<FBenchmarkReport>& Runs) {
+	if (Runs.Num() == 0) { return FBenchmarkReport(); }
+
+	FBenchmarkReport Median = Runs[0];
+	for (int32 CaseIndex = 0; CaseIndex < Median.Cases.Num(); CaseIndex++) {
+		for (int32 MetricIndex = 0; MetricIndex < Median.Cases[CaseIndex].Metrics.Num(); MetricIndex++) {
+			TArray<double> Values;
+			for (const FBenchmarkReport& Run : Runs) {
+				check(Run.Cases.IsValidIndex(CaseIndex) && Run.Cases[CaseIndex].Metrics.IsValidIndex(MetricIndex));
+				Values.Add(Run.Cases[CaseIndex].Metrics[MetricIndex].Value);
+			}
+			Values.Sort();
+
+			// Even counts take the mean of the middle two
+			const int32 Middle = Values.Num() / 2;
+			Median.Cases[CaseIndex].Metrics[MetricIndex].Value = Values.Num() % 2 == 1 ? Values[Middle] : (Values[Middle - 1] + Values[Middle]) / 2;
+		}
+	}
+	return Median;
+}
+
+/*
+	Forwards everything to the allocator it wraps, counting every new block
+*/
+class FCountingMalloc final : public FMalloc {
+public:
+	explicit FCountingMalloc(FMalloc* InInnerMalloc)
+		: InnerMalloc(InInnerMalloc)
+	{
+	}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+	{
+		NumAllocations.fetch_add(1, std::memory_order_relaxed);
+		return InnerMalloc->Malloc(Count, Alignment);
+	}
+
+	virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+	{
+		NumAllocations.fetch_add(1, std::memory_order_relaxed);
+		return InnerMalloc->TryMalloc(Count, Alignment);
+	}
+
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		if (Original == nullptr) {
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		return InnerMalloc->Realloc(Original, Count, Alignment);
+	}
+
+	virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+	{
+		if (Original == nullptr) {
+			NumAllocations.fetch_add(1, std::memory_order_relaxed);
+		}
+		return InnerMalloc->TryRealloc(Original, Count, Alignment);
+	}
+
+	virtual void Free(void* Original) override { InnerMalloc->Free(Original); }
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return InnerMalloc->QuantizeSize(Count, Alignment); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return InnerMalloc->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim(bool bTrimThreadCaches) override { InnerMalloc->Trim(bTrimThreadCaches); }
+	virtual void SetupTLSCachesOnCurrentThread() override { InnerMalloc->SetupTLSCachesOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread() override { InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual void InitializeStatsMetadata() override { InnerMalloc->InitializeStatsMetadata(); }
+	virtual void UpdateStats() override { InnerMalloc->UpdateStats(); }
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { InnerMalloc->GetAllocatorStats(OutStats); }
+	virtual void DumpAllocatorStats(FOutputDevice& Ar) override { InnerMalloc->DumpAllocatorStats(Ar); }
+	virtual bool IsInternallyThreadSafe() const override { return InnerMalloc->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap() override { return InnerMalloc->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptiveName() override { return InnerMalloc->GetDescriptiveName(); }
+
+	std::atomic<uint64> NumAllocations = 0;
+
+private:
+	FMalloc* InnerMalloc;
+};
+
+static FCountingMalloc* CountingMalloc = nullptr;
+
+void FBenchmarkAllocationCounter::Install() {
+	check(IsInGameThread());
+	if (CountingMalloc != nullptr) { return; }
+
+	// Blocks allocated before this still free correctly, as every call is forwarded to the original allocator
+	CountingMalloc = new FCountingMalloc(GMalloc);
+	GMalloc = CountingMalloc;
+}
+
+uint64 FBenchmarkAllocationCounter::GetNumAllocations() {
+	return CountingMalloc != nullptr ? CountingMalloc->NumAllocations.load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/*
+	A measured value of a benchmark case, regressions are judged by whether higher values are better
+*/
+struct FBenchmarkMetric {
+	FString Name;
+	double Value = 0;
+	bool bHigherIsBetter = false;
+
+	// Changes smaller than this are never regressions, for metrics near zero where any relative tolerance is too tight
+	double AbsoluteThreshold = 0;
+};
+
+struct FBenchmarkCase {
+	FString Name;
+	TArray<FBenchmarkMetric> Metrics;
+
+	void AddMetric(const FString& MetricName, double Value, bool bHigherIsBetter = false, double AbsoluteThreshold = 0) { Metrics.Add({ MetricName, Value, bHigherIsBetter, AbsoluteThreshold }); }
+};
+
+/*
+	Results of a benchmark commandlet, which can be saved as a baseline and compared against one.
+	Baselines are JSON files of case name to metric name to value, meant to be checked in next to the benchmark
+*/
+class LUMBER_API FBenchmarkReport {
+public:
+	FBenchmarkCase& AddCase(const FString& CaseName);
+
+	void Log() const;
+
+	bool SaveBaseline(const FString& FilePath) const;
+
+	/*
+		Logs an error for every metric that is worse than the baseline by more than the tolerance (0.1 for 10%) and its
+		absolute threshold, returns the number of regressions. A missing or unreadable baseline, and every metric missing
+		from the baseline, counts as a regression
+	*/
+	int32 CompareToBaseline(const FString& FilePath, double Tolerance) const;
+
+	/*
+		Report of the median of every metric over several runs of the same benchmark, which have to add the same cases
+		and metrics in the same order
+	*/
+	static FBenchmarkReport GetMedian(const TArray<FBenchmarkReport>& Runs);
+
+private:
+	TArray<FBenchmarkCase> Cases;
+};
+
+/*
+	Counts heap allocations made on any thread, by putting a forwarding allocator in front of GMalloc.
+	Once installed it stays installed for the rest of the process, so only use it from commandlets
+*/
+class LUMBER_API FBenchmarkAllocationCounter {
+public:
+	static void Install();
+
+	static uint64 GetNumAllocations();
+};
@@ -0,0 +1,313 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ObserverReplay.h"
+#include "EngineUtils.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "../LumberGameMode.h"
+#include "../Loaders/ChunkLoader.h"
+#include "../Loaders/TerrainLoader.h"
+#include "../Loaders/JobSystem.h"
+
+AObserverReplay::AObserverReplay()
+{
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void AObserverReplay::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	switch (Mode)
+	{
+	case EObserverReplayMode::Recording:
+		ElapsedTime += DeltaTime;
+		TickRecording();
+		break;
+	case EObserverReplayMode::Playback:
+		ElapsedTime += DeltaTime;
+		TickPlayback(DeltaTime);
+		break;
+	default:
+		break;
+	}
+}
+
+void AObserverReplay::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Keep a recording that was still going when play ended
+	if (Mode == EObserverReplayMode::Recording) {
+		StopRecording();
+	}
+	if (Mode == EObserverReplayMode::Playback) {
+		FApp::SetUseFixedTimeStep(false);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+APawn* AObserverReplay::GetObserver() const {
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	return PlayerController != nullptr ? PlayerController->GetPawn() : nullptr;
+}
+
+void AObserverReplay::StartRecording(const FString& InFilePath) {
+	FilePath = InFilePath;
+	Samples.Reset();
+	ElapsedTime = 0;
+	NextRecordTime = 0;
+	Mode = EObserverReplayMode::Recording;
+
+	UE_LOG(LogTemp, Log, TEXT("Recording observer path to %s"), *FilePath);
+}
+
+bool AObserverReplay::StopRecording() {
+	if (Mode != EObserverReplayMode::Recording) { return false; }
+	Mode = EObserverReplayMode::Idle;
+
+	if (!SaveRecording()) {
+		UE_LOG(LogTemp, Error, TEXT("Failed to save observer path to %s"), *FilePath);
+		return false;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Saved %d observer samples (%.1f seconds) to %s"), Samples.Num(), ElapsedTime, *FilePath);
+	return true;
+}
+
+void AObserverReplay::TickRecording() {
+	if (ElapsedTime < NextRecordTime) { return; }
+	NextRecordTime = ElapsedTime + RecordInterval;
+
+	APawn* Observer = GetObserver();
+	if (Observer == nullptr) { return; }
+
+	FObserverSample NewSample;
+	NewSample.Time = ElapsedTime;
+	NewSample.Location = Observer->GetActorLocation();
+	NewSample.Rotation = Observer->GetControlRotation();
+	Samples.Add(NewSample);
+}
+
+/*
+Loads a recording, reseeds generation and fixes the time step, then takes control of the observer
+*/
+bool AObserverReplay::StartPlayback(const FString& InFilePath) {
+	FilePath = InFilePath;
+	if (!LoadRecording() || Samples.Num() == 0) {
+		UE_LOG(LogTemp, Error, TEXT("Failed to load observer path from %s"), *FilePath);
+		return false;
+	}
+
+	ALumberGameMode* LumberGameMode = GetWorld()->GetAuthGameMode<ALumberGameMode>();
+	if (LumberGameMode == nullptr) { return false; }
+
+	// Same terrain and trees every run
+	FMath::RandInit(Seed);
+	FMath::SRandInit(Seed);
+	LumberGameMode->GetTerrainLoader()->SetSeed(Seed);
+
+	// Same sequence of observer positions every run, regardless of how long frames actually take
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(1.0 / PlaybackFrameRate);
+
+	APawn* Observer = GetObserver();
+	if (Observer != nullptr) {
+		Observer->DisableInput(Cast<APlayerController>(Observer->GetController()));
+		if (ACharacter* Character = Cast<ACharacter>(Observer)) {
+			Character->GetCharacterMovement()->DisableMovement();
+		}
+	}
+
+	LumberGameMode->GetChunkLoader()->GetLifecycleTracer().Reset();
+	StartNumChunksLoaded = LumberGameMode->GetChunkLoader()->NumChunksLoaded;
+	StartNumHitches = LumberGameMode->GetHitchDetector().GetNumHitches();
+	PeakUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+
+	ElapsedTime = 0;
+	PlaybackCursor = 0;
+	Mode = EObserverReplayMode::Playback;
+
+	UE_LOG(LogTemp, Log, TEXT("Playing back %d observer samples (%.1f seconds) from %s with seed %d"), Samples.Num(), Samples.Last().Time, *FilePath, Seed);
+	return true;
+}
+
+void AObserverReplay::TickPlayback(float DeltaTime) {
+	PeakUsedPhysical = FMath::Max<uint64>(PeakUsedPhysical, FPlatformMemory::GetStats().UsedPhysical);
+
+	if (ElapsedTime > Samples.Last().Time + SettleSeconds) {
+		FinishPlayback();
+		return;
+	}
+
+	APawn* Observer = GetObserver();
+	if (Observer == nullptr) { return; }
+
+	const FObserverSample Sample = GetPlaybackSample(ElapsedTime);
+	Observer->SetActorLocationAndRotation(Sample.Location, FRotator(0, Sample.Rotation.Yaw, 0), false, nullptr, ETeleportType::TeleportPhysics);
+	if (AController* Controller = Observer->GetController()) {
+		Controller->SetControlRotation(Sample.Rotation);
+	}
+}
+
+/*
+Interpolates between the recorded samples either side of a time, holding the last sample once the recording has ended
+*/
+FObserverSample AObserverReplay::GetPlaybackSample(float Time) {
+	while (PlaybackCursor < Samples.Num() - 1 && Samples[PlaybackCursor + 1].Time <= Time) {
+		PlaybackCursor++;
+	}
+	if (PlaybackCursor == Samples.Num() - 1) {
+		return Samples.Last();
+	}
+
+	const FObserverSample& From = Samples[PlaybackCursor];
+	const FObserverSample& To = Samples[PlaybackCursor + 1];
+	const float Alpha = FMath::Clamp((Time - From.Time) / FMath::Max(To.Time - From.Time, KINDA_SMALL_NUMBER), 0.0f, 1.0f);
+
+	FObserverSample Sample;
+	Sample.Time = Time;
+	Sample.Location = FMath::Lerp(From.Location, To.Location, Alpha);
+	Sample.Rotation = FQuat::Slerp(From.Rotation.Quaternion(), To.Rotation.Quaternion(), Alpha).Rotator();
+	return Sample;
+}
+
+/*
+Writes the report of a finished playback, gives the observer back to the player and quits if asked to
+*/
+void AObserverReplay::FinishPlayback() {
+	Mode = EObserverReplayMode::Idle;
+	FApp::SetUseFixedTimeStep(false);
+
+	ALumberGameMode* LumberGameMode = GetWorld()->GetAuthGameMode<ALumberGameMode>();
+	const FChunkLifecycleTracer& LifecycleTracer = LumberGameMode->GetChunkLoader()->GetLifecycleTracer();
+
+	TArray<double> UploadLatencies;
+	TArray<double> CollisionLatencies;
+	LifecycleTracer.GetSortedLatencies(EChunkLifecycleEvent::SectionApplied, UploadLatencies);
+	LifecycleTracer.GetSortedLatencies(EChunkLifecycleEvent::CollisionCooked, CollisionLatencies);
+
+	TSharedPtr<FJsonObject> Report = MakeShareable(new FJsonObject());
+	Report->SetStringField("Recording", FilePath);
+	Report->SetNumberField("Seed", Seed);
+	Report->SetNumberField("Seconds", ElapsedTime);
+	Report->SetNumberField("ChunksLoaded", LumberGameMode->GetChunkLoader()->NumChunksLoaded - StartNumChunksLoaded);
+	Report->SetNumberField("Hitches", LumberGameMode->GetHitchDetector().GetNumHitches() - StartNumHitches);
+	Report->SetNumberField("UploadLatencyP50Ms", GetSortedPercentile(UploadLatencies, 50));
+	Report->SetNumberField("UploadLatencyP95Ms", GetSortedPercentile(UploadLatencies, 95));
+	Report->SetNumberField("UploadLatencyP99Ms", GetSortedPercentile(UploadLatencies, 99));
+	Report->SetNumberField("CollisionLatencyP50Ms", GetSortedPercentile(CollisionLatencies, 50));
+	Report->SetNumberField("CollisionLatencyP95Ms", GetSortedPercentile(CollisionLatencies, 95));
+	Report->SetNumberField("CollisionLatencyP99Ms", GetSortedPercentile(CollisionLatencies, 99));
+	Report->SetNumberField("PeakUsedPhysicalMB", PeakUsedPhysical / (1024.0 * 1024.0));
+
+	FString ReportString;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&ReportString);
+	FJsonSerializer::Serialize(Report.ToSharedRef(), Writer);
+
+	const FString ReportPath = FPaths::ProfilingDir() / FString::Printf(TEXT("LumberReplay-%s-%s.json"), *FPaths::GetBaseFilename(FilePath), *FDateTime::Now().ToString());
+	FFileHelper::SaveStringToFile(ReportString, *ReportPath);
+	UE_LOG(LogTemp, Log, TEXT("Replay finished, report written to %s\n%s"), *ReportPath, *ReportString);
+
+	APawn* Observer = GetObserver();
+	if (Observer != nullptr) {
+		Observer->EnableInput(Cast<APlayerController>(Observer->GetController()));
+		if (ACharacter* Character = Cast<ACharacter>(Observer)) {
+			Character->GetCharacterMovement()->SetDefaultMovementMode();
+		}
+	}
+
+	if (bExitWhenFinished) {
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+bool AObserverReplay::SaveRecording() const {
+	TArray<TSharedPtr<FJsonValue>> SampleValues;
+	for (const FObserverSample& Sample : Samples) {
+		TSharedPtr<FJsonObject> SampleObject = MakeShareable(new FJsonObject());
+		SampleObject->SetNumberField("T", Sample.Time);
+		SampleObject->SetNumberField("X", Sample.Location.X);
+		SampleObject->SetNumberField("Y", Sample.Location.Y);
+		SampleObject->SetNumberField("Z", Sample.Location.Z);
+		SampleObject->SetNumberField("Pitch", Sample.Rotation.Pitch);
+		SampleObject->SetNumberField("Yaw", Sample.Rotation.Yaw);
+		SampleValues.Add(MakeShareable(new FJsonValueObject(SampleObject)));
+	}
+
+	TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject());
+	JsonObject->SetNumberField("Seed", Seed);
+	JsonObject->SetArrayField("Samples", SampleValues);
+
+	FString JsonString;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonString);
+	return FJsonSerializer::Serialize(JsonObject.ToSharedRef(), Writer) && FFileHelper::SaveStringToFile(JsonString, *FilePath);
+}
+
+bool AObserverReplay::LoadRecording() {
+	FString JsonString;
+	if (!FFileHelper::LoadFileToString(JsonString, *FilePath)) { return false; }
+
+	TSharedPtr<FJsonObject> JsonObject;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
+	if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid()) { return false; }
+
+	// Recordings keep the seed they were made with, so the terrain matches what the path was driven over
+	JsonObject->TryGetNumberField(TEXT("Seed"), Seed);
+
+	Samples.Reset();
+	for (const TSharedPtr<FJsonValue>& SampleValue : JsonObject->GetArrayField(TEXT("Samples"))) {
+		const TSharedPtr<FJsonObject> SampleObject = SampleValue.IsValid() ? SampleValue->AsObject() : nullptr;
+		if (!SampleObject.IsValid()) { return false; }
+
+		FObserverSample NewSample;
+		NewSample.Time = SampleObject->GetNumberField(TEXT("T"));
+		NewSample.Location = FVector(SampleObject->GetNumberField(TEXT("X")), SampleObject->GetNumberField(TEXT("Y")), SampleObject->GetNumberField(TEXT("Z")));
+		NewSample.Rotation = FRotator(SampleObject->GetNumberField(TEXT("Pitch")), SampleObject->GetNumberField(TEXT("Yaw")), 0);
+		Samples.Add(NewSample);
+	}
+	return true;
+}
+
+AObserverReplay* AObserverReplay::FindOrSpawn(UWorld* World) {
+	for (TActorIterator<AObserverReplay> It(World); It; ++It) {
+		return *It;
+	}
+	return World->SpawnActor<AObserverReplay>();
+}
+
+static FAutoConsoleCommandWithWorldAndArgs ReplayRecordCommand(
+	TEXT("Lumber.Replay.Record"),
+	TEXT("Starts recording the observer's path. Optional argument: file path, defaults to the profiling directory"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		if (World == nullptr) { return; }
+
+		const FString FilePath = Args.Num() > 0 ? Args[0] : FPaths::ProfilingDir() / FString::Printf(TEXT("LumberPath-%s.json"), *FDateTime::Now().ToString());
+		AObserverReplay::FindOrSpawn(World)->StartRecording(FilePath);
+	})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs ReplayStopCommand(
+	TEXT("Lumber.Replay.Stop"),
+	TEXT("Stops recording the observer's path and saves it"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		if (World == nullptr) { return; }
+		AObserverReplay::FindOrSpawn(World)->StopRecording();
+	})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs ReplayPlayCommand(
+	TEXT("Lumber.Replay.Play"),
+	TEXT("Plays back a recorded observer path and writes a streaming report when it finishes. Argument: file path"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		if (World == nullptr || Args.Num() == 0) { return; }
+		AObserverReplay::FindOrSpawn(World)->StartPlayback(Args[0]);
+	})
+);
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ObserverReplay.generated.h"
+
+class ALumberGameMode;
+
+/*
+	Transform of the observer at a point in a recording, in seconds from the start
+*/
+struct FObserverSample {
+	float Time = 0;
+	FVector Location = FVector::ZeroVector;
+	FRotator Rotation = FRotator::ZeroRotator;
+};
+
+UENUM()
+enum class EObserverReplayMode : uint8 {
+	Idle,
+	Recording,
+	Playback
+};
+
+/*
+	Records the observer's path through the world, and plays a recording back as a streaming benchmark.
+	Playback reseeds generation, fixes the time step and moves the observer along the recording, then writes
+	chunks loaded, hitches, upload latency and peak memory to a JSON report, so builds can be compared on the same path.
+
+	Record:   Lumber.Replay.Record [file], then Lumber.Replay.Stop
+	Playback: Lumber -game -nullrhi -LumberReplay=<file> [-LumberReplayExit]
+*/
+UCLASS()
+class LUMBER_API AObserverReplay : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AObserverReplay();
+
+	// Seconds between recorded samples
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float RecordInterval = 0.1f;
+
+	// Fixed frame rate playback is stepped at, so every run sees the same sequence of observer positions
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float PlaybackFrameRate = 30.0f;
+
+	// Seconds to keep running after the end of the recording, so loads that were requested along the path finish
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float SettleSeconds = 5.0f;
+
+	// Quit once playback has written its report
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bExitWhenFinished = false;
+
+	// Seed recordings are saved with and played back at
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int32 Seed = 1337;
+
+public:
+	virtual void Tick(float DeltaTime) override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	void StartRecording(const FString& InFilePath);
+
+	/*
+		Stops recording and saves the recording, returns false if it couldn't be saved
+	*/
+	bool StopRecording();
+
+	/*
+		Loads a recording and starts moving the observer along it, returns false if the recording couldn't be loaded
+	*/
+	bool StartPlayback(const FString& InFilePath);
+
+	EObserverReplayMode GetMode() const { return Mode; }
+
+	/*
+		Returns the replay actor of a world, spawning one if it doesn't have one yet
+	*/
+	static AObserverReplay* FindOrSpawn(UWorld* World);
+
+private:
+	APawn* GetObserver() const;
+
+	void TickRecording();
+
+	void TickPlayback(float DeltaTime);
+
+	void FinishPlayback();
+
+	FObserverSample GetPlaybackSample(float Time);
+
+	bool SaveRecording() const;
+
+	bool LoadRecording();
+
+private:
+	EObserverReplayMode Mode = EObserverReplayMode::Idle;
+
+	FString FilePath;
+
+	TArray<FObserverSample> Samples;
+
+	// Time since recording or playback started, in seconds
+	float ElapsedTime = 0;
+
+	float NextRecordTime = 0;
+
+	// Index of the sample playback is interpolating from
+	int32 PlaybackCursor = 0;
+
+	uint64 PeakUsedPhysical = 0;
+
+	int32 StartNumChunksLoaded = 0;
+
+	int32 StartNumHitches = 0;
+};
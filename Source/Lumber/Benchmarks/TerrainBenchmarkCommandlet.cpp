@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainBenchmarkCommandlet.h"
+#include "BenchmarkReport.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/Paths.h"
+#include "../LumberGameMode.h"
+#include "../Loaders/ChunkLoader.h"
+#include "../Loaders/TerrainLoader.h"
+
+UTerrainBenchmarkCommandlet::UTerrainBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+static const TCHAR* GetQualityName(EChunkQuality Quality) {
+	switch (Quality) {
+	case EChunkQuality::Low: return TEXT("Low");
+	case EChunkQuality::Medium: return TEXT("Medium");
+	case EChunkQuality::High: return TEXT("High");
+	case EChunkQuality::Collision: return TEXT("Collision");
+	default: return TEXT("Unknown");
+	}
+}
+
+/*
+	Generates and uploads every chunk of the grid at every quality once
+*/
+static FBenchmarkReport RunTerrainBenchmark(ALumberGameMode* Gamemode, int32 GridSize) {
+	ATerrainLoader* TerrainLoader = Gamemode->GetTerrainLoader();
+	AChunkLoader* ChunkLoader = Gamemode->GetChunkLoader();
+
+	FBenchmarkReport Report;
+	const EChunkQuality Qualities[] = { EChunkQuality::Low, EChunkQuality::Medium, EChunkQuality::High, EChunkQuality::Collision };
+
+	for (EChunkQuality Quality : Qualities) {
+		const uint64 StartUsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+		uint64 PeakUsedPhysical = StartUsedPhysical;
+		const uint64 StartAllocations = FBenchmarkAllocationCounter::GetNumAllocations();
+		int64 NumVertices = 0;
+		double GenerateSeconds = 0;
+		double UploadSeconds = 0;
+
+		for (int32 X = 0; X < GridSize; X++)
+		{
+			for (int32 Y = 0; Y < GridSize; Y++)
+			{
+				const FVector2D ChunkCoord = FVector2D(X, Y) * ChunkLoader->totalChunkSize;
+
+				double StartTime = FPlatformTime::Seconds();
+				FMeshData MeshData;
+				TerrainLoader->GetChunkRenderData(&MeshData, ChunkCoord, Quality);
+				TerrainLoader->CreateMeshSection(TerrainLoader->CollisionMesh, 0, MeshData.Vertices, MeshData.Triangles, MeshData.Normals, MeshData.UVs, MeshData.Colors, MeshData.Tangents, Quality == EChunkQuality::Collision);
+				GenerateSeconds += FPlatformTime::Seconds() - StartTime;
+
+				// Apply the queued section so setting it is part of the cost, then clear it to keep memory to one chunk
+				StartTime = FPlatformTime::Seconds();
+				Gamemode->GetGameThreadWork().Tick(TNumericLimits<float>::Max());
+				UploadSeconds += FPlatformTime::Seconds() - StartTime;
+
+				NumVertices += MeshData.Vertices.Num();
+				PeakUsedPhysical = FMath::Max<uint64>(PeakUsedPhysical, FPlatformMemory::GetStats().UsedPhysical);
+				TerrainLoader->CollisionMesh->ClearMeshSection(0);
+			}
+		}
+
+		const int32 NumChunks = GridSize * GridSize;
+		const double TotalSeconds = GenerateSeconds + UploadSeconds;
+
+		// Low quality chunks take hundredths of a millisecond and memory settles near zero after the warmup,
+		// so those metrics also get an absolute allowance
+		FBenchmarkCase& Case = Report.AddCase(GetQualityName(Quality));
+		Case.AddMetric(TEXT("MsPerChunk"), TotalSeconds * 1000.0 / NumChunks, false, 0.02);
+		Case.AddMetric(TEXT("GenerateMsPerChunk"), GenerateSeconds * 1000.0 / NumChunks, false, 0.02);
+		Case.AddMetric(TEXT("UploadMsPerChunk"), UploadSeconds * 1000.0 / NumChunks, false, 0.02);
+		Case.AddMetric(TEXT("VerticesPerSecond"), TotalSeconds > 0 ? NumVertices / TotalSeconds : 0, true);
+		Case.AddMetric(TEXT("AllocationsPerChunk"), double(FBenchmarkAllocationCounter::GetNumAllocations() - StartAllocations) / NumChunks, false, 4);
+		Case.AddMetric(TEXT("PeakMemoryMB"), (PeakUsedPhysical - StartUsedPhysical) / (1024.0 * 1024.0), false, 8);
+	}
+
+	return Report;
+}
+
+int32 UTerrainBenchmarkCommandlet::Main(const FString& Params) {
+	int32 GridSize = 8;
+	int32 Seed = 1337;
+	int32 NumWarmupRuns = 1;
+	int32 NumRuns = 5;
+	double Tolerance = 0.1;
+	FString BaselinePath = FPaths::ProjectDir() / TEXT("Benchmarks/TerrainBenchmarkBaseline.json");
+	FString GameModeClassPath;
+	FParse::Value(*Params, TEXT("Grid="), GridSize);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Warmup="), NumWarmupRuns);
+	FParse::Value(*Params, TEXT("Runs="), NumRuns);
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+	FParse::Value(*Params, TEXT("Baseline="), BaselinePath);
+	const bool bWriteBaseline = FParse::Param(*Params, TEXT("WriteBaseline"));
+	NumRuns = FMath::Max(NumRuns, 1);
+
+	// The blueprint game mode holds the terrain loader class, world settings and material the game runs with
+	if (!FParse::Value(*Params, TEXT("GameMode="), GameModeClassPath)) {
+		GConfig->GetString(TEXT("/Script/EngineSettings.GameMapsSettings"), TEXT("GlobalDefaultGameMode"), GameModeClassPath, GEngineIni);
+	}
+	UClass* GameModeClass = LoadClass<ALumberGameMode>(nullptr, *GameModeClassPath);
+	if (GameModeClass == nullptr) {
+		UE_LOG(LogTemp, Error, TEXT("Couldn't load game mode class %s"), *GameModeClassPath);
+		return 1;
+	}
+
+	FBenchmarkAllocationCounter::Install();
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	// Loaders are created without BeginPlay, so nothing streams around a player and no worker threads start
+	ALumberGameMode* Gamemode = World->SpawnActor<ALumberGameMode>(GameModeClass);
+	Gamemode->CreateLoaders();
+	Gamemode->GetTerrainLoader()->SetSeed(Seed);
+
+	// Warmup runs fill caches and the allocator's pools, then the median of the measured runs is reported
+	for (int32 Run = 0; Run < NumWarmupRuns; Run++) {
+		RunTerrainBenchmark(Gamemode, GridSize);
+	}
+	TArray<FBenchmarkReport> Runs;
+	for (int32 Run = 0; Run < NumRuns; Run++) {
+		Runs.Add(RunTerrainBenchmark(Gamemode, GridSize));
+	}
+	const FBenchmarkReport Report = FBenchmarkReport::GetMedian(Runs);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	UE_LOG(LogTemp, Display, TEXT("Terrain benchmark, %dx%d chunks per quality, seed %d, median of %d runs after %d warmup"), GridSize, GridSize, Seed, NumRuns, NumWarmupRuns);
+	Report.Log();
+
+	if (bWriteBaseline) {
+		if (!Report.SaveBaseline(BaselinePath)) {
+			UE_LOG(LogTemp, Error, TEXT("Couldn't write terrain benchmark baseline to %s"), *BaselinePath);
+			return 1;
+		}
+		UE_LOG(LogTemp, Display, TEXT("Wrote terrain benchmark baseline to %s"), *BaselinePath);
+		return 0;
+	}
+
+	const int32 NumRegressions = Report.CompareToBaseline(BaselinePath, Tolerance);
+	if (NumRegressions > 0) {
+		UE_LOG(LogTemp, Error, TEXT("Terrain benchmark FAILED with %d regressions against %s"), NumRegressions, *BaselinePath);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TerrainBenchmarkCommandlet.generated.h"
+
+/*
+	Generates a grid of chunks at every chunk quality without a viewport, through the same GetChunkRenderData and
+	CreateMeshSection path the chunk loader uses, and reports ms/chunk, vertices/s, allocations and peak memory.
+	The grid is run after warmup runs several times and the median of each metric is compared against the checked-in
+	Benchmarks/TerrainBenchmarkBaseline.json, any metric worse than the tolerance fails the run.
+
+	UnrealEditor-Cmd Lumber.uproject -run=TerrainBenchmark [-Grid=8] [-Seed=1337] [-Warmup=1] [-Runs=5] [-Tolerance=0.1] [-Baseline=<file>] [-WriteBaseline] [-GameMode=<class>]
+*/
+UCLASS()
+class LUMBER_API UTerrainBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UTerrainBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
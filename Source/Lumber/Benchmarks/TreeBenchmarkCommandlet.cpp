@@ -0,0 +1,240 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TreeBenchmarkCommandlet.h"
+#include "BenchmarkReport.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/UObjectGlobals.h"
+#include "../TreeClasses/Tree.h"
+#include "../TreeClasses/TreeRoot.h"
+#include "../TreeClasses/LogData.h"
+
+UTreeBenchmarkCommandlet::UTreeBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+/*
+	Sets one property of the tree data from its exported text, properties holding a whole FData are imported as a whole
+*/
+static bool ImportPresetProperty(const FString& Name, const FString& Value, FData& OutData) {
+	if (Name == TEXT("ThisLogData") || Name == TEXT("InitialTreeData")) {
+		return FData::StaticStruct()->ImportText(*Value, &OutData, nullptr, PPF_None, GLog, TEXT("FData")) != nullptr;
+	}
+
+	const FProperty* Property = FData::StaticStruct()->FindPropertyByName(FName(*Name));
+	if (Property == nullptr || Property->IsA<FObjectPropertyBase>()) { return false; }
+
+	return Property->ImportText_InContainer(*Value, &OutData, nullptr, PPF_None) != nullptr;
+}
+
+bool UTreeBenchmarkCommandlet::LoadPreset(const FString& FilePath, FData& OutData) {
+	FString JsonString;
+	if (!FFileHelper::LoadFileToString(JsonString, *FilePath)) { return false; }
+
+	TSharedPtr<FJsonObject> JsonObject;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
+	if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid()) { return false; }
+
+	int32 NumImported = 0;
+	const TArray<TSharedPtr<FJsonValue>>* TaggedValues = nullptr;
+	if (JsonObject->TryGetArrayField(TEXT("Tagged"), TaggedValues)) {
+		for (const TSharedPtr<FJsonValue>& TaggedValue : *TaggedValues) {
+			const TArray<TSharedPtr<FJsonValue>>& Pair = TaggedValue->AsArray();
+			if (Pair.Num() == 2 && ImportPresetProperty(Pair[0]->AsString(), Pair[1]->AsString(), OutData)) {
+				NumImported++;
+			}
+		}
+	}
+	else {
+		for (const TPair<FString, TSharedPtr<FJsonValue>>& Field : JsonObject->Values) {
+			if (ImportPresetProperty(Field.Key, Field.Value->AsString(), OutData)) {
+				NumImported++;
+			}
+		}
+	}
+
+	return NumImported > 0;
+}
+
+/*
+	Time, allocations and output size of one stage, summed over every tree of a preset
+*/
+struct FTreeStageStats {
+	double Seconds = 0;
+	uint64 NumAllocations = 0;
+	int64 NumVertices = 0;
+	int64 NumTriangles = 0;
+
+	void AddMesh(const FProcMeshInfo& MeshInfo) {
+		NumVertices += MeshInfo.Vertices.Num();
+		NumTriangles += MeshInfo.Triangles.Num() / 3;
+	}
+
+	void AddToCase(FBenchmarkCase& Case, const TCHAR* StageName, int32 NumTrees, bool bHasMesh) const {
+		Case.AddMetric(FString::Printf(TEXT("%sMsPerTree"), StageName), Seconds * 1000.0 / NumTrees);
+		Case.AddMetric(FString::Printf(TEXT("%sAllocationsPerTree"), StageName), double(NumAllocations) / NumTrees);
+		if (bHasMesh) {
+			Case.AddMetric(FString::Printf(TEXT("%sVerticesPerTree"), StageName), double(NumVertices) / NumTrees);
+			Case.AddMetric(FString::Printf(TEXT("%sTrianglesPerTree"), StageName), double(NumTriangles) / NumTrees);
+		}
+	}
+};
+
+/*
+	Runs a stage, adding its time and allocations to the stats
+*/
+template<typename FunctionType>
+static void TimeStage(FTreeStageStats& Stats, FunctionType&& Function) {
+	const uint64 StartAllocations = FBenchmarkAllocationCounter::GetNumAllocations();
+	const double StartTime = FPlatformTime::Seconds();
+	Function();
+	Stats.Seconds += FPlatformTime::Seconds() - StartTime;
+	Stats.NumAllocations += FBenchmarkAllocationCounter::GetNumAllocations() - StartAllocations;
+}
+
+int32 UTreeBenchmarkCommandlet::Main(const FString& Params) {
+	int32 SeedStart = 0;
+	int32 NumSeeds = 50;
+	double Tolerance = 0.1;
+	FString PresetsParam = FPaths::ProjectDir() / TEXT("treeSettings1.txt");
+	FString BaselinePath;
+	FParse::Value(*Params, TEXT("SeedStart="), SeedStart);
+	FParse::Value(*Params, TEXT("NumSeeds="), NumSeeds);
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+	FParse::Value(*Params, TEXT("Presets="), PresetsParam, false);
+	FParse::Value(*Params, TEXT("Baseline="), BaselinePath);
+	const bool bWriteBaseline = FParse::Param(*Params, TEXT("WriteBaseline"));
+	NumSeeds = FMath::Max(NumSeeds, 1);
+
+	// Folders are searched for preset files, so a folder of species can be benchmarked at once
+	TArray<FString> PresetPaths;
+	TArray<FString> PresetParams;
+	PresetsParam.ParseIntoArray(PresetParams, TEXT(","));
+	for (const FString& PresetParam : PresetParams) {
+		if (IFileManager::Get().DirectoryExists(*PresetParam)) {
+			TArray<FString> FoundFiles;
+			IFileManager::Get().FindFiles(FoundFiles, *(PresetParam / TEXT("*")), true, false);
+			for (const FString& FoundFile : FoundFiles) {
+				PresetPaths.Add(PresetParam / FoundFile);
+			}
+		}
+		else {
+			PresetPaths.Add(PresetParam);
+		}
+	}
+
+	FBenchmarkAllocationCounter::Install();
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	FBenchmarkReport Report;
+	int32 NumFailedPresets = 0;
+
+	for (const FString& PresetPath : PresetPaths) {
+		FData PresetData;
+		if (!LoadPreset(PresetPath, PresetData)) {
+			UE_LOG(LogTemp, Error, TEXT("Couldn't load tree preset %s"), *PresetPath);
+			NumFailedPresets++;
+			continue;
+		}
+
+		FTreeStageStats TreeDataStats;
+		FTreeStageStats MeshOnlyStats;
+		FTreeStageStats LeavesStats;
+		FTreeStageStats HighQualityStats;
+		int64 NumLogs = 0;
+		bool bEmptyTree = false;
+
+		// Not begun play, so the root only holds generation state and never registers with the game
+		ATreeRoot* TreeRoot = World->SpawnActor<ATreeRoot>();
+		TreeRoot->InitialTreeData = PresetData;
+
+		for (int32 TreeSeed = SeedStart; TreeSeed < SeedStart + NumSeeds; TreeSeed++) {
+			TreeRoot->TreeSeed = TreeSeed;
+			TreeRoot->LogMeshInfo = FProcMeshInfo();
+			TreeRoot->LeavesMeshInfo = FProcMeshInfo();
+
+			TimeStage(TreeDataStats, [&]() { TreeRoot->GenerateTreeData(); });
+			NumLogs += TreeRoot->Skeleton.Num();
+
+			// Every tree has at least a trunk, a preset that gives none can't be measured
+			if (TreeRoot->Skeleton.Num() == 0) {
+				UE_LOG(LogTemp, Error, TEXT("Tree preset %s gave an empty tree for seed %d"), *PresetPath, TreeSeed);
+				bEmptyTree = true;
+				break;
+			}
+
+			// Continues the tree data's stream, like GenerateTree does
+			TimeStage(MeshOnlyStats, [&]() {
+				TreeRoot->GenerateMeshOnly();
+			});
+			MeshOnlyStats.AddMesh(TreeRoot->LogMeshInfo);
+			MeshOnlyStats.AddMesh(TreeRoot->LeavesMeshInfo);
+
+			// Stages run per log on their own, as cut logs and near trees build them
+			for (int32 BranchIndex = 0; BranchIndex < int32(TreeRoot->Skeleton.Num()); BranchIndex++) {
+				const FData Data = TreeRoot->GetBranchData(BranchIndex);
+				const FRandomStream LogStream(TreeSeed);
+
+				if (Data.bMakeLeaves) {
+					FProcMeshInfo LeavesMeshInfo;
+					TimeStage(LeavesStats, [&]() {
+						LeavesMeshInfo = ATree::CreateLeavesMeshData(Data, LogStream, FVector::ZeroVector, FVector::UpVector);
+					});
+					LeavesStats.AddMesh(LeavesMeshInfo);
+				}
+
+				FProcMeshInfo HighQualityMeshInfo;
+				TimeStage(HighQualityStats, [&]() {
+					HighQualityMeshInfo = ATree::CreateMeshData(Data.bMakeLeaves, Data, LogStream, EChunkQuality::High, FVector::ZeroVector, FVector::UpVector);
+				});
+				HighQualityStats.AddMesh(HighQualityMeshInfo);
+			}
+		}
+
+		TreeRoot->Skeleton.Release();
+		TreeRoot->Destroy();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+		if (bEmptyTree) {
+			NumFailedPresets++;
+			continue;
+		}
+
+		FBenchmarkCase& Case = Report.AddCase(FPaths::GetBaseFilename(PresetPath));
+		Case.AddMetric(TEXT("LogsPerTree"), double(NumLogs) / NumSeeds);
+		TreeDataStats.AddToCase(Case, TEXT("GenerateTreeData"), NumSeeds, false);
+		MeshOnlyStats.AddToCase(Case, TEXT("GenerateMeshOnly"), NumSeeds, true);
+		LeavesStats.AddToCase(Case, TEXT("CreateLeavesMeshData"), NumSeeds, true);
+		HighQualityStats.AddToCase(Case, TEXT("GetHighQualityMesh"), NumSeeds, true);
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	UE_LOG(LogTemp, Display, TEXT("Tree benchmark, %d presets, seeds %d to %d"), PresetPaths.Num(), SeedStart, SeedStart + NumSeeds - 1);
+	Report.Log();
+
+	if (NumFailedPresets > 0) {
+		return 1;
+	}
+	if (BaselinePath.IsEmpty()) {
+		return 0;
+	}
+	if (bWriteBaseline) {
+		return Report.SaveBaseline(BaselinePath) ? 0 : 1;
+	}
+	return Report.CompareToBaseline(BaselinePath, Tolerance) > 0 ? 1 : 0;
+}
@@ -0,0 +1,34 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "TreeBenchmarkCommandlet.generated.h"
+
+struct FData;
+
+/*
+	Times each stage of tree generation over a range of seeds for every species preset, and reports per stage timings,
+	vertex and triangle counts and allocations. Presets are property dumps like treeSettings1.txt, a "Tagged" array of
+	[name, value] pairs, or a plain JSON object of FData property names to values.
+
+	UnrealEditor-Cmd Lumber.uproject -run=TreeBenchmark [-Presets=<file or folder>,...] [-SeedStart=0] [-NumSeeds=50]
+		[-Baseline=<file> [-Tolerance=0.1] [-WriteBaseline]]
+*/
+UCLASS()
+class LUMBER_API UTreeBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UTreeBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+	/*
+		Reads a species preset into tree data, properties the file doesn't mention keep their defaults. Returns false if
+		the file couldn't be read or none of its properties matched
+	*/
+	static bool LoadPreset(const FString& FilePath, FData& OutData);
+};
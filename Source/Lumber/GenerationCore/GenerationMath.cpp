@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GenerationMath.h"
+#include <algorithm>
+#include <cstring>
+
+namespace LumberCore {
+
+static constexpr double DegreesPerRadian = 180.0 / 3.1415926535897932;
+
+FRot FRot::FromDirection(const FVec3& Direction) {
+	FRot Result;
+	Result.Yaw = std::atan2(Direction.Y, Direction.X) * DegreesPerRadian;
+	Result.Pitch = std::atan2(Direction.Z, std::sqrt(Direction.X * Direction.X + Direction.Y * Direction.Y)) * DegreesPerRadian;
+	Result.Roll = 0;
+	return Result;
+}
+
+FVec3 FRot::Vector() const {
+	// Remove winding before converting to radians
+	const double PitchRadians = std::fmod(Pitch, 360.0) / DegreesPerRadian;
+	const double YawRadians = std::fmod(Yaw, 360.0) / DegreesPerRadian;
+	const double CP = std::cos(PitchRadians);
+	const double SP = std::sin(PitchRadians);
+	const double CY = std::cos(YawRadians);
+	const double SY = std::sin(YawRadians);
+	return FVec3(CP * CY, CP * SY, SP);
+}
+
+float FGenerationStream::GetFraction() {
+	Seed = (Seed * 196314165U) + 907633515U;
+
+	// Random mantissa under an exponent of zero gives a float in [1, 2)
+	const uint32_t Bits = 0x3F800000U | (Seed >> 9);
+	float Result;
+	std::memcpy(&Result, &Bits, sizeof(Result));
+	return Result - 1.0f;
+}
+
+int32_t FGenerationStream::RandRange(int32_t Min, int32_t Max) {
+	const int32_t Range = (Max - Min) + 1;
+	const int32_t Offset = Range > 0 ? std::min(int32_t(GetFraction() * float(Range)), Range - 1) : 0;
+	return Min + Offset;
+}
+
+float FGenerationStream::FRandRange(float Min, float Max) {
+	return float(double(Min) + (double(Max) - double(Min)) * GetFraction());
+}
+
+}
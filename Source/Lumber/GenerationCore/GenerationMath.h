@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/*
+	Math types of the generation core. The core is plain C++ with no engine dependencies, so it can be built into the
+	standalone benchmark in Tools/GenerationBenchmark as well as the game module, and every type here mirrors the
+	engine type the adapters convert to
+*/
+
+#include <cmath>
+#include <cstdint>
+
+namespace LumberCore {
+
+struct FVec3 {
+	double X = 0;
+	double Y = 0;
+	double Z = 0;
+
+	FVec3() = default;
+	FVec3(double InX, double InY, double InZ) : X(InX), Y(InY), Z(InZ) {}
+
+	FVec3 operator+(const FVec3& Other) const { return FVec3(X + Other.X, Y + Other.Y, Z + Other.Z); }
+	FVec3 operator-(const FVec3& Other) const { return FVec3(X - Other.X, Y - Other.Y, Z - Other.Z); }
+	FVec3 operator*(double Scale) const { return FVec3(X * Scale, Y * Scale, Z * Scale); }
+
+	double SizeSquared() const { return X * X + Y * Y + Z * Z; }
+
+	/*
+		Unit vector in the same direction, zero if the vector is too short to have one (FVector::GetSafeNormal)
+	*/
+	FVec3 GetSafeNormal() const {
+		const double SquareSum = SizeSquared();
+		if (SquareSum == 1.0) { return *this; }
+		if (SquareSum < 1.e-8) { return FVec3(); }
+		return *this * (1.0 / std::sqrt(SquareSum));
+	}
+};
+
+/*
+	Pitch, yaw and roll in degrees (FRotator)
+*/
+struct FRot {
+	double Pitch = 0;
+	double Yaw = 0;
+	double Roll = 0;
+
+	FRot() = default;
+	FRot(double InPitch, double InYaw, double InRoll) : Pitch(InPitch), Yaw(InYaw), Roll(InRoll) {}
+
+	FRot operator+(const FRot& Other) const { return FRot(Pitch + Other.Pitch, Yaw + Other.Yaw, Roll + Other.Roll); }
+
+	/*
+		Rotation that points forward along a direction, without roll (FVector::Rotation)
+	*/
+	static FRot FromDirection(const FVec3& Direction);
+
+	/*
+		Forward direction of the rotation (FRotator::Vector)
+	*/
+	FVec3 Vector() const;
+};
+
+/*
+	Pseudorandom stream producing the same sequence as FRandomStream for the same seed, so generation
+	moved into the core keeps its seeds
+*/
+class FGenerationStream {
+public:
+	FGenerationStream() = default;
+	explicit FGenerationStream(int32_t InSeed) : Seed(uint32_t(InSeed)) {}
+
+	// Seed the next number is made from, an FRandomStream initialized with it continues this stream
+	int32_t GetCurrentSeed() const { return int32_t(Seed); }
+
+	// In the range [0, 1)
+	float GetFraction();
+
+	// In the range [Min, Max], inclusive
+	int32_t RandRange(int32_t Min, int32_t Max);
+
+	float FRandRange(float Min, float Max);
+
+private:
+	uint32_t Seed = 0;
+};
+
+}
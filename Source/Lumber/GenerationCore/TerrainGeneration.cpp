@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainGeneration.h"
+
+namespace LumberCore {
+
+// Ken Perlin's permutation, repeated so lookups of a hash plus one never wrap
+static const int32_t Permutation[512] = {
+	151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225, 140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23,
+	190, 6, 148, 247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32, 57, 177, 33, 88, 237, 149, 56, 87, 174,
+	20, 125, 136, 171, 168, 68, 175, 74, 165, 71, 134, 139, 48, 27, 166, 77, 146, 158, 231, 83, 111, 229, 122, 60, 211, 133, 230,
+	220, 105, 92, 41, 55, 46, 245, 40, 244, 102, 143, 54, 65, 25, 63, 161, 1, 216, 80, 73, 209, 76, 132, 187, 208, 89, 18, 169,
+	200, 196, 135, 130, 116, 188, 159, 86, 164, 100, 109, 198, 173, 186, 3, 64, 52, 217, 226, 250, 124, 123, 5, 202, 38, 147,
+	118, 126, 255, 82, 85, 212, 207, 206, 59, 227, 47, 16, 58, 17, 182, 189, 28, 42, 223, 183, 170, 213, 119, 248, 152, 2, 44,
+	154, 163, 70, 221, 153, 101, 155, 167, 43, 172, 9, 129, 22, 39, 253, 19, 98, 108, 110, 79, 113, 224, 232, 178, 185, 112, 104,
+	218, 246, 97, 228, 251, 34, 242, 193, 238, 210, 144, 12, 191, 179, 162, 241, 81, 51, 145, 235, 249, 14, 239, 107, 49, 192,
+	214, 31, 181, 199, 106, 157, 184, 84, 204, 176, 115, 121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93, 222, 114, 67, 29,
+	24, 72, 243, 141, 128, 195, 78, 66, 215, 61, 156, 180,
+
+	151, 160, 137, 91, 90, 15, 131, 13, 201, 95, 96, 53, 194, 233, 7, 225, 140, 36, 103, 30, 69, 142, 8, 99, 37, 240, 21, 10, 23,
+	190, 6, 148, 247, 120, 234, 75, 0, 26, 197, 62, 94, 252, 219, 203, 117, 35, 11, 32, 57, 177, 33, 88, 237, 149, 56, 87, 174,
+	20, 125, 136, 171, 168, 68, 175, 74, 165, 71, 134, 139, 48, 27, 166, 77, 146, 158, 231, 83, 111, 229, 122, 60, 211, 133, 230,
+	220, 105, 92, 41, 55, 46, 245, 40, 244, 102, 143, 54, 65, 25, 63, 161, 1, 216, 80, 73, 209, 76, 132, 187, 208, 89, 18, 169,
+	200, 196, 135, 130, 116, 188, 159, 86, 164, 100, 109, 198, 173, 186, 3, 64, 52, 217, 226, 250, 124, 123, 5, 202, 38, 147,
+	118, 126, 255, 82, 85, 212, 207, 206, 59, 227, 47, 16, 58, 17, 182, 189, 28, 42, 223, 183, 170, 213, 119, 248, 152, 2, 44,
+	154, 163, 70, 221, 153, 101, 155, 167, 43, 172, 9, 129, 22, 39, 253, 19, 98, 108, 110, 79, 113, 224, 232, 178, 185, 112, 104,
+	218, 246, 97, 228, 251, 34, 242, 193, 238, 210, 144, 12, 191, 179, 162, 241, 81, 51, 145, 235, 249, 14, 239, 107, 49, 192,
+	214, 31, 181, 199, 106, 157, 184, 84, 204, 176, 115, 121, 50, 45, 127, 4, 150, 254, 138, 236, 205, 93, 222, 114, 67, 29,
+	24, 72, 243, 141, 128, 195, 78, 66, 215, 61, 156, 180
+};
+
+static inline float SmoothCurve(float X) {
+	return X * X * X * (X * (X * 6.0f - 15.0f) + 10.0f);
+}
+
+static inline float Lerp(float A, float B, float Alpha) {
+	return A + Alpha * (B - A);
+}
+
+// Gradients along the corners and major axes
+static inline float Grad2(int32_t Hash, float X, float Y) {
+	switch (Hash & 7) {
+	case 0: return X;
+	case 1: return X + Y;
+	case 2: return Y;
+	case 3: return -X + Y;
+	case 4: return -X;
+	case 5: return -X - Y;
+	case 6: return -Y;
+	case 7: return X - Y;
+	default: return 0;
+	}
+}
+
+float PerlinNoise2D(float X, float Y) {
+	const float Xfl = std::floor(X);
+	const float Yfl = std::floor(Y);
+	const int32_t Xi = int32_t(Xfl) & 255;
+	const int32_t Yi = int32_t(Yfl) & 255;
+	X -= Xfl;
+	Y -= Yfl;
+	const float Xm1 = X - 1.0f;
+	const float Ym1 = Y - 1.0f;
+
+	const int32_t AA = Permutation[Xi] + Yi;
+	const int32_t AB = AA + 1;
+	const int32_t BA = Permutation[Xi + 1] + Yi;
+	const int32_t BB = BA + 1;
+
+	const float U = SmoothCurve(X);
+	const float V = SmoothCurve(Y);
+
+	return Lerp(
+		Lerp(Grad2(Permutation[AA], X, Y), Grad2(Permutation[BA], Xm1, Y), U),
+		Lerp(Grad2(Permutation[AB], X, Ym1), Grad2(Permutation[BB], Xm1, Ym1), U),
+		V);
+}
+
+float SampleTerrainHeight(const FNoiseLayer* Layers, int32_t NumLayers, double X, double Y) {
+	float ResultZ = 0;
+
+	for (int32_t i = 0; i < NumLayers; i++) {
+		const FNoiseLayer& Layer = Layers[i];
+
+		// Stretch or translate point for the perlin noise function
+		const double ProcessedX = X * Layer.XScale + Layer.XOffset;
+		const double ProcessedY = Y * Layer.YScale + Layer.YOffset;
+
+		// Amplify the point
+		const float NewResultZ = PerlinNoise2D(float(ProcessedX), float(ProcessedY)) * Layer.Gain;
+
+		// Operation to the resulting Z point
+		switch (Layer.Operation) {
+		case ENoiseOperation::Additive:
+			ResultZ += NewResultZ;
+			break;
+		case ENoiseOperation::Multiplicative:
+			ResultZ = ResultZ * NewResultZ;
+			break;
+		}
+	}
+
+	return ResultZ;
+}
+
+FHeightRange SampleHeightfieldRows(const FNoiseLayer* Layers, int32_t NumLayers, double OriginX, double OriginY, int32_t TileSize, int32_t BorderedSize, int32_t BeginRow, int32_t EndRow, float* OutHeights) {
+	FHeightRange InnerRange;
+
+	for (int32_t row_i = BeginRow; row_i < EndRow; row_i++) {
+		for (int32_t col_i = 0; col_i < BorderedSize; col_i++) {
+			const double X = OriginX + double(TileSize * (row_i - 1));
+			const double Y = OriginY + double(TileSize * (col_i - 1));
+			const float Height = SampleTerrainHeight(Layers, NumLayers, X, Y);
+			OutHeights[row_i * BorderedSize + col_i] = Height;
+
+			const bool bInner = row_i > 0 && row_i < BorderedSize - 1 && col_i > 0 && col_i < BorderedSize - 1;
+			if (bInner) {
+				InnerRange.Add(Height);
+			}
+		}
+	}
+
+	return InnerRange;
+}
+
+void BuildGridTriangleRows(int32_t GridSize, int32_t BeginRow, int32_t EndRow, int32_t* OutTriangles) {
+	const int32_t NumRows = GridSize + 1;
+
+	for (int32_t row_i = BeginRow; row_i < EndRow; row_i++) {
+		for (int32_t col_i = 0; col_i < GridSize; col_i++) {
+			int32_t* Tile = &OutTriangles[(row_i * GridSize + col_i) * 6];
+
+			// Rightmost triangle
+			Tile[0] = row_i * NumRows + col_i;
+			Tile[1] = row_i * NumRows + col_i + 1;
+			Tile[2] = (row_i + 1) * NumRows + col_i + 1;
+
+			// Leftmost triangle
+			Tile[3] = row_i * NumRows + col_i;
+			Tile[4] = (row_i + 1) * NumRows + col_i + 1;
+			Tile[5] = (row_i + 1) * NumRows + col_i;
+		}
+	}
+}
+
+FVec3 GetHeightfieldNormal(const float* Heights, int32_t BorderedSize, int32_t TileSize, int32_t Row, int32_t Col) {
+	const auto GetHeight = [Heights, BorderedSize](int32_t HeightRow, int32_t HeightCol) {
+		return Heights[(HeightRow + 1) * BorderedSize + HeightCol + 1];
+	};
+
+	const float SlopeX = (GetHeight(Row + 1, Col) - GetHeight(Row - 1, Col)) / (2.0f * float(TileSize));
+	const float SlopeY = (GetHeight(Row, Col + 1) - GetHeight(Row, Col - 1)) / (2.0f * float(TileSize));
+	return FVec3(-SlopeX, -SlopeY, 1).GetSafeNormal();
+}
+
+}
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GenerationMath.h"
+
+namespace LumberCore {
+
+enum class ENoiseOperation : uint8_t {
+	Additive,
+	Multiplicative
+};
+
+/*
+	One layer of terrain noise, mirrors FNoiseLayer
+*/
+struct FNoiseLayer {
+	float XScale = 1;
+	float YScale = 1;
+	float XOffset = 0;
+	float YOffset = 0;
+	float Gain = 1;
+	ENoiseOperation Operation = ENoiseOperation::Additive;
+};
+
+struct FHeightRange {
+	float Min = 3.402823466e+38f;
+	float Max = -3.402823466e+38f;
+
+	void Add(float Height) {
+		Min = Height < Min ? Height : Min;
+		Max = Height > Max ? Height : Max;
+	}
+
+	void Add(const FHeightRange& Other) {
+		Min = Other.Min < Min ? Other.Min : Min;
+		Max = Other.Max > Max ? Other.Max : Max;
+	}
+};
+
+/*
+	Gradient noise in the range (-1, 1), the same function as FMath::PerlinNoise2D
+*/
+float PerlinNoise2D(float X, float Y);
+
+/*
+	Height of the terrain at a world point, each layer's noise is added to or multiplied with the layers before it
+*/
+float SampleTerrainHeight(const FNoiseLayer* Layers, int32_t NumLayers, double X, double Y);
+
+/*
+	Samples rows [BeginRow, EndRow) of a chunk's heightfield, which has a border of one tile on every side so row and
+	column 0 lie one tile before the chunk origin. Returns the height range of the rows' vertices inside the chunk.
+	Rows are independent, so blocks of rows can be sampled on different threads into the same buffer
+*/
+FHeightRange SampleHeightfieldRows(const FNoiseLayer* Layers, int32_t NumLayers, double OriginX, double OriginY, int32_t TileSize, int32_t BorderedSize, int32_t BeginRow, int32_t EndRow, float* OutHeights);
+
+/*
+	Writes the six indices of each tile in rows [BeginRow, EndRow) of a GridSize x GridSize tile grid, whose vertices are
+	laid out row by row. Tile t of the grid is written at OutTriangles[t * 6]
+*/
+void BuildGridTriangleRows(int32_t GridSize, int32_t BeginRow, int32_t EndRow, int32_t* OutTriangles);
+
+/*
+	Normal of a chunk vertex from the central difference of its neighbours' heights in a bordered heightfield,
+	rows and columns of -1 and BorderedSize - 2 are the border
+*/
+FVec3 GetHeightfieldNormal(const float* Heights, int32_t BorderedSize, int32_t TileSize, int32_t Row, int32_t Col);
+
+}
@@ -0,0 +1,178 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TreeSkeleton.h"
+#include <algorithm>
+
+namespace LumberCore {
+
+int32_t FTreeSkeleton::Add(const FTreeBranch& Branch) {
+	Parents.push_back(Branch.Parent);
+	Rows.push_back(Branch.Rows);
+	Widths.push_back(Branch.Width);
+	Lengths.push_back(Branch.BranchHeight);
+	LocalLocations.push_back(Branch.LocalLocation);
+	UpVectors.push_back(Branch.UpVector);
+	Flags.push_back(uint8_t((Branch.bPartOfRoot ? BranchFlag_PartOfRoot : 0) | (Branch.bMakeLeaves ? BranchFlag_MakeLeaves : 0)));
+	return int32_t(Parents.size() - 1);
+}
+
+FTreeBranch FTreeSkeleton::GetBranch(size_t Index) const {
+	FTreeBranch Branch;
+	Branch.Parent = Parents[Index];
+	Branch.Rows = Rows[Index];
+	Branch.Width = Widths[Index];
+	Branch.BranchHeight = Lengths[Index];
+	Branch.LocalLocation = LocalLocations[Index];
+	Branch.UpVector = UpVectors[Index];
+	Branch.bPartOfRoot = IsPartOfRoot(Index);
+	Branch.bMakeLeaves = MakesLeaves(Index);
+	return Branch;
+}
+
+void FTreeSkeleton::Reset() {
+	Parents.clear();
+	Rows.clear();
+	Widths.clear();
+	Lengths.clear();
+	LocalLocations.clear();
+	UpVectors.clear();
+	Flags.clear();
+}
+
+void FTreeSkeleton::Release() {
+	*this = FTreeSkeleton();
+}
+
+size_t FTreeSkeleton::GetAllocatedSize() const {
+	return (Parents.capacity() + Rows.capacity() + Widths.capacity() + Lengths.capacity()) * sizeof(int32_t)
+		+ (LocalLocations.capacity() + UpVectors.capacity()) * sizeof(FVec3) + Flags.capacity() * sizeof(uint8_t);
+}
+
+// Branches still to be added off one parent, the explicit stack replaces recursing per branch
+struct FBranchFrame {
+	int32_t ParentIndex;
+	int32_t Depth;
+	int32_t NumBranches;
+	int32_t NumAdded;
+};
+
+static void PushBranchFrame(const FTreeParams& Params, FGenerationStream& Stream, std::vector<FBranchFrame>& Frames, int32_t MaxDepth, int32_t Depth, int32_t ParentIndex, bool bExtension) {
+	// stop building the tree if this branch exceeds the max depth
+	if (Depth > MaxDepth) { return; }
+
+	// get random number for how many branches branch off from the parent branch, drawn even for extensions to keep the stream in step
+	int32_t NumBranches = Stream.RandRange(Params.BranchNumMin, Params.BranchNumMax - Params.BranchNumMax * (Depth / MaxDepth));
+	if (bExtension) {
+		NumBranches = 1;
+	}
+
+	Frames.push_back({ ParentIndex, Depth, NumBranches, 0 });
+}
+
+// Finalizer of splitmix64, spreads every input bit over the whole result
+static uint64_t MixBits(uint64_t Value) {
+	Value ^= Value >> 30;
+	Value *= 0xBF58476D1CE4E5B9ULL;
+	Value ^= Value >> 27;
+	Value *= 0x94D049BB133111EBULL;
+	Value ^= Value >> 31;
+	return Value;
+}
+
+int32_t GetTreeSeed(int32_t WorldSeed, int64_t PlacementX, int64_t PlacementY) {
+	uint64_t Hash = MixBits(uint64_t(uint32_t(WorldSeed)));
+	Hash = MixBits(Hash ^ uint64_t(PlacementX));
+	Hash = MixBits(Hash ^ uint64_t(PlacementY));
+	return int32_t(uint32_t(Hash));
+}
+
+// Mixed into a tree's seed before each pick, so the picks made for one tree are independent of each other
+static const uint64_t VariantSalt = 0x5D8A1F3C7E29B640ULL;
+static const uint64_t SpeciesSalt = 0xA3C59AC2F1B7E60DULL;
+
+static int32_t PickForTree(int32_t TreeSeed, uint64_t Salt, int32_t NumOptions) {
+	if (NumOptions <= 1) { return 0; }
+
+	const uint64_t Hash = MixBits(uint64_t(uint32_t(TreeSeed)) ^ Salt);
+	return int32_t((Hash >> 32) % uint64_t(NumOptions));
+}
+
+int32_t GetTreeVariant(int32_t TreeSeed, int32_t NumVariants) {
+	return PickForTree(TreeSeed, VariantSalt, NumVariants);
+}
+
+int32_t GetTreeSpecies(int32_t TreeSeed, int32_t NumSpecies) {
+	return PickForTree(TreeSeed, SpeciesSalt, NumSpecies);
+}
+
+int32_t GetVariantSeed(uint32_t SpeciesHash, int32_t Variant) {
+	uint64_t Hash = MixBits(uint64_t(SpeciesHash));
+	Hash = MixBits(Hash ^ uint64_t(uint32_t(Variant)));
+	return int32_t(uint32_t(Hash));
+}
+
+void BuildTreeSkeleton(const FTreeParams& Params, FGenerationStream& Stream, FTreeSkeleton& OutSkeleton, int32_t MaxDepth) {
+	OutSkeleton.Reset();
+
+	FTreeBranch Trunk;
+	Trunk.Rows = int32_t(float(Params.Rows) * Params.TrunkHeightMultiplier);
+	Trunk.Width = Params.Width;
+	Trunk.BranchHeight = (Trunk.Rows - 1) * Params.SectionHeight;
+	Trunk.bPartOfRoot = true;
+	Trunk.LocalLocation = FVec3(0, 0, 1) * double(Trunk.BranchHeight) * 0.5;
+	OutSkeleton.Add(Trunk);
+
+	// Each new branch's own branches are finished before its next sibling, the same depth first order the stream is drawn in
+	std::vector<FBranchFrame> Frames;
+	Frames.reserve(size_t(MaxDepth) + 2);
+	PushBranchFrame(Params, Stream, Frames, MaxDepth, 0, 0, true);
+
+	while (!Frames.empty()) {
+		FBranchFrame& Frame = Frames.back();
+		if (Frame.NumAdded == Frame.NumBranches) {
+			Frames.pop_back();
+			continue;
+		}
+		Frame.NumAdded++;
+		const int32_t CurrentDepth = Frame.Depth;
+		const int32_t ParentIndex = Frame.ParentIndex;
+
+		// Side stems are disabled, but their numbers are still drawn
+		Stream.RandRange(0, 100);
+		Stream.RandRange(0, 1);
+		const float StemAmount = 1;
+
+		// random angle for new branch
+		const FVec3 ParentLocation = OutSkeleton.LocalLocations[ParentIndex];
+		const FVec3 ParentUpVector = OutSkeleton.UpVectors[ParentIndex];
+		const int32_t ParentLength = OutSkeleton.Lengths[ParentIndex];
+		const float Randomness = float((60 - (60 * (CurrentDepth / MaxDepth)) * 0.7) * (float(CurrentDepth * 2 / MaxDepth) + Params.StraightAmount));
+		const float RandPitch = Stream.FRandRange(-Randomness, Randomness);
+		const float RandYaw = Stream.FRandRange(-Randomness, Randomness);
+		const float RandRoll = Stream.FRandRange(-Randomness, Randomness);
+
+		FTreeBranch NewBranch;
+		NewBranch.Parent = ParentIndex;
+		NewBranch.Width = std::clamp(Params.Width * (MaxDepth - CurrentDepth) / MaxDepth, Params.Width / 4, Params.Width);
+		NewBranch.Rows = int32_t(Stream.FRandRange(float(Params.Rows / (CurrentDepth + 1)), float(Params.Rows)));
+		NewBranch.BranchHeight = (NewBranch.Rows - 1) * Params.SectionHeight;
+		NewBranch.UpVector = (FRot::FromDirection(ParentUpVector) + FRot(RandPitch, RandYaw, RandRoll)).Vector();
+
+		// Move up by the parent's half height to its end, then by this branch's half height to its centre
+		FVec3 NewLocation = ParentLocation + ParentUpVector * double(ParentLength / 2) * StemAmount;
+		NewLocation = NewLocation + NewBranch.UpVector * double(NewBranch.BranchHeight / 2) * StemAmount;
+		NewBranch.LocalLocation = NewLocation;
+
+		// chance to extend this branch, continuing with the same depth
+		const bool bExtendThis = Stream.RandRange(0, 100) <= Params.ExtendChance;
+		NewBranch.bMakeLeaves = CurrentDepth == MaxDepth && !bExtendThis;
+
+		const int32_t NewIndex = OutSkeleton.Add(NewBranch);
+
+		// Invalidates Frame
+		PushBranchFrame(Params, Stream, Frames, MaxDepth, bExtendThis ? CurrentDepth : CurrentDepth + 1, NewIndex, bExtendThis);
+	}
+}
+
+}
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GenerationMath.h"
+#include <vector>
+
+namespace LumberCore {
+
+/*
+	Settings of a tree species that shape its skeleton, mirrors the matching fields of FData
+*/
+struct FTreeParams {
+	int32_t Rows = 10;
+	int32_t Width = 100;
+	int32_t SectionHeight = 50;
+	int32_t SideStemChance = 50;
+	int32_t BranchNumMin = 1;
+	int32_t BranchNumMax = 5;
+	int32_t ExtendChance = 1;
+	float TrunkHeightMultiplier = 1.5f;
+	float StraightAmount = 0.5f;
+};
+
+/*
+	One log of a tree, positioned by its centre relative to the tree's root
+*/
+struct FTreeBranch {
+	// Index of the parent branch, -1 for the trunk
+	int32_t Parent = -1;
+
+	int32_t Rows = 0;
+	int32_t Width = 0;
+	int32_t BranchHeight = 0;
+
+	FVec3 LocalLocation;
+	FVec3 UpVector = FVec3(0, 0, 1);
+
+	bool bPartOfRoot = false;
+	bool bMakeLeaves = false;
+};
+
+enum ETreeBranchFlags : uint8_t {
+	BranchFlag_PartOfRoot = 1 << 0,
+	BranchFlag_MakeLeaves = 1 << 1,
+};
+
+/*
+	Branches of a tree as parallel arrays indexed by branch, so walking one attribute of every branch stays in cache.
+	Holds no species settings, those are shared by every tree of a species
+*/
+struct FTreeSkeleton {
+	// Index of the parent branch, -1 for the trunk
+	std::vector<int32_t> Parents;
+
+	// Rows of vertices along the branch
+	std::vector<int32_t> Rows;
+
+	// Radius of the branch
+	std::vector<int32_t> Widths;
+
+	// Length of the branch along its up vector
+	std::vector<int32_t> Lengths;
+
+	std::vector<FVec3> LocalLocations;
+	std::vector<FVec3> UpVectors;
+
+	// ETreeBranchFlags
+	std::vector<uint8_t> Flags;
+
+	size_t Num() const { return Parents.size(); }
+
+	int32_t Add(const FTreeBranch& Branch);
+
+	FTreeBranch GetBranch(size_t Index) const;
+
+	bool IsPartOfRoot(size_t Index) const { return (Flags[Index] & BranchFlag_PartOfRoot) != 0; }
+
+	bool MakesLeaves(size_t Index) const { return (Flags[Index] & BranchFlag_MakeLeaves) != 0; }
+
+	/*
+		Removes every branch, keeping the arrays' memory for the next tree
+	*/
+	void Reset();
+
+	/*
+		Removes every branch and frees the arrays' memory
+	*/
+	void Release();
+
+	size_t GetAllocatedSize() const;
+};
+
+/*
+	Seed of the tree at a placement, mixed from the world seed and the placement's coordinates, so a tree comes out the same
+	whichever thread or order its chunk loads in
+*/
+int32_t GetTreeSeed(int32_t WorldSeed, int64_t PlacementX, int64_t PlacementY);
+
+/*
+	Which of a species' variants a far tree is drawn as. The tree's seed is mixed again first, so the variant doesn't follow
+	the species pick or the seed's low bits
+*/
+int32_t GetTreeVariant(int32_t TreeSeed, int32_t NumVariants);
+
+/*
+	Which of the species a tree grows as, picked from the tree's seed like its variant
+*/
+int32_t GetTreeSpecies(int32_t TreeSeed, int32_t NumSpecies);
+
+/*
+	Seed a species' variant is generated from. It only depends on the species' settings, so variants are the same in
+	every world and can be cached on disk
+*/
+int32_t GetVariantSeed(uint32_t SpeciesHash, int32_t Variant);
+
+/*
+	Builds the branches of a tree from a stream seeded with the tree's seed. Branches are in depth first order, so a
+	parent always comes before its children and children of one parent are in the order they branch off.
+	The stream is left where the skeleton finished, mesh generation continues from it
+*/
+void BuildTreeSkeleton(const FTreeParams& Params, FGenerationStream& Stream, FTreeSkeleton& OutSkeleton, int32_t MaxDepth = 4);
+
+}
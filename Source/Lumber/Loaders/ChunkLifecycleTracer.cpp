@@ -0,0 +1,230 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ChunkLifecycleTracer.h"
+#include "JobSystem.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/JsonWriter.h"
+
+// Chunk loads kept for the summary and trace export
+#define MAX_CHUNK_LIFECYCLES 8192
+
+/*
+	Spans drawn in the Chrome trace for every chunk load, between two of its events
+*/
+struct FChunkLifecycleSpan {
+	const TCHAR* Name;
+	EChunkLifecycleEvent From;
+	EChunkLifecycleEvent To;
+};
+
+static const FChunkLifecycleSpan LifecycleSpans[] = {
+	{ TEXT("Queued"), EChunkLifecycleEvent::Requested, EChunkLifecycleEvent::JobStarted },
+	{ TEXT("Heightfield"), EChunkLifecycleEvent::JobStarted, EChunkLifecycleEvent::HeightfieldDone },
+	{ TEXT("Mesh"), EChunkLifecycleEvent::HeightfieldDone, EChunkLifecycleEvent::MeshDone },
+	{ TEXT("Upload"), EChunkLifecycleEvent::MeshDone, EChunkLifecycleEvent::UploadQueued },
+	{ TEXT("GameThreadWait"), EChunkLifecycleEvent::UploadQueued, EChunkLifecycleEvent::SectionApplied },
+	{ TEXT("Collision"), EChunkLifecycleEvent::HeightfieldDone, EChunkLifecycleEvent::CollisionCooked },
+};
+
+double FChunkLifecycle::GetLatencyMilliseconds(EChunkLifecycleEvent Event) const {
+	if (!HasEvent(EChunkLifecycleEvent::Requested) || !HasEvent(Event)) { return -1; }
+	return (Timestamps[(int)Event] - Timestamps[(int)EChunkLifecycleEvent::Requested]) * 1000.0;
+}
+
+FChunkLifecycleTracer::FChunkLifecycleTracer()
+{
+	Lifecycles.SetNum(MAX_CHUNK_LIFECYCLES);
+}
+
+int32 FChunkLifecycleTracer::BeginTrace(FVector2D ChunkLocation, EChunkQuality ChunkQuality) {
+	FScopeLock Lock(&LifecyclesLock);
+	const int32 TraceId = NextTraceId++;
+
+	FChunkLifecycle& Lifecycle = Lifecycles[TraceId % Lifecycles.Num()];
+	Lifecycle = FChunkLifecycle();
+	Lifecycle.TraceId = TraceId;
+	Lifecycle.ChunkLocation = ChunkLocation;
+	Lifecycle.ChunkQuality = ChunkQuality;
+	Lifecycle.Timestamps[(int)EChunkLifecycleEvent::Requested] = FPlatformTime::Seconds();
+	return TraceId;
+}
+
+void FChunkLifecycleTracer::Mark(int32 TraceId, EChunkLifecycleEvent Event) {
+	if (TraceId == INDEX_NONE) { return; }
+
+	const double Now = FPlatformTime::Seconds();
+	FScopeLock Lock(&LifecyclesLock);
+	FChunkLifecycle& Lifecycle = Lifecycles[TraceId % Lifecycles.Num()];
+	if (Lifecycle.TraceId != TraceId) { return; }
+
+	// Keep the first time an event happened, a chunk can be uploaded more than once per load
+	if (!Lifecycle.HasEvent(Event)) {
+		Lifecycle.Timestamps[(int)Event] = Now;
+	}
+}
+
+void FChunkLifecycleTracer::GetLifecycles(TArray<FChunkLifecycle>& OutLifecycles) const {
+	FScopeLock Lock(&LifecyclesLock);
+	const int32 NumLifecycles = FMath::Min(NextTraceId, Lifecycles.Num());
+	for (int32 i = NextTraceId - NumLifecycles; i < NextTraceId; i++)
+	{
+		OutLifecycles.Add(Lifecycles[i % Lifecycles.Num()]);
+	}
+}
+
+void FChunkLifecycleTracer::LogSummary() const {
+	TArray<FChunkLifecycle> Traced;
+	GetLifecycles(Traced);
+
+	UE_LOG(LogTemp, Log, TEXT("Chunk lifecycles: %d traced, latency from request in ms"), Traced.Num());
+
+	for (EChunkQuality Quality : { EChunkQuality::Low, EChunkQuality::Medium, EChunkQuality::High }) {
+		for (int e = (int)EChunkLifecycleEvent::JobStarted; e < (int)EChunkLifecycleEvent::Count; e++)
+		{
+			TArray<double> Latencies;
+			for (const FChunkLifecycle& Lifecycle : Traced) {
+				const double Latency = Lifecycle.GetLatencyMilliseconds((EChunkLifecycleEvent)e);
+				if (Lifecycle.ChunkQuality == Quality && Latency >= 0) {
+					Latencies.Add(Latency);
+				}
+			}
+			if (Latencies.Num() == 0) { continue; }
+			Latencies.Sort();
+
+			UE_LOG(LogTemp, Log, TEXT("  %-6s %-15s n %5d  p50 %8.2f  p95 %8.2f  p99 %8.2f"),
+				GetQualityName(Quality), GetEventName((EChunkLifecycleEvent)e), Latencies.Num(),
+				GetSortedPercentile(Latencies, 50), GetSortedPercentile(Latencies, 95), GetSortedPercentile(Latencies, 99));
+		}
+	}
+}
+
+void FChunkLifecycleTracer::GetSortedLatencies(EChunkLifecycleEvent Event, TArray<double>& OutLatencies) const {
+	TArray<FChunkLifecycle> Traced;
+	GetLifecycles(Traced);
+
+	for (const FChunkLifecycle& Lifecycle : Traced) {
+		const double Latency = Lifecycle.GetLatencyMilliseconds(Event);
+		if (Latency >= 0) {
+			OutLatencies.Add(Latency);
+		}
+	}
+	OutLatencies.Sort();
+}
+
+bool FChunkLifecycleTracer::ExportChromeTrace(const FString& FilePath) const {
+	TArray<FChunkLifecycle> Traced;
+	GetLifecycles(Traced);
+
+	// Trace timestamps are microseconds, relative to the oldest request so they stay readable
+	double StartTime = TNumericLimits<double>::Max();
+	for (const FChunkLifecycle& Lifecycle : Traced) {
+		StartTime = FMath::Min(StartTime, Lifecycle.Timestamps[(int)EChunkLifecycleEvent::Requested]);
+	}
+	auto ToMicroseconds = [StartTime](double Seconds) { return (Seconds - StartTime) * 1000000.0; };
+
+	FString Json;
+	TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Json);
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("displayTimeUnit"), TEXT("ms"));
+	Writer->WriteArrayStart(TEXT("traceEvents"));
+
+	for (const FChunkLifecycle& Lifecycle : Traced) {
+		// Each load gets its own row, grouped by quality
+		const int32 ProcessId = (int32)Lifecycle.ChunkQuality;
+		const FString ChunkName = FString::Printf(TEXT("Chunk %s %s"), GetQualityName(Lifecycle.ChunkQuality), *Lifecycle.ChunkLocation.ToString());
+
+		for (const FChunkLifecycleSpan& Span : LifecycleSpans) {
+			if (!Lifecycle.HasEvent(Span.From) || !Lifecycle.HasEvent(Span.To)) { continue; }
+
+			Writer->WriteObjectStart();
+			Writer->WriteValue(TEXT("name"), Span.Name);
+			Writer->WriteValue(TEXT("cat"), ChunkName);
+			Writer->WriteValue(TEXT("ph"), TEXT("X"));
+			Writer->WriteValue(TEXT("pid"), ProcessId);
+			Writer->WriteValue(TEXT("tid"), Lifecycle.TraceId);
+			Writer->WriteValue(TEXT("ts"), ToMicroseconds(Lifecycle.Timestamps[(int)Span.From]));
+			Writer->WriteValue(TEXT("dur"), (Lifecycle.Timestamps[(int)Span.To] - Lifecycle.Timestamps[(int)Span.From]) * 1000000.0);
+			Writer->WriteObjectEnd();
+		}
+
+		for (int e = 0; e < (int)EChunkLifecycleEvent::Count; e++)
+		{
+			if (!Lifecycle.HasEvent((EChunkLifecycleEvent)e)) { continue; }
+
+			Writer->WriteObjectStart();
+			Writer->WriteValue(TEXT("name"), GetEventName((EChunkLifecycleEvent)e));
+			Writer->WriteValue(TEXT("cat"), ChunkName);
+			Writer->WriteValue(TEXT("ph"), TEXT("i"));
+			Writer->WriteValue(TEXT("s"), TEXT("t"));
+			Writer->WriteValue(TEXT("pid"), ProcessId);
+			Writer->WriteValue(TEXT("tid"), Lifecycle.TraceId);
+			Writer->WriteValue(TEXT("ts"), ToMicroseconds(Lifecycle.Timestamps[e]));
+			Writer->WriteObjectEnd();
+		}
+	}
+
+	// Name the process rows after the chunk qualities
+	for (EChunkQuality Quality : { EChunkQuality::Low, EChunkQuality::Medium, EChunkQuality::High }) {
+		Writer->WriteObjectStart();
+		Writer->WriteValue(TEXT("name"), TEXT("process_name"));
+		Writer->WriteValue(TEXT("ph"), TEXT("M"));
+		Writer->WriteValue(TEXT("pid"), (int32)Quality);
+		Writer->WriteObjectStart(TEXT("args"));
+		Writer->WriteValue(TEXT("name"), FString::Printf(TEXT("%s quality chunks"), GetQualityName(Quality)));
+		Writer->WriteObjectEnd();
+		Writer->WriteObjectEnd();
+	}
+
+	Writer->WriteArrayEnd();
+	Writer->WriteObjectEnd();
+	Writer->Close();
+
+	return FFileHelper::SaveStringToFile(Json, *FilePath);
+}
+
+void FChunkLifecycleTracer::Reset() {
+	FScopeLock Lock(&LifecyclesLock);
+	for (FChunkLifecycle& Lifecycle : Lifecycles) {
+		Lifecycle = FChunkLifecycle();
+	}
+	NextTraceId = 0;
+}
+
+const TCHAR* FChunkLifecycleTracer::GetEventName(EChunkLifecycleEvent Event) {
+	switch (Event)
+	{
+	case EChunkLifecycleEvent::Requested:
+		return TEXT("Requested");
+	case EChunkLifecycleEvent::JobStarted:
+		return TEXT("JobStarted");
+	case EChunkLifecycleEvent::HeightfieldDone:
+		return TEXT("HeightfieldDone");
+	case EChunkLifecycleEvent::MeshDone:
+		return TEXT("MeshDone");
+	case EChunkLifecycleEvent::UploadQueued:
+		return TEXT("UploadQueued");
+	case EChunkLifecycleEvent::SectionApplied:
+		return TEXT("SectionApplied");
+	case EChunkLifecycleEvent::CollisionCooked:
+		return TEXT("CollisionCooked");
+	default:
+		return TEXT("Unknown");
+	}
+}
+
+const TCHAR* FChunkLifecycleTracer::GetQualityName(EChunkQuality Quality) {
+	switch (Quality)
+	{
+	case EChunkQuality::Low:
+		return TEXT("Low");
+	case EChunkQuality::Medium:
+		return TEXT("Medium");
+	case EChunkQuality::High:
+		return TEXT("High");
+	case EChunkQuality::Collision:
+		return TEXT("Collision");
+	default:
+		return TEXT("Unknown");
+	}
+}
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Loader.h"
+#include "ChunkLifecycleTracer.generated.h"
+
+/*
+	Points in the life of a chunk load, in the order they normally happen
+*/
+UENUM()
+enum class EChunkLifecycleEvent : uint8 {
+	// QueueChunkLoad or ReloadChunk decided the chunk needs loading
+	Requested,
+	// A worker started LoadChunk
+	JobStarted,
+	HeightfieldDone,
+	MeshDone,
+	// The terrain mesh was handed to the game thread work queue
+	UploadQueued,
+	// The terrain mesh component committed the section to its scene proxy, so the chunk is visible
+	SectionApplied,
+	// The collision section's cook finished and the chunk can be traced against, not just when the section was set
+	CollisionCooked,
+	Count UMETA(Hidden)
+};
+
+/*
+	Timestamps of a single chunk load, times are FPlatformTime::Seconds and 0 if the event hasn't happened
+*/
+struct FChunkLifecycle {
+	int32 TraceId = INDEX_NONE;
+	FVector2D ChunkLocation;
+	EChunkQuality ChunkQuality = EChunkQuality::Low;
+	double Timestamps[(int)EChunkLifecycleEvent::Count] = {};
+
+	bool HasEvent(EChunkLifecycleEvent Event) const { return Timestamps[(int)Event] > 0; }
+
+	/*
+		Milliseconds from the request to an event, negative if the event hasn't happened
+	*/
+	double GetLatencyMilliseconds(EChunkLifecycleEvent Event) const;
+};
+
+/*
+	Records the lifecycle of the most recent chunk loads, from the chunk being requested to it being visible and collidable.
+	Events can be marked from any thread
+*/
+class LUMBER_API FChunkLifecycleTracer {
+public:
+	FChunkLifecycleTracer();
+
+	/*
+		Starts tracing a chunk load and marks it as requested, returns the id to mark its later events with
+	*/
+	int32 BeginTrace(FVector2D ChunkLocation, EChunkQuality ChunkQuality);
+
+	/*
+		Marks an event of a traced load, ignored if the trace has already been overwritten by newer loads
+	*/
+	void Mark(int32 TraceId, EChunkLifecycleEvent Event);
+
+	/*
+		Logs p50, p95 and p99 latency from request to every event, per chunk quality
+	*/
+	void LogSummary() const;
+
+	/*
+		Latencies in milliseconds from request to an event of every traced load that has reached it, sorted
+	*/
+	void GetSortedLatencies(EChunkLifecycleEvent Event, TArray<double>& OutLatencies) const;
+
+	/*
+		Writes every traced load as Chrome trace_event JSON, viewable in chrome://tracing or Perfetto.
+		Returns false if the file couldn't be written
+	*/
+	bool ExportChromeTrace(const FString& FilePath) const;
+
+	void Reset();
+
+	static const TCHAR* GetEventName(EChunkLifecycleEvent Event);
+
+	static const TCHAR* GetQualityName(EChunkQuality Quality);
+
+private:
+	void GetLifecycles(TArray<FChunkLifecycle>& OutLifecycles) const;
+
+private:
+	// Ring buffer indexed by trace id, so marking an event never allocates
+	TArray<FChunkLifecycle> Lifecycles;
+	int32 NextTraceId = 0;
+	mutable FCriticalSection LifecyclesLock;
+};
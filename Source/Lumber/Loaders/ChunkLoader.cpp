@@ -10,6 +10,26 @@
 #include "JobHandler.h"
 #include "TreeLoader.h"
 #include "TerrainLoader.h"
+#include "JobGraph.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Paths.h"
+#include "../Lumber.h"
+#include "../LumberDebug.h"
+
+DECLARE_CYCLE_STAT(TEXT("Render chunks"), STAT_Lumber_RenderChunks, STATGROUP_Lumber);
+DECLARE_CYCLE_STAT(TEXT("Load chunk"), STAT_Lumber_LoadChunk, STATGROUP_Lumber);
+DECLARE_CYCLE_STAT(TEXT("Load chunk collision"), STAT_Lumber_LoadChunkCollision, STATGROUP_Lumber);
+DECLARE_CYCLE_STAT(TEXT("Load chunk preview"), STAT_Lumber_LoadChunkPreview, STATGROUP_Lumber);
+
+/*
+	Outputs of the stages of a single chunk load, shared between the stages through the job graph
+*/
+struct FChunkLoadContext {
+	FChunkHeightfield Heightfield;
+	FTerrainChunkMeshData TerrainData;
+	FMeshData CollisionData;
+	TArray<FVector> TreePlacements;
+};
 
 AChunkLoader::AChunkLoader()
 {
@@ -27,11 +47,15 @@ void AChunkLoader::BeginPlay()
 
     ActorToGenerateFrom = GetWorld()->GetFirstPlayerController()->GetPawn();
 	if (ActorToGenerateFrom == nullptr) {
-		GEngine->AddOnScreenDebugMessage(1, 1, FColor::Green, FString("Couldn't find observer actor"));
+		LUMBER_DEBUG_MESSAGE(Chunks, 1, 1, FColor::Green, TEXT("Couldn't find observer actor"));
 	}
 	else {
-		GEngine->AddOnScreenDebugMessage(1, 1, FColor::Green, FString("Found observer actor"));
+		LUMBER_DEBUG_MESSAGE(Chunks, 1, 1, FColor::Green, TEXT("Found observer actor"));
+		CollisionFocusActors.AddUnique(ActorToGenerateFrom);
 	}
+
+	RestartSpawnToCollisionTimer();
+	SET_DWORD_STAT(STAT_LumberResidentChunks, 0);
 }
 
 // Called every frame
@@ -42,18 +66,18 @@ void AChunkLoader::Tick(float DeltaTime)
     if (ActorToGenerateFrom != nullptr) {
         FVector Loc = ActorToGenerateFrom->GetActorLocation();
         ObserverLocation = FVector2D(Loc.X, Loc.Y) - FVector2D(totalChunkSize / 2, totalChunkSize / 2);
-		GEngine->AddOnScreenDebugMessage(1, 1, FColor::Green, ObserverLocation.ToString());
     }
-	else {
-		GEngine->AddOnScreenDebugMessage(1, 1, FColor::Green, FString("Observer is null"));
 
-	}
+    CheckPendingCollisionCooks();
 
     // Check if its time to do a render check and if one isn't already running
     if (GetWorld()->TimeSeconds >= NextChunkRenderCheck && !bCheckingRender) {
         NextChunkRenderCheck = GetWorld()->TimeSeconds + RenderCheckPeriod;
         bCheckingRender = true;
-        RenderChunks(ObserverLocation);
+
+        TArray<FVector2D> CollisionFocusChunks;
+        GetCollisionFocusChunks(&CollisionFocusChunks);
+        RenderChunks(ObserverLocation, CollisionFocusChunks);
     }
 }
 
@@ -61,8 +85,9 @@ void AChunkLoader::Tick(float DeltaTime)
 Renders chunks around a given point on a seperate thread, based on render distance and set LOD distances.
 Algorithm renders chunks in a grid, not from the point of the player
 */
-void AChunkLoader::RenderChunks(FVector2D From) {
-	AsyncTask(BackgroundPriority, [this, From]() {
+void AChunkLoader::RenderChunks(FVector2D From, const TArray<FVector2D>& CollisionFocusChunks) {
+	AsyncTask(BackgroundPriority, [this, From, CollisionFocusChunks]() {
+		LUMBER_SCOPE(LumberLoading, RenderChunks);
 
 		// Stores array of render jobs that need to be run
 		//TArray<TFunction<void()>> Jobs;
@@ -117,6 +142,14 @@ void AChunkLoader::RenderChunks(FVector2D From) {
 
 		}
 
+		// Collision under dynamic actors goes in the priority lane, so it runs before any of the visual work above
+		for (FVector2D FocusChunk : CollisionFocusChunks) {
+			QueueChunkCollision(GetChunk(FocusChunk));
+		}
+
+		// Previews of new chunks are queued first, so every new chunk shows ground before any full quality work starts
+		QueueChunkRefinements();
+
 		Gamemode->GetJobHandler()->RunJobs();
 
 		// finally end algorithm
@@ -137,42 +170,210 @@ void AChunkLoader::QueueChunkLoad(FVector2D ChunkLocation) {
 	int NewChunkIndex = FindOrCreateChunkData(ChunkLocation, NewChunkQuality);
 	Chunks[NewChunkIndex].TerrainRenderState = EChunkRenderState::Rendering;
 	Chunks[NewChunkIndex].ChunkQuality = NewChunkQuality;
+	Chunks[NewChunkIndex].LifecycleTraceId = LifecycleTracer.BeginTrace(ChunkLocation, NewChunkQuality);
+
+	// Show a cheap low quality mesh first if the chunk would take longer to load
+	if (bProgressiveLoad && NewChunkQuality != EChunkQuality::Low) {
+		Gamemode->GetJobHandler()->AddJob([this, NewChunkIndex]() {LoadChunkPreview(NewChunkIndex); }, EJobCategory::Terrain, EJobPriority::Near);
+		ChunksAwaitingRefinement.Add(NewChunkIndex);
+		return;
+	}
+
+	Gamemode->GetJobHandler()->AddJob([this, NewChunkIndex]() {LoadChunk(NewChunkIndex); }, EJobCategory::Terrain, GetJobPriorityForChunk(ChunkLocation));
+}
+
+/*
+Queues the full quality load of chunks that had a preview queued, after every preview
+*/
+void AChunkLoader::QueueChunkRefinements() {
+	for (int ChunkIndex : ChunksAwaitingRefinement) {
+		Gamemode->GetJobHandler()->AddJob([this, ChunkIndex]() {LoadChunk(ChunkIndex); }, EJobCategory::Terrain, GetJobPriorityForChunk(Chunks[ChunkIndex].ChunkLocation));
+	}
+	ChunksAwaitingRefinement.Empty();
+}
+
+void AChunkLoader::QueueChunkCollision(int ChunkIndex) {
+	if (!ChunkValid(ChunkIndex) || Chunks[ChunkIndex].CollisionRenderState != EChunkRenderState::NotRendered) { return; }
+
+	Chunks[ChunkIndex].CollisionRenderState = EChunkRenderState::Rendering;
+	Gamemode->GetJobHandler()->AddJob([this, ChunkIndex]() {LoadChunkCollision(ChunkIndex, EJobPriority::Critical); }, EJobCategory::Collision, EJobPriority::Critical);
+}
+
+/*
+Generates collision for a chunk, then marks it as rendered on the game thread after the collision section has been set
+*/
+void AChunkLoader::LoadChunkCollision(int ChunkDataIndex, EJobPriority UploadPriority) {
+	LUMBER_SCOPE(LumberLoading, LoadChunkCollision);
+
+	FVector2D ChunkCoord = Chunks[ChunkDataIndex].ChunkLocation;
+	Gamemode->GetTerrainLoader()->LoadChunkCollision(ChunkDataIndex, ChunkCoord, IsCriticalChunk(ChunkCoord), UploadPriority);
+	QueueCollisionRendered(ChunkDataIndex, UploadPriority);
+}
+
+/*
+Must be queued with the same priority as the collision upload, so this runs after it. Critical collision is cooked by
+then, the rest is checked each tick until its async cook finishes
+*/
+void AChunkLoader::QueueCollisionRendered(int ChunkDataIndex, EJobPriority UploadPriority) {
+	const FPendingCollisionCook Pending = { ChunkDataIndex, Chunks[ChunkDataIndex].ChunkLocation, Chunks[ChunkDataIndex].LifecycleTraceId };
+
+	Gamemode->GetGameThreadWork().Enqueue(EGameThreadWorkCategory::ChunkState, UploadPriority, [this, Pending]() {
+		PendingCollisionCooks.Add(Pending);
+		CheckPendingCollisionCooks();
+	}, ChunkDataIndex);
+}
+
+void AChunkLoader::CheckPendingCollisionCooks() {
+	for (int i = PendingCollisionCooks.Num() - 1; i >= 0; i--) {
+		const FPendingCollisionCook& Pending = PendingCollisionCooks[i];
+
+		// The chunk was unloaded before its collision finished cooking, its slot may hold another chunk by now
+		if (!ChunkValid(Pending.ChunkIndex) || Chunks[Pending.ChunkIndex].ChunkLocation != Pending.ChunkCoord) {
+			PendingCollisionCooks.RemoveAtSwap(i);
+		}
+		else if (Gamemode->GetTerrainLoader()->HasChunkCollision(Pending.ChunkCoord)) {
+			MarkCollisionCooked(Pending);
+			PendingCollisionCooks.RemoveAtSwap(i);
+		}
+	}
+}
+
+void AChunkLoader::MarkCollisionCooked(const FPendingCollisionCook& Pending) {
+	Chunks[Pending.ChunkIndex].CollisionRenderState = EChunkRenderState::Rendered;
+	LifecycleTracer.Mark(Pending.TraceId, EChunkLifecycleEvent::CollisionCooked);
+
+	if (SpawnToCollisionStartTime >= 0 && Pending.ChunkCoord == GetClosestChunkToPoint(ObserverLocation)) {
+		LastSpawnToCollisionSeconds = FPlatformTime::Seconds() - SpawnToCollisionStartTime;
+		SpawnToCollisionStartTime = -1;
+		UE_LOG(LogTemp, Log, TEXT("Collision under observer ready %.3f seconds after spawn"), LastSpawnToCollisionSeconds);
+	}
+}
+
+void AChunkLoader::GetCollisionFocusChunks(TArray<FVector2D>* FocusChunks) {
+	for (AActor* FocusActor : CollisionFocusActors) {
+		if (!IsValid(FocusActor)) { continue; }
+
+		// Same offset as the observer location, so chunk coordinates line up
+		FVector Loc = FocusActor->GetActorLocation();
+		FVector2D FocusChunk = GetClosestChunkToPoint(FVector2D(Loc.X, Loc.Y) - FVector2D(totalChunkSize / 2, totalChunkSize / 2));
+
+		// The chunk under the actor comes first
+		FocusChunks->AddUnique(FocusChunk);
+		for (int i = -CollisionFocusRadius; i <= CollisionFocusRadius; i++)
+		{
+			for (int j = -CollisionFocusRadius; j <= CollisionFocusRadius; j++)
+			{
+				FocusChunks->AddUnique(FocusChunk + FVector2D(i * totalChunkSize, j * totalChunkSize));
+			}
+		}
+	}
+}
 
-	Gamemode->GetJobHandler()->AddJob([this, NewChunkIndex]() {LoadChunk(NewChunkIndex); });
+void AChunkLoader::RestartSpawnToCollisionTimer() {
+	SpawnToCollisionStartTime = FPlatformTime::Seconds();
+}
+
+void AChunkLoader::GetChunkMemoryUsage(TArray<FChunkMemoryUsage>& OutUsage) {
+	FChunkMemoryReport::Gather(Gamemode, OutUsage);
+}
+
+void AChunkLoader::LoadChunkPreview(int ChunkDataIndex) {
+	LUMBER_SCOPE(LumberLoading, LoadChunkPreview);
+
+	if (bDebugGenerateTerrain) {
+		Gamemode->GetTerrainLoader()->LoadChunkTerrainPreview(ChunkDataIndex, Chunks[ChunkDataIndex].ChunkLocation);
+	}
 }
 
 /*
-Renders a single chunk given the index of the already created chunk data in the chunks array
+Loads a chunk as a graph of stages, given the index of the already created chunk data in the chunks array.
+The heightfield is sampled once and shared by the terrain mesh, collision and tree placement, which run side by side once it is ready.
+Each upload follows its stage, and the chunk is only marked as rendered once every stage has finished
 */
 void AChunkLoader::LoadChunk(int ChunkDataIndex) {
+	LUMBER_SCOPE(LumberLoading, LoadChunk);
 
 	// Extract variables from ChunkData for easy access
 	EChunkQuality ChunkTargetQuality = Chunks[ChunkDataIndex].ChunkQuality;
 	FVector2D ChunkCoord = Chunks[ChunkDataIndex].ChunkLocation;
+	const int32 TraceId = Chunks[ChunkDataIndex].LifecycleTraceId;
+	LifecycleTracer.Mark(TraceId, EChunkLifecycleEvent::JobStarted);
+
+	// Split the work of each stage across threads if the player is waiting on it
+	const bool bParallel = IsCriticalChunk(ChunkCoord);
 
-	// Here's where we would load other data, like terrain, generating trees, buildings, etc.
+	// Low quality chunks are far away, so their game thread work can wait behind nearer chunks
+	EJobPriority UploadPriority = ChunkTargetQuality == EChunkQuality::Low ? EJobPriority::Far : EJobPriority::Near;
+
+	// High quality chunks get collision, unless the priority lane has already picked it up
+	const bool bLoadCollision = bDebugGenerateTerrain && ChunkTargetQuality == EChunkQuality::High && Chunks[ChunkDataIndex].CollisionRenderState == EChunkRenderState::NotRendered;
+	if (bLoadCollision) {
+		Chunks[ChunkDataIndex].CollisionRenderState = EChunkRenderState::Rendering;
+	}
+	if (bDebugGenerateTrees) {
+		Chunks[ChunkDataIndex].TreeRenderState = EChunkRenderState::Rendering;
+	}
+
+	ATerrainLoader* TerrainLoader = Gamemode->GetTerrainLoader();
+	ATreeLoader* TreeLoader = Gamemode->GetTreeLoader();
+	TSharedRef<FChunkLoadContext, ESPMode::ThreadSafe> Context = MakeShared<FChunkLoadContext, ESPMode::ThreadSafe>();
+	TSharedRef<FJobGraph, ESPMode::ThreadSafe> Graph = MakeShared<FJobGraph, ESPMode::ThreadSafe>(Gamemode->GetJobHandler(), GetJobPriorityForChunk(ChunkCoord));
+
+	FJobGraph::FNodeId HeightfieldStage = Graph->AddNode([this, TerrainLoader, Context, ChunkCoord, ChunkTargetQuality, bParallel, TraceId]() {
+		TerrainLoader->GetChunkHeightfield(&Context->Heightfield, ChunkCoord, ChunkTargetQuality, bParallel);
+		LifecycleTracer.Mark(TraceId, EChunkLifecycleEvent::HeightfieldDone);
+	}, EJobCategory::Terrain);
+
+	// Here's where we would load other data, like buildings, etc.
 
-	// Start loading terrain for this chunk
 	if (bDebugGenerateTerrain) {
-		Gamemode->GetTerrainLoader()->LoadChunkTerrain(ChunkDataIndex, ChunkTargetQuality, ChunkCoord);
+		FJobGraph::FNodeId TerrainMeshStage = Graph->AddNode([this, TerrainLoader, Context, bParallel, TraceId]() {
+			TerrainLoader->GetChunkTerrainData(&Context->TerrainData, Context->Heightfield, bParallel);
+			LifecycleTracer.Mark(TraceId, EChunkLifecycleEvent::MeshDone);
+		}, EJobCategory::Terrain, { HeightfieldStage });
+
+		Graph->AddNode([this, TerrainLoader, Context, ChunkDataIndex, UploadPriority, TraceId]() {
+			// The terrain mesh marks the section applied once it commits it to the render thread
+			LifecycleTracer.Mark(TraceId, EChunkLifecycleEvent::UploadQueued);
+			TerrainLoader->UploadChunkTerrain(ChunkDataIndex, MoveTemp(Context->TerrainData), UploadPriority, TraceId);
+		}, EJobCategory::Upload, { TerrainMeshStage });
+	}
+
+	if (bLoadCollision) {
+		// The heightfield of a high quality chunk is already at collision resolution
+		FJobGraph::FNodeId CollisionStage = Graph->AddNode([TerrainLoader, Context, bParallel]() {
+			TerrainLoader->GetChunkRenderData(&Context->CollisionData, Context->Heightfield, EChunkQuality::Collision, bParallel);
+		}, EJobCategory::Collision, { HeightfieldStage });
+
+		Graph->AddNode([this, TerrainLoader, Context, ChunkDataIndex, UploadPriority]() {
+			TerrainLoader->UploadChunkCollision(ChunkDataIndex, Context->CollisionData, UploadPriority);
+			QueueCollisionRendered(ChunkDataIndex, UploadPriority);
+		}, EJobCategory::Upload, { CollisionStage });
 	}
 
-	// Start loading trees for this chunk
 	if (bDebugGenerateTrees) {
-		Gamemode->GetTreeLoader()->GenerateTrees(ChunkDataIndex, ChunkCoord);
+		FJobGraph::FNodeId TreePlacementStage = Graph->AddNode([TreeLoader, Context]() {
+			TreeLoader->GetTreePlacements(&Context->TreePlacements, Context->Heightfield);
+		}, EJobCategory::Tree, { HeightfieldStage });
+
+		Graph->AddNode([TreeLoader, Context, ChunkDataIndex, ChunkTargetQuality]() {
+			TreeLoader->SpawnTrees(ChunkDataIndex, ChunkTargetQuality, MoveTemp(Context->TreePlacements));
+		}, EJobCategory::Upload, { TreePlacementStage });
 	}
 
-	// Set material on the game thread and set thte chunk data to be set as rendered
-	AsyncTask(GamePriority, [this, ChunkDataIndex]() {
-		Gamemode->GetTerrainLoader()->Mesh->SetMaterial(ChunkDataIndex, TerrainMaterial);
-		Chunks[ChunkDataIndex].TerrainRenderState = EChunkRenderState::Rendered;
+	// Queued at the same priority as the uploads, so the chunk is marked as rendered after they have run
+	Graph->SetOnCompleted([this, ChunkDataIndex, UploadPriority]() {
+		Gamemode->GetGameThreadWork().Enqueue(EGameThreadWorkCategory::ChunkState, UploadPriority, [this, ChunkDataIndex]() {
+			Chunks[ChunkDataIndex].TerrainRenderState = EChunkRenderState::Rendered;
+			NumChunksLoaded++;
+		}, ChunkDataIndex);
 	});
-}
-
 
+	Graph->Launch();
+}
 
 void AChunkLoader::LoadChunkTrees(int ChunkDataIndex, EChunkQuality ChunkTargetQuality, FVector2D ChunkCoord) {
-	Gamemode->GetTreeLoader()->GenerateTrees(ChunkDataIndex, ChunkCoord);
+	Gamemode->GetTreeLoader()->GenerateTrees(ChunkDataIndex, ChunkTargetQuality, ChunkCoord);
 }
 
 void AChunkLoader::LoadChunkBuildings() {
@@ -181,7 +382,22 @@ void AChunkLoader::LoadChunkBuildings() {
 
 void AChunkLoader::OnFinishLoadedChunkTrees(int ChunkDataIndex)
 {
+	if (ChunkValid(ChunkDataIndex)) {
+		Chunks[ChunkDataIndex].TreeRenderState = EChunkRenderState::Rendered;
+	}
+}
 
+/*
+Returns if every part of a chunk has finished loading, not just its terrain
+*/
+bool AChunkLoader::IsChunkFullyLoaded(int ChunkIndex) {
+	if (!ChunkValid(ChunkIndex)) { return false; }
+
+	const FChunkRenderData& Chunk = Chunks[ChunkIndex];
+	return Chunk.TerrainRenderState == EChunkRenderState::Rendered
+		&& Chunk.CollisionRenderState != EChunkRenderState::Rendering
+		&& Chunk.TreeRenderState != EChunkRenderState::Rendering
+		&& Chunk.BuildingsRenderState != EChunkRenderState::Rendering;
 }
 
 /*
@@ -199,11 +415,25 @@ void AChunkLoader::ReloadChunk(FVector2D ChunkLocation) {
 
 void AChunkLoader::ReloadChunk(int ChunkIndex) {
 	if(ChunkValid(ChunkIndex)){
+		EChunkQuality OldChunkQuality = Chunks[ChunkIndex].ChunkQuality;
 		EChunkQuality NewChunkQuality = GetTargetLODForChunk(Chunks[ChunkIndex].ChunkLocation);
 		Chunks[ChunkIndex].TerrainRenderState = EChunkRenderState::Rendering;
 		Chunks[ChunkIndex].ChunkQuality = NewChunkQuality;
+		Chunks[ChunkIndex].LifecycleTraceId = LifecycleTracer.BeginTrace(Chunks[ChunkIndex].ChunkLocation, NewChunkQuality);
+
+		// Lowering the quality of a chunk only saves memory, so it is dropped if the workers are too busy,
+		// and the chunk goes back to its old quality to be retried on a later render check
+		if (NewChunkQuality < OldChunkQuality) {
+			Gamemode->GetJobHandler()->AddJob([this, ChunkIndex]() {LoadChunk(ChunkIndex); }, EJobCategory::Terrain, EJobPriority::Speculative, RenderCheckPeriod * 2, [this, ChunkIndex, OldChunkQuality]() {
+				Gamemode->GetGameThreadWork().Enqueue(EGameThreadWorkCategory::ChunkState, EJobPriority::Near, [this, ChunkIndex, OldChunkQuality]() {
+					Chunks[ChunkIndex].ChunkQuality = OldChunkQuality;
+					Chunks[ChunkIndex].TerrainRenderState = EChunkRenderState::Rendered;
+				}, ChunkIndex);
+			});
+			return;
+		}
 
-		Gamemode->GetJobHandler()->AddJob([this, ChunkIndex]() {LoadChunk(ChunkIndex); });
+		Gamemode->GetJobHandler()->AddJob([this, ChunkIndex]() {LoadChunk(ChunkIndex); }, EJobCategory::Terrain, GetJobPriorityForChunk(Chunks[ChunkIndex].ChunkLocation));
 	}
 }
 
@@ -250,6 +480,21 @@ EChunkQuality AChunkLoader::GetTargetLODForChunk(FVector2D ChunkLocation) {
 }
 
 
+/*
+Returns if a chunk is close enough to the observer that its generation should use multiple threads,
+other chunks run one job per chunk so they don't take workers away from each other
+*/
+bool AChunkLoader::IsCriticalChunk(FVector2D ChunkLocation) {
+	FVector2D ChunkOffset = (ChunkLocation - GetClosestChunkToPoint(ObserverLocation)) / totalChunkSize;
+	return FMath::Abs(ChunkOffset.X) <= ParallelGenerationRadius && FMath::Abs(ChunkOffset.Y) <= ParallelGenerationRadius;
+}
+
+/*
+Returns the job priority for loading a chunk, low quality chunks are far from the observer
+*/
+EJobPriority AChunkLoader::GetJobPriorityForChunk(FVector2D ChunkLocation) {
+	return GetTargetLODForChunk(ChunkLocation) == EChunkQuality::Low ? EJobPriority::Far : EJobPriority::Near;
+}
 
 /*
 Deletes a chunk given its index, by setting the ChunkIndex variable in the data at given index to -1, and
@@ -257,14 +502,14 @@ clearing the mesh section of that index.
 */
 void AChunkLoader::DeleteChunkAtIndex(int ChunkIndex) {
 	if (ChunkValid(ChunkIndex)) {
-		AsyncTask(GamePriority, [this, ChunkIndex]() {
-			Gamemode->GetTerrainLoader()->Mesh->ClearMeshSection(ChunkIndex);
-			if (Chunks[ChunkIndex].ChunkQuality == EChunkQuality::High) {
-				Gamemode->GetTerrainLoader()->CollisionMesh->ClearMeshSection(ChunkIndex);
-			}
-		});
+		Gamemode->GetGameThreadWork().Enqueue(EGameThreadWorkCategory::TerrainUpload, EJobPriority::Near, [this, ChunkIndex]() {
+			Gamemode->GetTerrainLoader()->Mesh->ClearChunkSection(ChunkIndex);
+			Gamemode->GetTerrainLoader()->CollisionMesh->ClearMeshSection(ChunkIndex);
+			Gamemode->GetTreeLoader()->RemoveChunkTrees(ChunkIndex);
+		}, ChunkIndex);
 
 		Chunks[ChunkIndex].ChunkIndex = -1;
+		DEC_DWORD_STAT(STAT_LumberResidentChunks);
 	}
 }
 
@@ -355,6 +600,7 @@ Replaces the first old chunk data with an index of -1 with the new data, otherwi
 Returns index of the newly added data
 */
 int AChunkLoader::AddNewChunkData(FChunkRenderData NewData) {
+	FScopeLock Lock(&ChunksLock);
 
 	// Go through array and replace the first chunk data with an index of -1, with the new data
 	for (int i = 0; i < Chunks.Num(); i++)
@@ -369,6 +615,19 @@ int AChunkLoader::AddNewChunkData(FChunkRenderData NewData) {
 	return Chunks.Add(NewData);
 }
 
+void AChunkLoader::GetChunksSnapshot(TArray<FChunkRenderData>& OutChunks) const {
+	FScopeLock Lock(&ChunksLock);
+	OutChunks = Chunks;
+}
+
+bool AChunkLoader::GetChunkLocation(int ChunkIndex, FVector2D& OutLocation) const {
+	FScopeLock Lock(&ChunksLock);
+	if (!Chunks.IsValidIndex(ChunkIndex) || Chunks[ChunkIndex].ChunkIndex == -1) { return false; }
+
+	OutLocation = Chunks[ChunkIndex].ChunkLocation;
+	return true;
+}
+
 /*
 Checks if there is a valid chunk stored in the chunks array at given index
 Must not be of chunk index -1 and should within array bounds
@@ -410,7 +669,7 @@ int AChunkLoader::DesignateChunkIndex(FVector2D ChunkLocation, EChunkQuality Chu
 	NewChunkData.ChunkQuality = ChunkQuality;
 	int DesignatedIndex = AddNewChunkData(NewChunkData);
 	Chunks[DesignatedIndex].ChunkIndex = DesignatedIndex;
-	GEngine->AddOnScreenDebugMessage(FMath::Rand(), RenderCheckPeriod * 2, FColor::MakeRandomColor(), FString("Designated ") + ChunkLocation.ToString() + FString(" at ") + FString::FromInt(DesignatedIndex));
+	INC_DWORD_STAT(STAT_LumberResidentChunks);
 
 	return DesignatedIndex;
 }
@@ -461,3 +720,44 @@ void AChunkLoader::SaveFile(FString FileAddress)
 {
 	//FFileHelper::LoadFileToArray()
 }
+
+static FAutoConsoleCommandWithWorldAndArgs ChunkLifecycleStatsCommand(
+	TEXT("Lumber.Chunks.LifecycleStats"),
+	TEXT("Logs p50, p95 and p99 latency from a chunk being requested to each stage of its load, per chunk quality"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		ALumberGameMode* LumberGameMode = World != nullptr ? World->GetAuthGameMode<ALumberGameMode>() : nullptr;
+		if (LumberGameMode != nullptr && LumberGameMode->GetChunkLoader() != nullptr) {
+			LumberGameMode->GetChunkLoader()->GetLifecycleTracer().LogSummary();
+		}
+	})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs ChunkLifecycleTraceCommand(
+	TEXT("Lumber.Chunks.ExportTrace"),
+	TEXT("Writes the traced chunk loads as a Chrome trace. Optional argument: file path, defaults to the profiling directory"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		ALumberGameMode* LumberGameMode = World != nullptr ? World->GetAuthGameMode<ALumberGameMode>() : nullptr;
+		if (LumberGameMode == nullptr || LumberGameMode->GetChunkLoader() == nullptr) { return; }
+
+		const FString FilePath = Args.Num() > 0 ? Args[0] : FPaths::ProfilingDir() / FString::Printf(TEXT("LumberChunks-%s.json"), *FDateTime::Now().ToString());
+		if (LumberGameMode->GetChunkLoader()->GetLifecycleTracer().ExportChromeTrace(FilePath)) {
+			UE_LOG(LogTemp, Log, TEXT("Wrote chunk lifecycle trace to %s"), *FilePath);
+		}
+		else {
+			UE_LOG(LogTemp, Error, TEXT("Failed to write chunk lifecycle trace to %s"), *FilePath);
+		}
+	})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs ChunkMemoryCommand(
+	TEXT("Lumber.Chunks.Memory"),
+	TEXT("Logs the memory held by resident chunks by category, and the heaviest chunks. Optional argument: number of chunks to list, defaults to 10"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		ALumberGameMode* LumberGameMode = World != nullptr ? World->GetAuthGameMode<ALumberGameMode>() : nullptr;
+		if (LumberGameMode == nullptr || LumberGameMode->GetChunkLoader() == nullptr) { return; }
+
+		TArray<FChunkMemoryUsage> Usage;
+		LumberGameMode->GetChunkLoader()->GetChunkMemoryUsage(Usage);
+		FChunkMemoryReport::Log(Usage, Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10);
+	})
+);
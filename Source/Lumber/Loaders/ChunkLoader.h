@@ -8,6 +8,9 @@
 #include "Loader.h"
 #include "../LumberGameMode.h"
 #include "ProceduralMeshComponent.h"
+#include "JobSystem.h"
+#include "ChunkLifecycleTracer.h"
+#include "ChunkMemoryReport.h"
 #include "ChunkLoader.generated.h"
 
 #define MAX_CHUNKS 5000
@@ -62,6 +65,32 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	int LowLODCutoffDist = 3;
 
+	// Chunks within this many chunks of the observer's chunk have their generation split across worker threads,
+	// so the ground under the player after spawning or teleporting is ready as soon as possible
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int ParallelGenerationRadius = 1;
+
+	// New chunks first show a low quality mesh, which is then replaced by the target quality once that has been generated
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bProgressiveLoad = true;
+
+	// Actors that need collision under them, the chunks under and adjacent to these actors have their collision
+	// loaded in the job handler's priority lane before any visual work. The observer is added on begin play
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<AActor*> CollisionFocusActors;
+
+	// How many chunks around each collision focus actor are loaded in the priority lane
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int CollisionFocusRadius = 1;
+
+	// Seconds between the observer spawning (or RestartSpawnToCollisionTimer being called) and collision existing under them, -1 until measured
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float LastSpawnToCollisionSeconds = -1;
+
+	// Chunk loads that have finished since begin play, including reloads at a new quality
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int NumChunksLoaded = 0;
+
 private:
 	// Generates chunks from this point
 	AActor* ActorToGenerateFrom;
@@ -72,6 +101,27 @@ private:
 	// Stores chunks as pairs of their location (for unrendering) and their index, which correspond to the ProceduralMeshComponent's Mesh Section Index
 	TArray<FChunkRenderData> Chunks;
 
+	// Held while a slot is added or replaced, and while the chunks are copied for the game thread
+	mutable FCriticalSection ChunksLock;
+
+	// New chunks that have had their preview queued this render check, and still need their full quality load queued
+	TArray<int> ChunksAwaitingRefinement;
+
+	// Chunk whose collision section has been set, waiting for its collision to be cooked
+	struct FPendingCollisionCook {
+		int ChunkIndex;
+		FVector2D ChunkCoord;
+		int32 TraceId;
+	};
+
+	// Collision sections still being cooked asynchronously, checked every tick on the game thread
+	TArray<FPendingCollisionCook> PendingCollisionCooks;
+
+	// Time the spawn to collision measurement started, negative when not measuring
+	double SpawnToCollisionStartTime = -1;
+
+	FChunkLifecycleTracer LifecycleTracer;
+
 	//Debug switches to turn on or off features
 	bool bDebugGenerateTrees = false;
 	bool bDebugGenerateTerrain = true;
@@ -83,7 +133,7 @@ public:
 
 	virtual void BeginPlay();
 
-	void RenderChunks(FVector2D From);
+	void RenderChunks(FVector2D From, const TArray<FVector2D>& CollisionFocusChunks);
 
 	void QueueChunkLoad(FVector2D ChunkLocation);
 
@@ -97,10 +147,66 @@ public:
 
 	EChunkQuality GetTargetLODForChunk(FVector2D ChunkLocation);
 
+	bool IsCriticalChunk(FVector2D ChunkLocation);
+
+	EJobPriority GetJobPriorityForChunk(FVector2D ChunkLocation);
+
 	void DeleteChunkAtIndex(int ChunkIndex);
 
 	void LoadChunk(int ChunkDataIndex);
 
+	/*
+		Uploads a low quality preview of a new chunk, the chunk stays in the rendering state until LoadChunk finishes it
+	*/
+	void LoadChunkPreview(int ChunkDataIndex);
+
+	void QueueChunkRefinements();
+
+	/*
+		Queues collision for a chunk in the job handler's priority lane, if it hasn't already got collision
+	*/
+	void QueueChunkCollision(int ChunkIndex);
+
+	void LoadChunkCollision(int ChunkDataIndex, EJobPriority UploadPriority);
+
+	void QueueCollisionRendered(int ChunkDataIndex, EJobPriority UploadPriority);
+
+	/*
+		Marks chunks whose collision has finished its async cook as rendered, game thread only
+	*/
+	void CheckPendingCollisionCooks();
+
+	void MarkCollisionCooked(const FPendingCollisionCook& Pending);
+
+	/*
+		Returns the chunks under and around every collision focus actor, must be called on the game thread
+	*/
+	void GetCollisionFocusChunks(TArray<FVector2D>* FocusChunks);
+
+	/*
+		Starts measuring the time until collision exists under the observer again, eg after a teleport or respawn
+	*/
+	UFUNCTION(BlueprintCallable)
+	void RestartSpawnToCollisionTimer();
+
+	FChunkLifecycleTracer& GetLifecycleTracer() { return LifecycleTracer; }
+
+	/*
+		Copies every chunk slot, including empty ones. The render check's background task can add slots and reallocate
+		the array at any time, so the game thread reads the chunks through a copy rather than the array itself
+	*/
+	void GetChunksSnapshot(TArray<FChunkRenderData>& OutChunks) const;
+
+	/*
+		Returns if a slot holds a chunk, and the chunk's location if it does. Safe while the render check adds slots
+	*/
+	bool GetChunkLocation(int ChunkIndex, FVector2D& OutLocation) const;
+
+	/*
+		Measures the memory held by each resident chunk's terrain, collision and trees, must be called on the game thread
+	*/
+	void GetChunkMemoryUsage(TArray<FChunkMemoryUsage>& OutUsage);
+
 
 
 	void GetNearestChunks(TArray<FVector2D>* NearestChunks);
@@ -146,6 +252,13 @@ public:
 	*/
 	void OnFinishLoadedChunkTrees(int ChunkDataIndex);
 
+	/*
+		Returns if chunk loads spawn trees
+	*/
+	bool IsGeneratingTrees() const { return bDebugGenerateTrees; }
+
+	bool IsChunkFullyLoaded(int ChunkIndex);
+
 public:
 	AChunkLoader();
 
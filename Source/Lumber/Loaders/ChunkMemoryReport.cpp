@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ChunkMemoryReport.h"
+#include "EngineUtils.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "ProceduralMeshComponent.h"
+#include "../LumberGameMode.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "../TreeClasses/Tree.h"
+#include "../TreeClasses/TreeArchetypeLibrary.h"
+#include "../TreeClasses/TreeRoot.h"
+#include "ChunkLoader.h"
+#include "TerrainLoader.h"
+#include "TreeLoader.h"
+
+void FChunkMemoryUsage::Add(const FChunkMemoryUsage& Other) {
+	TerrainBytes += Other.TerrainBytes;
+	CollisionBytes += Other.CollisionBytes;
+	TreeRootBytes += Other.TreeRootBytes;
+	TreeMeshBytes += Other.TreeMeshBytes;
+	SkeletonBytes += Other.SkeletonBytes;
+	TreeLogBytes += Other.TreeLogBytes;
+	TreeInstanceBytes += Other.TreeInstanceBytes;
+	ArchetypeMeshBytes += Other.ArchetypeMeshBytes;
+	NumTreeRoots += Other.NumTreeRoots;
+	NumSkeletons += Other.NumSkeletons;
+	NumTreeLogs += Other.NumTreeLogs;
+	NumTreeInstances += Other.NumTreeInstances;
+	NumArchetypeMeshes += Other.NumArchetypeMeshes;
+}
+
+SIZE_T FChunkMemoryReport::GetProcMeshBytes(const UProceduralMeshComponent* ProcMesh) {
+	if (ProcMesh == nullptr) { return 0; }
+
+	SIZE_T Bytes = ProcMesh->GetClass()->GetStructureSize();
+	for (int32 SectionIndex = 0; SectionIndex < ProcMesh->GetNumSections(); SectionIndex++) {
+		const FProcMeshSection* Section = const_cast<UProceduralMeshComponent*>(ProcMesh)->GetProcMeshSection(SectionIndex);
+		Bytes += Section->ProcVertexBuffer.GetAllocatedSize() + Section->ProcIndexBuffer.GetAllocatedSize();
+	}
+	return Bytes;
+}
+
+SIZE_T FChunkMemoryReport::GetMeshInfoBytes(const FProcMeshInfo& MeshInfo) {
+	return MeshInfo.Vertices.GetAllocatedSize() + MeshInfo.Triangles.GetAllocatedSize() + MeshInfo.Normals.GetAllocatedSize()
+		+ MeshInfo.UVs.GetAllocatedSize() + MeshInfo.Colors.GetAllocatedSize() + MeshInfo.MeshTangents.GetAllocatedSize();
+}
+
+void FChunkMemoryReport::Gather(ALumberGameMode* Gamemode, TArray<FChunkMemoryUsage>& OutUsage) {
+	check(IsInGameThread());
+	OutUsage.Reset();
+
+	AChunkLoader* ChunkLoader = Gamemode->GetChunkLoader();
+	ATerrainLoader* TerrainLoader = Gamemode->GetTerrainLoader();
+	ATreeLoader* TreeLoader = Gamemode->GetTreeLoader();
+	UProceduralMeshComponent* CollisionMesh = TerrainLoader->CollisionMesh;
+
+	// The collision mesh cooks every section into one body setup, which is shared out by index count
+	SIZE_T CookedCollisionBytes = 0;
+	SIZE_T TotalCollisionIndices = 0;
+	if (CollisionMesh->GetBodySetup() != nullptr) {
+		CookedCollisionBytes = CollisionMesh->GetBodySetup()->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+	}
+	for (int32 SectionIndex = 0; SectionIndex < CollisionMesh->GetNumSections(); SectionIndex++) {
+		TotalCollisionIndices += CollisionMesh->GetProcMeshSection(SectionIndex)->ProcIndexBuffer.Num();
+	}
+
+	// Resident chunks by their index, which is also their section index in both terrain meshes
+	TArray<FChunkRenderData> Chunks;
+	ChunkLoader->GetChunksSnapshot(Chunks);
+	TMap<int32, int32> UsageByChunk;
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ChunkIndex++) {
+		if (Chunks[ChunkIndex].ChunkIndex == -1) { continue; }
+
+		FChunkMemoryUsage& Usage = OutUsage.AddDefaulted_GetRef();
+		Usage.ChunkIndex = ChunkIndex;
+		Usage.ChunkLocation = Chunks[ChunkIndex].ChunkLocation;
+		Usage.ChunkQuality = Chunks[ChunkIndex].ChunkQuality;
+		UsageByChunk.Add(ChunkIndex, OutUsage.Num() - 1);
+
+		if (const FTerrainChunkMeshData* TerrainSection = TerrainLoader->Mesh->GetChunkSection(ChunkIndex)) {
+			Usage.TerrainBytes = sizeof(FTerrainChunkMeshData) + TerrainSection->GetAllocatedSize();
+		}
+
+		if (ChunkIndex < CollisionMesh->GetNumSections()) {
+			const FProcMeshSection* CollisionSection = CollisionMesh->GetProcMeshSection(ChunkIndex);
+			Usage.CollisionBytes = CollisionSection->ProcVertexBuffer.GetAllocatedSize() + CollisionSection->ProcIndexBuffer.GetAllocatedSize();
+			if (TotalCollisionIndices > 0) {
+				Usage.CollisionBytes += CookedCollisionBytes * CollisionSection->ProcIndexBuffer.Num() / TotalCollisionIndices;
+			}
+		}
+
+		if (const FChunkTreeInstances* ChunkTrees = TreeLoader->FindChunkTrees(ChunkIndex)) {
+			for (UHierarchicalInstancedStaticMeshComponent* Instances : ChunkTrees->VariantInstances) {
+				if (Instances == nullptr) { continue; }
+				Usage.NumTreeInstances += Instances->GetInstanceCount();
+				Usage.TreeInstanceBytes += Instances->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+			}
+		}
+	}
+
+	// Trees not spawned for a chunk are kept together at the end
+	const int32 UnassignedIndex = OutUsage.Num();
+	OutUsage.AddDefaulted();
+
+	if (const UTreeArchetypeLibrary* ArchetypeLibrary = TreeLoader->GetArchetypeLibrary()) {
+		TArray<UStaticMesh*> VariantMeshes;
+		ArchetypeLibrary->GetVariantMeshes(VariantMeshes);
+		for (UStaticMesh* VariantMesh : VariantMeshes) {
+			OutUsage[UnassignedIndex].NumArchetypeMeshes++;
+			OutUsage[UnassignedIndex].ArchetypeMeshBytes += VariantMesh->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+		}
+	}
+
+	const auto GetUsage = [&OutUsage, &UsageByChunk, UnassignedIndex](int32 SourceChunk) -> FChunkMemoryUsage& {
+		const int32* UsageIndex = UsageByChunk.Find(SourceChunk);
+		return OutUsage[UsageIndex != nullptr ? *UsageIndex : UnassignedIndex];
+	};
+
+	UWorld* World = Gamemode->GetWorld();
+
+	for (TActorIterator<ATreeRoot> It(World); It; ++It) {
+		ATreeRoot* TreeRoot = *It;
+		FChunkMemoryUsage& Usage = GetUsage(TreeRoot->SourceChunk);
+
+		Usage.NumTreeRoots++;
+		Usage.TreeRootBytes += TreeRoot->GetClass()->GetStructureSize() + GetMeshInfoBytes(TreeRoot->LogMeshInfo) + GetMeshInfoBytes(TreeRoot->LeavesMeshInfo);
+		Usage.TreeMeshBytes += GetProcMeshBytes(TreeRoot->MaskMesh);
+
+		if (TreeRoot->Skeleton.Num() > 0) {
+			Usage.NumSkeletons++;
+			Usage.SkeletonBytes += TreeRoot->Skeleton.GetAllocatedSize();
+		}
+	}
+
+	for (TActorIterator<ATree> It(World); It; ++It) {
+		ATree* TreeLog = *It;
+		FChunkMemoryUsage& Usage = GetUsage(TreeLog->TreeRoot != nullptr ? TreeLog->TreeRoot->SourceChunk : INDEX_NONE);
+
+		Usage.NumTreeLogs++;
+		Usage.TreeLogBytes += TreeLog->GetClass()->GetStructureSize() + GetProcMeshBytes(TreeLog->Mesh) + GetMeshInfoBytes(TreeLog->BranchMeshInfo)
+			+ GetMeshInfoBytes(TreeLog->LeafMeshInfo) + TreeLog->ExistingCuts.GetAllocatedSize();
+	}
+
+	if (OutUsage[UnassignedIndex].GetTotalBytes() == 0) {
+		OutUsage.RemoveAt(UnassignedIndex);
+	}
+}
+
+void FChunkMemoryReport::Log(const TArray<FChunkMemoryUsage>& Usage, int32 NumHeaviest) {
+	const auto ToMB = [](SIZE_T Bytes) { return Bytes / (1024.0 * 1024.0); };
+
+	FChunkMemoryUsage Total;
+	int32 NumChunks = 0;
+	for (const FChunkMemoryUsage& ChunkUsage : Usage) {
+		Total.Add(ChunkUsage);
+		NumChunks += ChunkUsage.ChunkIndex != INDEX_NONE;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Chunk memory: %.2f MB in %d resident chunks, %.2f MB per chunk"),
+		ToMB(Total.GetTotalBytes()), NumChunks, NumChunks > 0 ? ToMB(Total.GetTotalBytes()) / NumChunks : 0);
+	UE_LOG(LogTemp, Log, TEXT("    Terrain sections   %9.2f MB"), ToMB(Total.TerrainBytes));
+	UE_LOG(LogTemp, Log, TEXT("    Collision          %9.2f MB"), ToMB(Total.CollisionBytes));
+	UE_LOG(LogTemp, Log, TEXT("    Tree roots         %9.2f MB in %d"), ToMB(Total.TreeRootBytes), Total.NumTreeRoots);
+	UE_LOG(LogTemp, Log, TEXT("    Tree mesh sections %9.2f MB"), ToMB(Total.TreeMeshBytes));
+	UE_LOG(LogTemp, Log, TEXT("    Tree skeletons     %9.2f MB in %d"), ToMB(Total.SkeletonBytes), Total.NumSkeletons);
+	UE_LOG(LogTemp, Log, TEXT("    Tree logs          %9.2f MB in %d"), ToMB(Total.TreeLogBytes), Total.NumTreeLogs);
+	UE_LOG(LogTemp, Log, TEXT("    Tree instances     %9.2f MB in %d"), ToMB(Total.TreeInstanceBytes), Total.NumTreeInstances);
+	UE_LOG(LogTemp, Log, TEXT("    Archetype meshes   %9.2f MB in %d"), ToMB(Total.ArchetypeMeshBytes), Total.NumArchetypeMeshes);
+
+	TArray<const FChunkMemoryUsage*> Heaviest;
+	for (const FChunkMemoryUsage& ChunkUsage : Usage) {
+		Heaviest.Add(&ChunkUsage);
+	}
+	Heaviest.Sort([](const FChunkMemoryUsage& A, const FChunkMemoryUsage& B) { return A.GetTotalBytes() > B.GetTotalBytes(); });
+
+	UE_LOG(LogTemp, Log, TEXT("Heaviest chunks:      total    terrain  collision  tree root  tree mesh   skeleton  tree logs  instances  archetype"));
+	for (int32 i = 0; i < FMath::Min(NumHeaviest, Heaviest.Num()); i++) {
+		const FChunkMemoryUsage& ChunkUsage = *Heaviest[i];
+		const FString Chunk = ChunkUsage.ChunkIndex != INDEX_NONE
+			? FString::Printf(TEXT("%d (%s)"), ChunkUsage.ChunkIndex, *ChunkUsage.ChunkLocation.ToString())
+			: FString(TEXT("no chunk"));
+		UE_LOG(LogTemp, Log, TEXT("    %-14s %8.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f MB"), *Chunk, ToMB(ChunkUsage.GetTotalBytes()),
+			ToMB(ChunkUsage.TerrainBytes), ToMB(ChunkUsage.CollisionBytes), ToMB(ChunkUsage.TreeRootBytes), ToMB(ChunkUsage.TreeMeshBytes),
+			ToMB(ChunkUsage.SkeletonBytes), ToMB(ChunkUsage.TreeLogBytes), ToMB(ChunkUsage.TreeInstanceBytes), ToMB(ChunkUsage.ArchetypeMeshBytes));
+	}
+}
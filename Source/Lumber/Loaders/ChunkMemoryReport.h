@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Loader.h"
+
+class ALumberGameMode;
+class UProceduralMeshComponent;
+struct FProcMeshInfo;
+
+/*
+	Bytes held by everything that belongs to one resident chunk
+*/
+struct FChunkMemoryUsage {
+	// INDEX_NONE for trees that weren't spawned for a chunk and the meshes every chunk's instances share
+	int32 ChunkIndex = INDEX_NONE;
+	FVector2D ChunkLocation = FVector2D::ZeroVector;
+	EChunkQuality ChunkQuality = EChunkQuality::Low;
+
+	// Packed section of the terrain mesh component
+	SIZE_T TerrainBytes = 0;
+
+	// Collision mesh section, plus the chunk's share of the collision mesh's cooked data by index count
+	SIZE_T CollisionBytes = 0;
+
+	// ATreeRoot actors and the mesh data they keep
+	SIZE_T TreeRootBytes = 0;
+
+	// Sections of the tree roots' MaskMesh
+	SIZE_T TreeMeshBytes = 0;
+
+	// Skeletons of tree roots that are still being meshed or spawned
+	SIZE_T SkeletonBytes = 0;
+
+	// Spawned ATree logs, including their meshes
+	SIZE_T TreeLogBytes = 0;
+
+	// Instanced static mesh components drawing far trees, including their instance buffers
+	SIZE_T TreeInstanceBytes = 0;
+
+	// Static meshes of the tree archetypes, shared by every chunk so only counted without a chunk
+	SIZE_T ArchetypeMeshBytes = 0;
+
+	int32 NumTreeRoots = 0;
+	int32 NumSkeletons = 0;
+	int32 NumTreeLogs = 0;
+	int32 NumTreeInstances = 0;
+	int32 NumArchetypeMeshes = 0;
+
+	SIZE_T GetTotalBytes() const { return TerrainBytes + CollisionBytes + TreeRootBytes + TreeMeshBytes + SkeletonBytes + TreeLogBytes + TreeInstanceBytes + ArchetypeMeshBytes; }
+
+	void Add(const FChunkMemoryUsage& Other);
+};
+
+/*
+	Accounts the memory of resident chunks, so memory budgets can be set per chunk from measurements
+*/
+class LUMBER_API FChunkMemoryReport {
+public:
+	/*
+		Measures every resident chunk, and the trees that don't belong to a chunk as one entry with no chunk index.
+		Walks every tree actor, so game thread only and not meant to run every frame
+	*/
+	static void Gather(ALumberGameMode* Gamemode, TArray<FChunkMemoryUsage>& OutUsage);
+
+	/*
+		Logs the totals by category and the heaviest chunks
+	*/
+	static void Log(const TArray<FChunkMemoryUsage>& Usage, int32 NumHeaviest = 10);
+
+	static SIZE_T GetProcMeshBytes(const UProceduralMeshComponent* ProcMesh);
+
+	static SIZE_T GetMeshInfoBytes(const FProcMeshInfo& MeshInfo);
+};
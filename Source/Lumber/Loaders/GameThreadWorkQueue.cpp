@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GameThreadWorkQueue.h"
+#include "../LumberGameMode.h"
+#include "../Lumber.h"
+
+DECLARE_CYCLE_STAT(TEXT("Game thread work"), STAT_Lumber_GameThreadWork, STATGROUP_Lumber);
+
+FGameThreadWorkQueue::~FGameThreadWorkQueue()
+{
+	Reset();
+}
+
+void FGameThreadWorkQueue::Enqueue(EGameThreadWorkCategory Category, EJobPriority Priority, TFunction<void()> Work, int32 SourceChunk) {
+	FGameThreadWork* NewWork = new FGameThreadWork();
+	NewWork->Work = MoveTemp(Work);
+	NewWork->Category = Category;
+	NewWork->SourceChunk = SourceChunk;
+
+	Stats[(int)Category].NumQueued.fetch_add(1, std::memory_order_relaxed);
+	if (Priority == EJobPriority::Critical) {
+		NumQueuedCritical.fetch_add(1, std::memory_order_relaxed);
+	}
+	Queues[(int)Priority].Enqueue(NewWork);
+}
+
+void FGameThreadWorkQueue::Tick(float BudgetMilliseconds) {
+	check(IsInGameThread());
+	LUMBER_SCOPE(LumberLoading, GameThreadWork);
+
+	for (FGameThreadWorkStats& CategoryStats : Stats) {
+		CategoryStats.NumRunLastFrame = 0;
+		CategoryStats.LastFrameMilliseconds = 0;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+	const double EndTime = StartTime + BudgetMilliseconds / 1000.0;
+	FGameThreadWork* Work = nullptr;
+
+	// Critical work ignores the budget, the player is waiting on it. Only what was queued before this tick runs, so
+	// critical work that queues more critical work can't hold up the frame forever
+	const int32 NumCritical = NumQueuedCritical.load(std::memory_order_relaxed);
+	for (int32 i = 0; i < NumCritical && Queues[(int)EJobPriority::Critical].Dequeue(Work); i++) {
+		NumQueuedCritical.fetch_sub(1, std::memory_order_relaxed);
+		Run(Work);
+	}
+
+	// Always let one piece of work through so a single item bigger than the budget can't stall the queue
+	bool bRanAny = false;
+	for (int i = (int)EJobPriority::Near; i < (int)EJobPriority::Count; i++)
+	{
+		while ((!bRanAny || FPlatformTime::Seconds() < EndTime) && Queues[i].Dequeue(Work)) {
+			Run(Work);
+			bRanAny = true;
+		}
+	}
+
+	LastFrameMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
+
+void FGameThreadWorkQueue::Run(FGameThreadWork* Work) {
+	Stats[(int)Work->Category].NumQueued.fetch_sub(1, std::memory_order_relaxed);
+
+	// Found before the work runs, unloading a chunk frees its slot
+	const TOptional<FVector2D> SourceChunkLocation = FindChunkLocation(Work->SourceChunk);
+
+	const double StartTime = FPlatformTime::Seconds();
+	Work->Work();
+	AddSample(Work->Category, Work->SourceChunk, SourceChunkLocation, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+	delete Work;
+}
+
+void FGameThreadWorkQueue::RecordWork(EGameThreadWorkCategory Category, int32 SourceChunk, double Milliseconds) {
+	AddSample(Category, SourceChunk, FindChunkLocation(SourceChunk), Milliseconds);
+}
+
+TOptional<FVector2D> FGameThreadWorkQueue::FindChunkLocation(int32 SourceChunk) const {
+	FVector2D Location;
+	if (SourceChunk != INDEX_NONE && ChunkLocationLookup && ChunkLocationLookup(SourceChunk, Location)) {
+		return Location;
+	}
+	return {};
+}
+
+void FGameThreadWorkQueue::AddSample(EGameThreadWorkCategory Category, int32 SourceChunk, const TOptional<FVector2D>& SourceChunkLocation, double Milliseconds) {
+	check(IsInGameThread());
+
+	FGameThreadWorkStats& CategoryStats = Stats[(int)Category];
+	CategoryStats.NumRun++;
+	CategoryStats.NumRunLastFrame++;
+	CategoryStats.TotalMilliseconds += Milliseconds;
+	CategoryStats.LastFrameMilliseconds += Milliseconds;
+	CategoryStats.MaxMilliseconds = FMath::Max(CategoryStats.MaxMilliseconds, Milliseconds);
+
+	FrameSamples.Add({ Category, SourceChunk, Milliseconds, SourceChunkLocation });
+}
+
+void FGameThreadWorkQueue::Reset() {
+	for (int i = 0; i < (int)EJobPriority::Count; i++) {
+		FGameThreadWork* Work = nullptr;
+		while (Queues[i].Dequeue(Work)) {
+			Stats[(int)Work->Category].NumQueued.fetch_sub(1, std::memory_order_relaxed);
+			if (i == (int)EJobPriority::Critical) {
+				NumQueuedCritical.fetch_sub(1, std::memory_order_relaxed);
+			}
+			delete Work;
+		}
+	}
+}
+
+int32 FGameThreadWorkQueue::GetNumQueued() const {
+	int32 NumQueued = 0;
+	for (const FGameThreadWorkStats& CategoryStats : Stats) {
+		NumQueued += CategoryStats.NumQueued.load(std::memory_order_relaxed);
+	}
+	return NumQueued;
+}
+
+const TCHAR* FGameThreadWorkQueue::GetCategoryName(EGameThreadWorkCategory Category) {
+	switch (Category)
+	{
+	case EGameThreadWorkCategory::TerrainUpload:
+		return TEXT("TerrainUpload");
+	case EGameThreadWorkCategory::CollisionUpload:
+		return TEXT("CollisionUpload");
+	case EGameThreadWorkCategory::TreeSpawn:
+		return TEXT("TreeSpawn");
+	case EGameThreadWorkCategory::TreeMesh:
+		return TEXT("TreeMesh");
+	case EGameThreadWorkCategory::ChunkState:
+		return TEXT("ChunkState");
+	case EGameThreadWorkCategory::TreeCut:
+		return TEXT("TreeCut");
+	default:
+		return TEXT("Unknown");
+	}
+}
+
+FGameThreadWorkQueue& FGameThreadWorkQueue::Get(const UObject* WorldContextObject) {
+	check(IsInGameThread());
+	ALumberGameMode* Gamemode = WorldContextObject->GetWorld()->GetAuthGameMode<ALumberGameMode>();
+	check(Gamemode != nullptr);
+	return Gamemode->GetGameThreadWork();
+}
+
+FScopedGameThreadWork::FScopedGameThreadWork(FGameThreadWorkQueue& InQueue, EGameThreadWorkCategory InCategory, int32 InSourceChunk)
+	: Queue(InQueue)
+	, Category(InCategory)
+	, SourceChunk(InSourceChunk)
+	, StartTime(FPlatformTime::Seconds())
+{
+}
+
+FScopedGameThreadWork::~FScopedGameThreadWork()
+{
+	Queue.RecordWork(Category, SourceChunk, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
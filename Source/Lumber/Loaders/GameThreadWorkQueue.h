@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Queue.h"
+#include "JobSystem.h"
+#include <atomic>
+#include "GameThreadWorkQueue.generated.h"
+
+/*
+	What a piece of game thread work is for, time spent is accounted per category
+*/
+UENUM()
+enum class EGameThreadWorkCategory : uint8 {
+	TerrainUpload,
+	CollisionUpload,
+	TreeSpawn,
+	TreeMesh,
+	ChunkState,
+	// Not queued, recorded with FScopedGameThreadWork when a tree is cut
+	TreeCut,
+	Count UMETA(Hidden)
+};
+
+/*
+	Time spent on a category of game thread work
+*/
+struct FGameThreadWorkStats {
+	// Work waiting to run, can be read from any thread
+	std::atomic<int32> NumQueued = 0;
+
+	int32 NumRun = 0;
+	int32 NumRunLastFrame = 0;
+	double TotalMilliseconds = 0;
+	double LastFrameMilliseconds = 0;
+	double MaxMilliseconds = 0;
+};
+
+/*
+	A single piece of game thread work that ran this frame, for attributing hitches
+*/
+struct FGameThreadWorkSample {
+	EGameThreadWorkCategory Category;
+
+	// Chunk index the work was for, INDEX_NONE if it wasn't for a chunk
+	int32 SourceChunk;
+
+	double Milliseconds;
+
+	// Location of the chunk in the slot when the work ran, chunk slots are reused so the index alone can't say which chunk it was
+	TOptional<FVector2D> SourceChunkLocation;
+};
+
+/*
+	Queue of work that has to run on the game thread, like creating mesh sections and spawning actors.
+	Work can be queued from any thread, and the game thread only runs as much of it each frame as fits in a millisecond budget,
+	so a burst of ready chunks is spread over several frames instead of being drained by the task graph in one.
+	Critical work queued before a tick always runs in that tick, other work runs in priority order.
+*/
+class LUMBER_API FGameThreadWorkQueue {
+public:
+	~FGameThreadWorkQueue();
+
+	/*
+		Queues work from any thread
+	*/
+	void Enqueue(EGameThreadWorkCategory Category, EJobPriority Priority, TFunction<void()> Work, int32 SourceChunk = INDEX_NONE);
+
+	/*
+		Accounts game thread work that ran outside of the queue, game thread only
+	*/
+	void RecordWork(EGameThreadWorkCategory Category, int32 SourceChunk, double Milliseconds);
+
+	/*
+		Work that has run since the last call to ResetFrameSamples, including work recorded outside of the queue
+	*/
+	const TArray<FGameThreadWorkSample>& GetFrameSamples() const { return FrameSamples; }
+
+	void ResetFrameSamples() { FrameSamples.Reset(); }
+
+	/*
+		Sets how the samples find the location of the chunk in a slot, returning false for an empty slot
+	*/
+	void SetChunkLocationLookup(TFunction<bool(int32 SourceChunk, FVector2D& OutLocation)> Lookup) { ChunkLocationLookup = MoveTemp(Lookup); }
+
+	/*
+		Runs queued work until the budget is used up, at least one piece of work runs if any is queued. Game thread only
+	*/
+	void Tick(float BudgetMilliseconds);
+
+	/*
+		Discards all queued work without running it
+	*/
+	void Reset();
+
+	int32 GetNumQueued() const;
+
+	const FGameThreadWorkStats& GetStats(EGameThreadWorkCategory Category) const { return Stats[(int)Category]; }
+
+	double GetLastFrameMilliseconds() const { return LastFrameMilliseconds; }
+
+	static const TCHAR* GetCategoryName(EGameThreadWorkCategory Category);
+
+	/*
+		Returns the work queue of the game mode of an object's world, game thread only
+	*/
+	static FGameThreadWorkQueue& Get(const UObject* WorldContextObject);
+
+private:
+	struct FGameThreadWork {
+		TFunction<void()> Work;
+		EGameThreadWorkCategory Category;
+		int32 SourceChunk;
+	};
+
+	void Run(FGameThreadWork* Work);
+
+	TOptional<FVector2D> FindChunkLocation(int32 SourceChunk) const;
+
+	void AddSample(EGameThreadWorkCategory Category, int32 SourceChunk, const TOptional<FVector2D>& SourceChunkLocation, double Milliseconds);
+
+private:
+	TQueue<FGameThreadWork*, EQueueMode::Mpsc> Queues[(int)EJobPriority::Count];
+
+	FGameThreadWorkStats Stats[(int)EGameThreadWorkCategory::Count];
+
+	// Counted when the work is queued, a tick only runs the critical work that was queued before it started
+	std::atomic<int32> NumQueuedCritical = 0;
+
+	double LastFrameMilliseconds = 0;
+
+	TArray<FGameThreadWorkSample> FrameSamples;
+
+	TFunction<bool(int32, FVector2D&)> ChunkLocationLookup;
+};
+
+/*
+	Times the rest of the scope as game thread work that doesn't go through the queue, like cutting a tree
+*/
+class LUMBER_API FScopedGameThreadWork {
+public:
+	FScopedGameThreadWork(FGameThreadWorkQueue& InQueue, EGameThreadWorkCategory InCategory, int32 InSourceChunk = INDEX_NONE);
+	~FScopedGameThreadWork();
+
+private:
+	FGameThreadWorkQueue& Queue;
+	EGameThreadWorkCategory Category;
+	int32 SourceChunk;
+	double StartTime;
+};
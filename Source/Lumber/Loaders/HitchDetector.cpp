@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "HitchDetector.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+FHitchDetector::FHitchDetector()
+{
+	LogFilePath = FPaths::ProfilingDir() / TEXT("LumberHitches.log");
+}
+
+void FHitchDetector::EndFrame(FGameThreadWorkQueue& GameThreadWork) {
+	check(IsInGameThread());
+
+	const double Now = FPlatformTime::Seconds();
+	const double FrameMilliseconds = LastFrameEndTime > 0 ? (Now - LastFrameEndTime) * 1000.0 : 0;
+	LastFrameEndTime = Now;
+
+	const TArray<FGameThreadWorkSample>& Samples = GameThreadWork.GetFrameSamples();
+	if (FrameMilliseconds <= HitchThresholdMilliseconds) {
+		GameThreadWork.ResetFrameSamples();
+		return;
+	}
+
+	NumHitches++;
+
+	// Group the frame's work by what it was and which chunk it was for, so a burst of small items shows up as one offender
+	struct FOffender {
+		EGameThreadWorkCategory Category;
+		int32 SourceChunk;
+		TOptional<FVector2D> SourceChunkLocation;
+		double Milliseconds;
+		int32 NumRun;
+	};
+	TArray<FOffender> Offenders;
+	double WorkMilliseconds = 0;
+
+	for (const FGameThreadWorkSample& Sample : Samples) {
+		WorkMilliseconds += Sample.Milliseconds;
+
+		FOffender* Offender = Offenders.FindByPredicate([&Sample](const FOffender& Existing) {
+			return Existing.Category == Sample.Category && Existing.SourceChunk == Sample.SourceChunk && Existing.SourceChunkLocation == Sample.SourceChunkLocation;
+		});
+		if (Offender == nullptr) {
+			Offender = &Offenders.Add_GetRef({ Sample.Category, Sample.SourceChunk, Sample.SourceChunkLocation, 0, 0 });
+		}
+		Offender->Milliseconds += Sample.Milliseconds;
+		Offender->NumRun++;
+	}
+	Offenders.Sort([](const FOffender& A, const FOffender& B) { return A.Milliseconds > B.Milliseconds; });
+
+	FString Report = FString::Printf(TEXT("[%s] Hitch frame %llu: %.1f ms (threshold %.1f), %.1f ms of game thread work in %d items, %d still queued\n"),
+		*FDateTime::Now().ToString(), GFrameCounter, FrameMilliseconds, HitchThresholdMilliseconds, WorkMilliseconds, Samples.Num(), GameThreadWork.GetNumQueued());
+
+	for (int32 i = 0; i < FMath::Min(NumTopOffenders, Offenders.Num()); i++)
+	{
+		const FOffender& Offender = Offenders[i];
+		// Slots are reused as chunks load and unload, the location says which chunk the work was for
+		FString Chunk = TEXT("no chunk");
+		if (Offender.SourceChunkLocation.IsSet()) {
+			Chunk = FString::Printf(TEXT("chunk (%.0f, %.0f) slot %d"), Offender.SourceChunkLocation->X, Offender.SourceChunkLocation->Y, Offender.SourceChunk);
+		}
+		else if (Offender.SourceChunk != INDEX_NONE) {
+			Chunk = FString::Printf(TEXT("unloaded slot %d"), Offender.SourceChunk);
+		}
+		Report += FString::Printf(TEXT("    %-15s %-32s %7.2f ms in %d\n"),
+			FGameThreadWorkQueue::GetCategoryName(Offender.Category), *Chunk, Offender.Milliseconds, Offender.NumRun);
+	}
+
+	UE_LOG(LogTemp, Warning, TEXT("%s"), *Report.TrimEnd());
+	WriteToLogFile(Report);
+
+	GameThreadWork.ResetFrameSamples();
+}
+
+/*
+Appends to the log file, once it grows past the size limit it is moved to a .1 backup, replacing the previous backup
+*/
+void FHitchDetector::WriteToLogFile(const FString& Report) {
+	IFileManager& FileManager = IFileManager::Get();
+
+	if (FileManager.FileSize(*LogFilePath) > MaxLogFileBytes) {
+		const FString BackupPath = FPaths::ChangeExtension(LogFilePath, TEXT("1.log"));
+		FileManager.Move(*BackupPath, *LogFilePath, true);
+	}
+
+	FFileHelper::SaveStringToFile(Report, *LogFilePath, FFileHelper::EEncodingOptions::AutoDetect, &FileManager, FILEWRITE_Append);
+}
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameThreadWorkQueue.h"
+
+/*
+	Attributes frames that take longer than a threshold to the game thread work that ran in them.
+	Each hitch is logged with its biggest offenders by category and source chunk location, and appended to a rolling log file
+*/
+class LUMBER_API FHitchDetector {
+public:
+	FHitchDetector();
+
+	/*
+		Checks the frame that has just finished against the threshold, then starts sampling the next frame. Game thread only.
+		Frames are timed by wall clock between calls, since the engine's delta time is fixed during benchmarks
+	*/
+	void EndFrame(FGameThreadWorkQueue& GameThreadWork);
+
+	int32 GetNumHitches() const { return NumHitches; }
+
+public:
+	float HitchThresholdMilliseconds = 33.3f;
+
+	// Offenders listed per hitch
+	int32 NumTopOffenders = 5;
+
+	// Size the log file can grow to before it is moved aside and a new one started
+	int64 MaxLogFileBytes = 1024 * 1024;
+
+	FString LogFilePath;
+
+private:
+	void WriteToLogFile(const FString& Report);
+
+private:
+	int32 NumHitches = 0;
+
+	double LastFrameEndTime = 0;
+};
@@ -0,0 +1,79 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "JobGraph.h"
+#include "JobHandler.h"
+
+FJobGraph::FJobGraph(AJobHandler* InJobHandler, EJobPriority InPriority)
+	: JobHandler(InJobHandler)
+	, Priority(InPriority)
+{
+}
+
+FJobGraph::FNodeId FJobGraph::AddNode(TFunction<void()> Work, EJobCategory Category, const TArray<FNodeId>& Dependencies) {
+	check(!bLaunched);
+
+	const FNodeId NodeId = Nodes.Num();
+	TUniquePtr<FNode>& NewNode = Nodes.Add_GetRef(MakeUnique<FNode>());
+	NewNode->Work = MoveTemp(Work);
+	NewNode->Category = Category;
+
+	for (FNodeId Dependency : Dependencies) {
+		// Dependencies must already exist, which also rules out cycles
+		check(Nodes.IsValidIndex(Dependency) && Dependency != NodeId);
+		Nodes[Dependency]->Successors.Add(NodeId);
+		NewNode->NumDependencies++;
+	}
+
+	return NodeId;
+}
+
+void FJobGraph::Launch() {
+	check(!bLaunched);
+	bLaunched = true;
+
+	if (Nodes.Num() == 0) {
+		if (OnCompleted) {
+			OnCompleted();
+		}
+		return;
+	}
+
+	NumRemainingNodes.store(Nodes.Num());
+	for (TUniquePtr<FNode>& Node : Nodes) {
+		Node->NumPendingDependencies.store(Node->NumDependencies);
+	}
+
+	// Collect the roots first, a root could finish and release other nodes while still looping
+	TArray<FNodeId> Roots;
+	for (FNodeId NodeId = 0; NodeId < Nodes.Num(); NodeId++)
+	{
+		if (Nodes[NodeId]->NumDependencies == 0) {
+			Roots.Add(NodeId);
+		}
+	}
+	for (FNodeId Root : Roots) {
+		SubmitNode(Root);
+	}
+}
+
+void FJobGraph::SubmitNode(FNodeId NodeId) {
+	JobHandler->SubmitJob([Graph = AsShared(), NodeId]() {
+		Graph->RunNode(NodeId);
+	}, Nodes[NodeId]->Category, Priority);
+}
+
+void FJobGraph::RunNode(FNodeId NodeId) {
+	FNode& Node = *Nodes[NodeId];
+	Node.Work();
+
+	for (FNodeId Successor : Node.Successors) {
+		if (Nodes[Successor]->NumPendingDependencies.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			SubmitNode(Successor);
+		}
+	}
+
+	if (NumRemainingNodes.fetch_sub(1, std::memory_order_acq_rel) == 1 && OnCompleted) {
+		OnCompleted();
+	}
+}
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "JobSystem.h"
+#include <atomic>
+
+class AJobHandler;
+
+/*
+	Directed acyclic graph of jobs. Each node declares the nodes it depends on and is submitted to the job handler
+	as soon as all of them have finished. Nodes are added before Launch, after which the graph can't be changed.
+	Jobs hold a reference to the graph, so it stays alive until its last node has run.
+*/
+class LUMBER_API FJobGraph : public TSharedFromThis<FJobGraph, ESPMode::ThreadSafe> {
+public:
+	typedef int32 FNodeId;
+
+	FJobGraph(AJobHandler* InJobHandler, EJobPriority InPriority);
+
+	FNodeId AddNode(TFunction<void()> Work, EJobCategory Category, const TArray<FNodeId>& Dependencies = TArray<FNodeId>());
+
+	/*
+		Called on the worker that finishes the last node
+	*/
+	void SetOnCompleted(TFunction<void()> InOnCompleted) { OnCompleted = MoveTemp(InOnCompleted); }
+
+	/*
+		Submits every node without dependencies, the rest follow as their dependencies finish
+	*/
+	void Launch();
+
+	int32 GetNumNodes() const { return Nodes.Num(); }
+
+private:
+	void SubmitNode(FNodeId NodeId);
+
+	void RunNode(FNodeId NodeId);
+
+private:
+	struct FNode {
+		TFunction<void()> Work;
+		EJobCategory Category = EJobCategory::Other;
+		TArray<FNodeId> Successors;
+		int32 NumDependencies = 0;
+		std::atomic<int32> NumPendingDependencies = 0;
+	};
+
+	TArray<TUniquePtr<FNode>> Nodes;
+
+	std::atomic<int32> NumRemainingNodes = 0;
+
+	TFunction<void()> OnCompleted;
+
+	AJobHandler* JobHandler;
+
+	EJobPriority Priority;
+
+	bool bLaunched = false;
+};
@@ -2,12 +2,45 @@
 
 
 #include "JobHandler.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "RenderCore.h"
+#include "../LumberGameMode.h"
+#include "../Lumber.h"
+
+DECLARE_CYCLE_STAT(TEXT("Execute job"), STAT_Lumber_ExecuteJob, STATGROUP_Lumber);
 
 // Called when the game starts or when spawned
 void AJobHandler::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// Leave a core for the game thread
+	int WorkerCount = NumWorkers > 0 ? NumWorkers : FMath::Max(FPlatformMisc::NumberOfCoresIncludingHyperthreads() - 1, 1);
+	for (int i = 0; i < WorkerCount; i++)
+	{
+		TUniquePtr<FJobWorker>& NewWorker = Workers.Add_GetRef(MakeUnique<FJobWorker>(this, i));
+		NewWorker->Records.SetNum(FMath::Max(JobRecordsPerWorker, 0));
+	}
+
+	NumActiveWorkers.store(WorkerCount);
+
+	// Workers are only started once all of them exist, since they steal from each other
+	for (TUniquePtr<FJobWorker>& Worker : Workers) {
+		Worker->Start(TPri_BelowNormal);
+	}
+}
+
+void AJobHandler::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	for (TUniquePtr<FJobWorker>& Worker : Workers) {
+		Worker->Shutdown();
+	}
+	DeleteRemainingJobs();
+	Workers.Empty();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -15,53 +48,377 @@ void AJobHandler::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	// The whole frame includes waiting on vsync, which workers taking cores from the game thread don't change
+	const float GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	SmoothedGameThreadMs = FMath::Lerp(SmoothedGameThreadMs, GameThreadMs, FMath::Min(DeltaTime, 1.0f));
+
+	TimeSinceAutotune += DeltaTime;
+	if (TimeSinceAutotune >= AutotuneInterval) {
+		Autotune(TimeSinceAutotune);
+		TimeSinceAutotune = 0;
+	}
+}
+
+float AJobHandler::GetTargetFrameMs() const {
+	if (TargetFrameMs > 0) { return TargetFrameMs; }
+	return 1000.0f / FMath::Max(FPlatformMisc::GetMaxRefreshRate(), 1);
 }
 
 /*
-Add jobs to each batch without exeeding JobsPerBatch variable
+Samples worker utilisation and throughput, then if enabled adjusts the active workers and batch size.
+Workers are taken away straight away when the game thread goes over the target and its margin, and only added back
+one at a time when the game thread is under the target by the margin and there is a backlog the active workers can't keep up with
 */
-void AJobHandler::AddJobs(const TArray<TFunction<void()>>& Jobs) {
-	int NextJobToAdd = 0;
-	int JobBatchIndex = 0;
+void AJobHandler::Autotune(float IntervalSeconds) {
+	const int ActiveWorkers = GetNumActiveWorkers();
 
+	uint64 BusyCycles = 0;
+	for (TUniquePtr<FJobWorker>& Worker : Workers) {
+		BusyCycles += Worker->BusyCycles.exchange(0, std::memory_order_relaxed);
+	}
+	WorkerUtilisation = ActiveWorkers > 0 ? FPlatformTime::ToSeconds64(BusyCycles) / (IntervalSeconds * ActiveWorkers) : 0;
+	JobsCompletedPerSecond = NumCompletedJobs.exchange(0, std::memory_order_relaxed) / IntervalSeconds;
+
+	if (!bAutotune || Workers.Num() == 0) { return; }
+
+	const int QueuedJobs = GetNumQueuedJobs();
+	const int MinWorkers = FMath::Clamp(MinActiveWorkers, 1, Workers.Num());
+	int NewActiveWorkers = ActiveWorkers;
+
+	const float TargetMs = GetTargetFrameMs();
+	const float Margin = FMath::Clamp(TargetFrameMargin, 0.0f, 0.5f);
+
+	if (SmoothedGameThreadMs > TargetMs * (1 + Margin)) {
+		NewActiveWorkers = ActiveWorkers - FMath::Max(ActiveWorkers / 4, 1);
+	}
+	else if (SmoothedGameThreadMs < TargetMs * (1 - Margin) && QueuedJobs > ActiveWorkers && WorkerUtilisation > 0.8f) {
+		NewActiveWorkers = ActiveWorkers + 1;
+	}
+	NewActiveWorkers = FMath::Clamp(NewActiveWorkers, MinWorkers, Workers.Num());
+
+	if (NewActiveWorkers != ActiveWorkers) {
+		NumActiveWorkers.store(NewActiveWorkers, std::memory_order_relaxed);
+		WakeWorkers();
+	}
+
+	// Enough jobs per batch to keep contention on the shared queues low, while leaving several batches per worker to balance
+	JobsPerBatch = FMath::Clamp(QueuedJobs / (NewActiveWorkers * 4), 1, FMath::Max(MaxJobsPerBatch, 1));
+}
+
+void AJobHandler::AddJobs(const TArray<TFunction<void()>>& Jobs) {
 	for (int i = 0; i < Jobs.Num(); i++)
 	{
-		AddJob(Jobs[i]);
+		AddJob(Jobs[i], EJobCategory::Other);
+	}
+}
+
+FLumberJob* AJobHandler::CreateJob(TFunction<void()>&& Job, EJobCategory Category, EJobPriority Priority) {
+	FLumberJob* NewJob = new FLumberJob();
+	NewJob->Work = MoveTemp(Job);
+	NewJob->Completion = MakeShared<FJobCompletion, ESPMode::ThreadSafe>();
+	NewJob->Priority = Priority;
+	NewJob->Category = Category;
+	NewJob->EnqueueTime = FPlatformTime::Seconds();
+	return NewJob;
+}
+
+FJobHandle AJobHandler::AddJob(TFunction<void()> Job, EJobCategory Category, EJobPriority Priority, float DeadlineSeconds, TFunction<void()> OnCancelled) {
+	FLumberJob* NewJob = CreateJob(MoveTemp(Job), Category, Priority);
+	NewJob->OnCancelled = MoveTemp(OnCancelled);
+	NewJob->Deadline = DeadlineSeconds > 0 ? NewJob->EnqueueTime + DeadlineSeconds : 0;
+	FJobHandle Handle = NewJob->Completion;
+
+	PendingJobs[(int)Priority].Push(NewJob);
+	return Handle;
+}
+
+FJobHandle AJobHandler::SubmitJob(TFunction<void()> Job, EJobCategory Category, EJobPriority Priority) {
+	FLumberJob* NewJob = CreateJob(MoveTemp(Job), Category, Priority);
+	FJobHandle Handle = NewJob->Completion;
+	OnJobReleased(NewJob);
+
+	// Critical jobs always go through their shared queue, which every worker checks first
+	FJobWorker* CurrentWorker = FJobWorker::GetCurrent();
+	const bool bOwnWorker = CurrentWorker != nullptr && CurrentWorker->Owner == this;
+	if (!bOwnWorker || Priority == EJobPriority::Critical || !CurrentWorker->Deque.Push(NewJob)) {
+		SharedJobs[(int)Priority].Push(NewJob);
 	}
+
+	WakeWorkers();
+	return Handle;
 }
 
-void AJobHandler::AddJob(TFunction<void()> Job) {
-	for (int i = 0; i < JobBatches.Num(); i++)
+/*
+Counts a job as queued once the workers can take it, must be called before the job is pushed where a worker can see it
+*/
+void AJobHandler::OnJobReleased(FLumberJob* Job) {
+	NumQueuedJobs.fetch_add(1, std::memory_order_relaxed);
+	NumQueuedJobsByCategory[(int)Job->Category].fetch_add(1, std::memory_order_relaxed);
+}
+
+/*
+Moves pending jobs to the queues the workers take from
+*/
+void AJobHandler::RunJobs() {
+	for (int i = 0; i < (int)EJobPriority::Count; i++)
 	{
-		if (JobBatches[i].JobStatus == EJobStatus::NotRunning && JobBatches[i].Jobs.Num() < JobsPerBatch) {
-			JobBatches[i].Jobs.Add(Job);
-			return;
+		while (FLumberJob* Job = PendingJobs[i].Pop()) {
+			OnJobReleased(Job);
+			SharedJobs[i].Push(Job);
 		}
 	}
 
-	FJobBatch NewBatch;
-	NewBatch.Jobs.Add(Job);
-	JobBatches.Add(NewBatch);
+	WakeWorkers();
+}
+
+FLumberJob* AJobHandler::FindJob(FJobWorker* Worker) {
+	// Critical jobs are never batched, so every idle worker can pick one up
+	if (FLumberJob* Job = SharedJobs[(int)EJobPriority::Critical].Pop()) {
+		return Job;
+	}
+
+	// Strict priority order, except every FarJobInterval jobs far jobs go ahead of near jobs
+	Worker->NumSharedJobsTaken++;
+	const bool bFarJobTurn = FarJobInterval > 0 && Worker->NumSharedJobsTaken % FarJobInterval == 0;
+	const EJobPriority Order[] = {
+		bFarJobTurn ? EJobPriority::Far : EJobPriority::Near,
+		bFarJobTurn ? EJobPriority::Near : EJobPriority::Far,
+		EJobPriority::Speculative
+	};
+	for (EJobPriority Priority : Order) {
+		if (FLumberJob* Job = TakeSharedJobs(Worker, Priority)) {
+			return Job;
+		}
+
+		// The worker's own deque can hold a batch of far or speculative jobs, which must not hold up shared near jobs
+		if (Priority == EJobPriority::Near) {
+			if (FLumberJob* Job = Worker->Deque.Pop()) {
+				return Job;
+			}
+		}
+	}
+
+	return StealJob(Worker);
 }
 
 /*
-Runs each batch of jobs on its seperate thread
+Takes a batch from the shared queue of a priority, returning the first job and keeping the rest where other workers can steal them.
+Only one job is taken while the deque still holds jobs, since near jobs are taken ahead of the deque and would otherwise bury it
 */
-void AJobHandler::RunJobs() {
-	for (int i = 0; i < JobBatches.Num(); i++)
+FLumberJob* AJobHandler::TakeSharedJobs(FJobWorker* Worker, EJobPriority Priority) {
+	TLockFreePointerListFIFO<FLumberJob, PLATFORM_CACHE_LINE_SIZE>& Queue = SharedJobs[(int)Priority];
+	FLumberJob* Job = Queue.Pop();
+	if (Job == nullptr) { return nullptr; }
+
+	const int BatchSize = Worker->Deque.Num() == 0 ? JobsPerBatch : 1;
+	int NumTaken = 1;
+	while (NumTaken < BatchSize) {
+		FLumberJob* ExtraJob = Queue.Pop();
+		if (ExtraJob == nullptr) { break; }
+		if (!Worker->Deque.Push(ExtraJob)) {
+			Queue.Push(ExtraJob);
+			break;
+		}
+		NumTaken++;
+	}
+
+	// Let idle workers know there is something to steal
+	if (NumTaken > 1) {
+		WakeWorkers();
+	}
+	return Job;
+}
+
+/*
+Tries to steal the oldest job of every other worker, starting after the thief so workers don't all target the same victim
+*/
+FLumberJob* AJobHandler::StealJob(FJobWorker* Thief) {
+	for (int i = 1; i < Workers.Num(); i++)
+	{
+		FJobWorker* Victim = Workers[(Thief->WorkerIndex + i) % Workers.Num()].Get();
+		if (FLumberJob* Job = Victim->Deque.Steal()) {
+			return Job;
+		}
+	}
+	return nullptr;
+}
+
+/*
+Runs a job, or drops it if it is speculative and has missed its deadline, then records its timings
+*/
+void AJobHandler::ExecuteJob(FJobWorker* Worker, FLumberJob* Job) {
+	LUMBER_SCOPE(LumberLoading, ExecuteJob);
+
+	NumQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	NumQueuedJobsByCategory[(int)Job->Category].fetch_sub(1, std::memory_order_relaxed);
+	NumRunningJobs.fetch_add(1, std::memory_order_relaxed);
+
+	FJobRecord Record;
+	Record.EnqueueTime = Job->EnqueueTime;
+	Record.StartTime = FPlatformTime::Seconds();
+	Record.WorkerIndex = Worker->WorkerIndex;
+	Record.Category = Job->Category;
+	Record.Priority = Job->Priority;
+
+	const bool bMissedDeadline = Job->Deadline > 0 && Record.StartTime > Job->Deadline;
+
+	if (bMissedDeadline && Job->Priority == EJobPriority::Speculative) {
+		if (Job->OnCancelled) {
+			Job->OnCancelled();
+		}
+		FPlatformAtomics::InterlockedIncrement(&NumDroppedJobs);
+		Job->Completion->bCancelled.store(true, std::memory_order_release);
+		Record.Outcome = EJobOutcome::Cancelled;
+	}
+	else {
+		if (bMissedDeadline) {
+			FPlatformAtomics::InterlockedIncrement(&NumMissedDeadlines);
+		}
+		Job->Work();
+	}
+
+	Record.EndTime = FPlatformTime::Seconds();
+	Worker->AddRecord(Record);
+
+	Job->Completion->bCompleted.store(true, std::memory_order_release);
+	NumRunningJobs.fetch_sub(1, std::memory_order_relaxed);
+	NumCompletedJobs.fetch_add(1, std::memory_order_relaxed);
+	delete Job;
+}
+
+void AJobHandler::GetJobRecords(TArray<FJobRecord>& OutRecords) const {
+	for (const TUniquePtr<FJobWorker>& Worker : Workers) {
+		Worker->GetRecords(OutRecords);
+	}
+}
+
+void AJobHandler::LogJobStats() const {
+	TArray<FJobRecord> Records;
+	GetJobRecords(Records);
+
+	UE_LOG(LogTemp, Log, TEXT("Jobs: %d queued, %d active workers of %d, %d per batch, %.1f completed/s, %.0f%% utilisation"),
+		GetNumQueuedJobs(), GetNumActiveWorkers(), GetNumWorkers(), JobsPerBatch, JobsCompletedPerSecond, WorkerUtilisation * 100.0f);
+
+	for (int c = 0; c < (int)EJobCategory::Count; c++)
+	{
+		TArray<double> WaitMilliseconds;
+		TArray<double> RunMilliseconds;
+		int NumCancelled = 0;
+		for (const FJobRecord& Record : Records) {
+			if (Record.Category != (EJobCategory)c) { continue; }
+			WaitMilliseconds.Add(Record.GetWaitMilliseconds());
+			RunMilliseconds.Add(Record.GetRunMilliseconds());
+			NumCancelled += Record.Outcome == EJobOutcome::Cancelled;
+		}
+		WaitMilliseconds.Sort();
+		RunMilliseconds.Sort();
+
+		UE_LOG(LogTemp, Log, TEXT("  %-10s queued %4d  recorded %5d  cancelled %4d  wait ms p50 %7.2f p90 %7.2f p99 %7.2f  run ms p50 %7.2f p90 %7.2f p99 %7.2f"),
+			GetCategoryName((EJobCategory)c), NumQueuedJobsByCategory[c].load(std::memory_order_relaxed), RunMilliseconds.Num(), NumCancelled,
+			GetSortedPercentile(WaitMilliseconds, 50), GetSortedPercentile(WaitMilliseconds, 90), GetSortedPercentile(WaitMilliseconds, 99),
+			GetSortedPercentile(RunMilliseconds, 50), GetSortedPercentile(RunMilliseconds, 90), GetSortedPercentile(RunMilliseconds, 99));
+	}
+}
+
+bool AJobHandler::DumpJobRecordsToCsv(const FString& FilePath) const {
+	TArray<FJobRecord> Records;
+	GetJobRecords(Records);
+	Records.Sort([](const FJobRecord& A, const FJobRecord& B) { return A.EnqueueTime < B.EnqueueTime; });
+
+	FString Csv = TEXT("EnqueueTime,StartTime,EndTime,WaitMs,RunMs,Worker,Category,Priority,Outcome\n");
+	for (const FJobRecord& Record : Records) {
+		Csv += FString::Printf(TEXT("%.6f,%.6f,%.6f,%.3f,%.3f,%d,%s,%d,%s\n"),
+			Record.EnqueueTime, Record.StartTime, Record.EndTime, Record.GetWaitMilliseconds(), Record.GetRunMilliseconds(),
+			Record.WorkerIndex, GetCategoryName(Record.Category), (int)Record.Priority,
+			Record.Outcome == EJobOutcome::Completed ? TEXT("Completed") : TEXT("Cancelled"));
+	}
+
+	return FFileHelper::SaveStringToFile(Csv, *FilePath);
+}
+
+const TCHAR* AJobHandler::GetCategoryName(EJobCategory Category) {
+	switch (Category)
 	{
-		if (JobBatches[i].JobStatus == EJobStatus::NotRunning) {
-			JobBatches[i].JobStatus = EJobStatus::Running;
-
-			AsyncTask(BackgroundPriority, [this, i]() {
-				for (int j = 0; j < JobBatches[i].Jobs.Num(); j++)
-				{
-					// Run the job in this batch
-					JobBatches[i].Jobs[j]();
-				}
-				JobBatches[i].Jobs.Empty();
-				JobBatches[i].JobStatus = EJobStatus::NotRunning;
-				});
+	case EJobCategory::Terrain:
+		return TEXT("Terrain");
+	case EJobCategory::Tree:
+		return TEXT("Tree");
+	case EJobCategory::Upload:
+		return TEXT("Upload");
+	case EJobCategory::Collision:
+		return TEXT("Collision");
+	case EJobCategory::Other:
+		return TEXT("Other");
+	default:
+		return TEXT("Unknown");
+	}
+}
+
+static AJobHandler* GetJobHandlerForWorld(UWorld* World) {
+	ALumberGameMode* LumberGameMode = World != nullptr ? World->GetAuthGameMode<ALumberGameMode>() : nullptr;
+	return LumberGameMode != nullptr ? LumberGameMode->GetJobHandler() : nullptr;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs JobStatsCommand(
+	TEXT("Lumber.Jobs.Stats"),
+	TEXT("Logs job handler queue depth and wait and run time percentiles per job category"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		if (AJobHandler* JobHandler = GetJobHandlerForWorld(World)) {
+			JobHandler->LogJobStats();
+		}
+	})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs JobCsvCommand(
+	TEXT("Lumber.Jobs.DumpCsv"),
+	TEXT("Writes every recorded job to a CSV file. Optional argument: file path, defaults to the profiling directory"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		AJobHandler* JobHandler = GetJobHandlerForWorld(World);
+		if (JobHandler == nullptr) { return; }
+
+		const FString FilePath = Args.Num() > 0 ? Args[0] : FPaths::ProfilingDir() / FString::Printf(TEXT("LumberJobs-%s.csv"), *FDateTime::Now().ToString());
+		if (JobHandler->DumpJobRecordsToCsv(FilePath)) {
+			UE_LOG(LogTemp, Log, TEXT("Wrote job records to %s"), *FilePath);
+		}
+		else {
+			UE_LOG(LogTemp, Error, TEXT("Failed to write job records to %s"), *FilePath);
 		}
+	})
+);
+
+void AJobHandler::WakeWorkers() {
+	for (TUniquePtr<FJobWorker>& Worker : Workers) {
+		Worker->Wake();
 	}
-}
\ No newline at end of file
+}
+
+/*
+Cancels and deletes jobs that never ran, must only be called once the workers have stopped. Anyone waiting on a
+dropped job's handle is released with it cancelled
+*/
+void AJobHandler::DeleteRemainingJobs() {
+	auto CancelJob = [](FLumberJob* Job) {
+		if (Job->OnCancelled) {
+			Job->OnCancelled();
+		}
+		Job->Completion->bCancelled.store(true, std::memory_order_release);
+		Job->Completion->bCompleted.store(true, std::memory_order_release);
+		delete Job;
+	};
+
+	for (int i = 0; i < (int)EJobPriority::Count; i++)
+	{
+		while (FLumberJob* Job = PendingJobs[i].Pop()) {
+			CancelJob(Job);
+		}
+		while (FLumberJob* Job = SharedJobs[i].Pop()) {
+			CancelJob(Job);
+		}
+	}
+
+	for (TUniquePtr<FJobWorker>& Worker : Workers) {
+		while (FLumberJob* Job = Worker->Deque.Pop()) {
+			CancelJob(Job);
+		}
+	}
+}
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "Loader.h"
+#include "JobSystem.h"
+#include "Containers/LockFreeList.h"
 #include "JobHandler.generated.h"
 
 class ALumberGamemode;
@@ -16,14 +18,9 @@ enum EJobStatus {
 	Completed
 };
 
-USTRUCT()
-struct FJobBatch {
-	GENERATED_BODY()
-	TArray<TFunction<void()>> Jobs;
-	EJobStatus JobStatus = EJobStatus::NotRunning;
-};
 /**
- * 
+ * Runs loader jobs on its own pool of worker threads. Every worker owns a work stealing deque,
+ * and jobs can be added from any thread without locking.
  */
 UCLASS()
 class LUMBER_API AJobHandler : public ALoader
@@ -32,23 +29,168 @@ class LUMBER_API AJobHandler : public ALoader
 	
 public:
 	virtual void BeginPlay();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaSeconds) override;
 
 public:
-	// How many render jobs should be run in order at once, less jobs = faster computation & more lag, more jobs = slower computation & less lag
+	// How many jobs a worker takes from the shared queue at once into its own deque, where idle workers can steal them back.
+	// More jobs = less contention on the shared queue, less jobs = work spreads between workers sooner. Set by the autotuner when bAutotune is on
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	int JobsPerBatch = 10;
 
+	// Number of worker threads, 0 uses one less than the number of logical cores
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int NumWorkers = 0;
+
+	// Every this many jobs a worker takes from the shared queues, it takes a far job ahead of near jobs so far chunks never starve
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int FarJobInterval = 4;
+
+	// Jobs that ran after their deadline, speculative jobs are dropped instead and not counted
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int NumMissedDeadlines = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int NumDroppedJobs = 0;
+
+	// Adjusts JobsPerBatch and the number of active workers at runtime, to keep the game thread's time under TargetFrameMs
+	// while loading as many chunks as possible
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bAutotune = true;
+
+	// Game thread time per frame the autotuner aims for, 0 uses the display's refresh period
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float TargetFrameMs = 0;
+
+	// Workers are taken away once the game thread goes this fraction over the target, and only added back once it is
+	// this fraction under it, so a game thread that sits right at the target doesn't flip workers on and off
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float TargetFrameMargin = 0.1f;
+
+	// Seconds between autotuner adjustments
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float AutotuneInterval = 0.5f;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int MinActiveWorkers = 1;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int MaxJobsPerBatch = 32;
+
+	// Fraction of the last autotune interval the active workers spent running jobs
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float WorkerUtilisation = 0;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float JobsCompletedPerSecond = 0;
+
+	// Game thread time smoothed over roughly the last second, without the time spent waiting for the renderer or vsync
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float SmoothedGameThreadMs = 0;
+
+	// How many finished jobs each worker keeps the timings of, 0 turns job telemetry off
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int JobRecordsPerWorker = 4096;
 
 public:
 
 	void AddJobs(const TArray<TFunction<void()>>& Jobs);
 
-	void AddJob(TFunction<void()> Job);
+	/*
+		Adds a job from any thread, it is held back until the next RunJobs.
+		DeadlineSeconds is counted from now, 0 for no deadline. Speculative jobs that miss their deadline
+		run OnCancelled instead of the job. The returned handle is completed once the job has run or been dropped
+	*/
+	FJobHandle AddJob(TFunction<void()> Job, EJobCategory Category, EJobPriority Priority = EJobPriority::Near, float DeadlineSeconds = 0, TFunction<void()> OnCancelled = nullptr);
+
+	/*
+		Adds a job that is released straight away instead of waiting for RunJobs, for work that follows on from a running job.
+		Called from a worker it goes to that worker's own deque, where it stays hot in cache unless another worker steals it
+	*/
+	FJobHandle SubmitJob(TFunction<void()> Job, EJobCategory Category, EJobPriority Priority = EJobPriority::Near);
 
+	/*
+		Releases every job added since the last call to the workers
+	*/
 	void RunJobs();
+
+	int GetNumWorkers() const { return Workers.Num(); }
+
+	/*
+		Workers with an index at or above this are parked by the autotuner
+	*/
+	int GetNumActiveWorkers() const { return NumActiveWorkers.load(std::memory_order_relaxed); }
+
+	/*
+		Jobs released to the workers that haven't started yet
+	*/
+	int GetNumQueuedJobs() const { return NumQueuedJobs.load(std::memory_order_relaxed); }
+
+	/*
+		Jobs a worker is running right now
+	*/
+	int GetNumRunningJobs() const { return NumRunningJobs.load(std::memory_order_relaxed); }
+
+	/*
+		Returns the next job for a worker to run: critical jobs, then a batch of shared near jobs, then its own deque,
+		then a batch from the lower priority shared queues, then a job stolen from another worker
+	*/
+	FLumberJob* FindJob(FJobWorker* Worker);
+
+	void ExecuteJob(FJobWorker* Worker, FLumberJob* Job);
+
+	/*
+		Returns the most recent finished jobs of every worker
+	*/
+	void GetJobRecords(TArray<FJobRecord>& OutRecords) const;
+
+	/*
+		Logs queue depth and wait and run time percentiles per category
+	*/
+	void LogJobStats() const;
+
+	/*
+		Writes every recorded job to a CSV file, returns false if the file couldn't be written
+	*/
+	bool DumpJobRecordsToCsv(const FString& FilePath) const;
+
+	static const TCHAR* GetCategoryName(EJobCategory Category);
+
+private:
+	FLumberJob* TakeSharedJobs(FJobWorker* Worker, EJobPriority Priority);
+
+	FLumberJob* CreateJob(TFunction<void()>&& Job, EJobCategory Category, EJobPriority Priority);
+
+	void OnJobReleased(FLumberJob* Job);
+
+	FLumberJob* StealJob(FJobWorker* Thief);
+
+	void WakeWorkers();
+
+	void DeleteRemainingJobs();
+
+	void Autotune(float IntervalSeconds);
+
+	float GetTargetFrameMs() const;
+
 private:
-	// Stores arrays of array of jobs, which gets processed every tick
-	TArray<FJobBatch> JobBatches;
+	TArray<TUniquePtr<FJobWorker>> Workers;
+
+	std::atomic<int32> NumActiveWorkers = 0;
+
+	std::atomic<int32> NumQueuedJobs = 0;
+
+	std::atomic<int32> NumQueuedJobsByCategory[(int)EJobCategory::Count] = {};
+
+	std::atomic<int32> NumRunningJobs = 0;
+
+	std::atomic<int32> NumCompletedJobs = 0;
+
+	float TimeSinceAutotune = 0;
+
+	// Jobs added since the last RunJobs by priority, so every job queued in a render check is released together
+	TLockFreePointerListFIFO<FLumberJob, PLATFORM_CACHE_LINE_SIZE> PendingJobs[(int)EJobPriority::Count];
 
+	// Released jobs that no worker has taken yet by priority
+	TLockFreePointerListFIFO<FLumberJob, PLATFORM_CACHE_LINE_SIZE> SharedJobs[(int)EJobPriority::Count];
 };
@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "JobSystem.h"
+#include "JobHandler.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+
+static thread_local FJobWorker* CurrentJobWorker = nullptr;
+
+void FJobCompletion::Wait() const {
+	check(!IsInGameThread());
+	while (!IsCompleted()) {
+		FPlatformProcess::Sleep(0.0001f);
+	}
+}
+
+FJobWorker::FJobWorker(AJobHandler* InOwner, int32 InWorkerIndex)
+	: Owner(InOwner)
+	, WorkerIndex(InWorkerIndex)
+{
+	WakeEvent = FPlatformProcess::GetSynchEventFromPool(false);
+}
+
+FJobWorker::~FJobWorker()
+{
+	Shutdown();
+	FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	WakeEvent = nullptr;
+}
+
+void FJobWorker::Start(EThreadPriority Priority) {
+	Thread = FRunnableThread::Create(this, *FString::Printf(TEXT("LumberJobWorker%d"), WorkerIndex), 0, Priority);
+}
+
+void FJobWorker::Shutdown() {
+	if (Thread != nullptr) {
+		Thread->Kill(true);
+		delete Thread;
+		Thread = nullptr;
+	}
+}
+
+void FJobWorker::Wake() {
+	WakeEvent->Trigger();
+}
+
+FJobWorker* FJobWorker::GetCurrent() {
+	return CurrentJobWorker;
+}
+
+uint32 FJobWorker::Run() {
+	CurrentJobWorker = this;
+
+	while (!bStopping.load(std::memory_order_relaxed)) {
+		// Parked by the autotuner, other workers can still steal anything left in this worker's deque
+		if (WorkerIndex >= Owner->GetNumActiveWorkers()) {
+			WakeEvent->Wait(10);
+			continue;
+		}
+
+		FLumberJob* Job = Owner->FindJob(this);
+		if (Job == nullptr) {
+			// Nothing to run or steal, sleep until new jobs are released. The timeout covers a wake that raced the search
+			WakeEvent->Wait(10);
+			continue;
+		}
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		Owner->ExecuteJob(this, Job);
+		BusyCycles.fetch_add(FPlatformTime::Cycles64() - StartCycles, std::memory_order_relaxed);
+	}
+
+	CurrentJobWorker = nullptr;
+	return 0;
+}
+
+void FJobWorker::AddRecord(const FJobRecord& Record) {
+	if (Records.Num() == 0) { return; }
+
+	FScopeLock Lock(&RecordsLock);
+	Records[NextRecord % Records.Num()] = Record;
+	NextRecord++;
+}
+
+void FJobWorker::GetRecords(TArray<FJobRecord>& OutRecords) {
+	FScopeLock Lock(&RecordsLock);
+	const int32 NumRecords = FMath::Min(NextRecord, Records.Num());
+	for (int32 i = NextRecord - NumRecords; i < NextRecord; i++)
+	{
+		OutRecords.Add(Records[i % Records.Num()]);
+	}
+}
+
+void FJobWorker::Stop() {
+	bStopping.store(true, std::memory_order_relaxed);
+	WakeEvent->Trigger();
+}
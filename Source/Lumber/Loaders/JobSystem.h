@@ -0,0 +1,252 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include <atomic>
+#include "JobSystem.generated.h"
+
+class AJobHandler;
+class FEvent;
+class FRunnableThread;
+
+/*
+	Order in which workers pick up jobs, see AJobHandler::FindJob
+*/
+UENUM()
+enum class EJobPriority : uint8 {
+	// The player is waiting on it, eg collision under their feet
+	Critical,
+	// Chunks close to the observer
+	Near,
+	// Chunks far from the observer, still get a share of the workers so they keep progressing
+	Far,
+	// Optional work, dropped if it misses its deadline
+	Speculative,
+	Count UMETA(Hidden)
+};
+
+/*
+	What a job does, used to break down job telemetry
+*/
+UENUM()
+enum class EJobCategory : uint8 {
+	Terrain,
+	Tree,
+	Upload,
+	Collision,
+	Other,
+	Count UMETA(Hidden)
+};
+
+UENUM()
+enum class EJobOutcome : uint8 {
+	Completed,
+	Cancelled
+};
+
+/*
+	Timings of a single job that has finished, times are FPlatformTime::Seconds
+*/
+struct FJobRecord {
+	double EnqueueTime = 0;
+	double StartTime = 0;
+	double EndTime = 0;
+	int32 WorkerIndex = INDEX_NONE;
+	EJobCategory Category = EJobCategory::Other;
+	EJobPriority Priority = EJobPriority::Near;
+	EJobOutcome Outcome = EJobOutcome::Completed;
+
+	double GetWaitMilliseconds() const { return (StartTime - EnqueueTime) * 1000.0; }
+	double GetRunMilliseconds() const { return (EndTime - StartTime) * 1000.0; }
+};
+
+/*
+	Returns the value at a percentile (0-100) of an already sorted array, 0 if it is empty
+*/
+inline double GetSortedPercentile(const TArray<double>& SortedValues, float Percentile)
+{
+	if (SortedValues.Num() == 0) { return 0; }
+	const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile / 100.0f * SortedValues.Num()) - 1, 0, SortedValues.Num() - 1);
+	return SortedValues[Index];
+}
+
+/*
+	Completion state shared between a job and whoever submitted it
+*/
+struct FJobCompletion {
+	std::atomic<bool> bCompleted = false;
+
+	// Set along with bCompleted if the job was dropped instead of run
+	std::atomic<bool> bCancelled = false;
+
+	bool IsCompleted() const { return bCompleted.load(std::memory_order_acquire); }
+
+	bool IsCancelled() const { return bCancelled.load(std::memory_order_acquire); }
+
+	/*
+		Blocks the calling thread until the job has run, must not be called from the game thread
+	*/
+	void Wait() const;
+};
+
+typedef TSharedPtr<FJobCompletion, ESPMode::ThreadSafe> FJobHandle;
+
+/*
+	Single unit of work owned by the job system, deleted once it has run
+*/
+struct FLumberJob {
+	TFunction<void()> Work;
+
+	// Run instead of Work if the job is dropped
+	TFunction<void()> OnCancelled;
+
+	FJobHandle Completion;
+
+	EJobPriority Priority = EJobPriority::Near;
+
+	EJobCategory Category = EJobCategory::Other;
+
+	// FPlatformTime::Seconds after which the job has missed its deadline, 0 for no deadline
+	double Deadline = 0;
+
+	// FPlatformTime::Seconds when the job was added
+	double EnqueueTime = 0;
+};
+
+/*
+	Fixed size Chase-Lev deque. The owning worker pushes and pops at the bottom (newest first),
+	every other worker steals from the top (oldest first) without locking.
+	Push fails when the deque is full, in which case the job should go through the shared queue instead.
+*/
+template<typename ItemType, int32 Capacity>
+class TWorkStealingDeque {
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	/*
+		Owning worker only
+	*/
+	bool Push(ItemType* Item)
+	{
+		const int64 B = Bottom.load(std::memory_order_relaxed);
+		const int64 T = Top.load(std::memory_order_acquire);
+		if (B - T >= Capacity) { return false; }
+
+		Items[B & (Capacity - 1)].store(Item, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		Bottom.store(B + 1, std::memory_order_relaxed);
+		return true;
+	}
+
+	/*
+		Owning worker only, returns nullptr if empty or if the last item was stolen first
+	*/
+	ItemType* Pop()
+	{
+		const int64 B = Bottom.load(std::memory_order_relaxed) - 1;
+		Bottom.store(B, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64 T = Top.load(std::memory_order_relaxed);
+
+		if (T > B) {
+			Bottom.store(B + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		ItemType* Item = Items[B & (Capacity - 1)].load(std::memory_order_relaxed);
+		if (T == B) {
+			// Last item, race any thieves for it
+			if (!Top.compare_exchange_strong(T, T + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+				Item = nullptr;
+			}
+			Bottom.store(B + 1, std::memory_order_relaxed);
+		}
+		return Item;
+	}
+
+	/*
+		Any thread, returns nullptr if empty or if another thread took the item first
+	*/
+	ItemType* Steal()
+	{
+		int64 T = Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		const int64 B = Bottom.load(std::memory_order_acquire);
+		if (T >= B) { return nullptr; }
+
+		ItemType* Item = Items[T & (Capacity - 1)].load(std::memory_order_relaxed);
+		if (!Top.compare_exchange_strong(T, T + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			return nullptr;
+		}
+		return Item;
+	}
+
+	int64 Num() const
+	{
+		return FMath::Max<int64>(Bottom.load(std::memory_order_relaxed) - Top.load(std::memory_order_relaxed), 0);
+	}
+
+private:
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<int64> Top = 0;
+	alignas(PLATFORM_CACHE_LINE_SIZE) std::atomic<int64> Bottom = 0;
+	std::atomic<ItemType*> Items[Capacity] = {};
+};
+
+/*
+	Worker thread of the job handler, runs shared near jobs, then jobs from its own deque, then the other shared queues, then steals from other workers
+*/
+class FJobWorker : public FRunnable {
+public:
+	FJobWorker(AJobHandler* InOwner, int32 InWorkerIndex);
+	virtual ~FJobWorker();
+
+	//~ Begin FRunnable Interface.
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+	//~ End FRunnable Interface.
+
+	void Start(EThreadPriority Priority);
+
+	/*
+		Stops and joins the thread
+	*/
+	void Shutdown();
+
+	void Wake();
+
+	/*
+		Returns the worker running on the calling thread, or nullptr if the caller isn't a worker
+	*/
+	static FJobWorker* GetCurrent();
+
+public:
+	TWorkStealingDeque<FLumberJob, 1024> Deque;
+
+	AJobHandler* Owner;
+	int32 WorkerIndex;
+
+	// Non critical jobs this worker has taken from the shared queues, used to give far jobs their share
+	uint32 NumSharedJobsTaken = 0;
+
+	// Cycles spent running jobs since the job handler last sampled utilisation
+	std::atomic<uint64> BusyCycles = 0;
+
+	// Ring buffer of the most recent jobs this worker has finished, only written by this worker
+	TArray<FJobRecord> Records;
+	int32 NextRecord = 0;
+	FCriticalSection RecordsLock;
+
+	void AddRecord(const FJobRecord& Record);
+
+	/*
+		Copies the records out, oldest first
+	*/
+	void GetRecords(TArray<FJobRecord>& OutRecords);
+
+private:
+	FRunnableThread* Thread = nullptr;
+	FEvent* WakeEvent = nullptr;
+	std::atomic<bool> bStopping = false;
+};
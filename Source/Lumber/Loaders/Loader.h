@@ -34,6 +34,7 @@ struct FChunkRenderData {
 	EChunkRenderState TerrainRenderState = EChunkRenderState::NotRendered;
 	EChunkRenderState TreeRenderState = EChunkRenderState::NotRendered;
 	EChunkRenderState BuildingsRenderState = EChunkRenderState::NotRendered;
+	EChunkRenderState CollisionRenderState = EChunkRenderState::NotRendered;
 
 	FVector2D ChunkLocation;
 
@@ -41,6 +42,9 @@ struct FChunkRenderData {
 
 	int ChunkIndex = -1;
 
+	// Id of the chunk's latest load in the chunk loader's lifecycle tracer
+	int32 LifecycleTraceId = INDEX_NONE;
+
 };
 
 class ALumberGameMode;
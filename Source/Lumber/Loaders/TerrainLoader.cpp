@@ -6,6 +6,15 @@
 #include "TreeLoader.h"
 #include "ProceduralMeshComponent.h"
 #include "ChunkLoader.h"
+#include "Async/ParallelFor.h"
+#include "../Lumber.h"
+
+DECLARE_CYCLE_STAT(TEXT("Get chunk heightfield"), STAT_Lumber_GetChunkHeightfield, STATGROUP_Lumber);
+DECLARE_CYCLE_STAT(TEXT("Get chunk render data"), STAT_Lumber_GetChunkRenderData, STATGROUP_Lumber);
+DECLARE_CYCLE_STAT(TEXT("Get chunk terrain data"), STAT_Lumber_GetChunkTerrainData, STATGROUP_Lumber);
+DECLARE_CYCLE_STAT(TEXT("Create mesh section"), STAT_Lumber_CreateMeshSection, STATGROUP_Lumber);
+DECLARE_CYCLE_STAT(TEXT("Set collision section (GT)"), STAT_Lumber_SetCollisionSection, STATGROUP_Lumber);
+DECLARE_CYCLE_STAT(TEXT("Set terrain section (GT)"), STAT_Lumber_SetTerrainSection, STATGROUP_Lumber);
 
 // Sets default values
 ATerrainLoader::ATerrainLoader()
@@ -13,7 +22,7 @@ ATerrainLoader::ATerrainLoader()
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
-	Mesh = CreateDefaultSubobject<UProceduralMeshComponent>(FName("Mesh"));
+	Mesh = CreateDefaultSubobject<UTerrainMeshComponent>(FName("Mesh"));
     SetRootComponent(Mesh);
 
     CollisionMesh = CreateDefaultSubobject<UProceduralMeshComponent>(FName("CollisionMesh"));
@@ -25,90 +34,92 @@ void ATerrainLoader::BeginPlay()
 {
 	Super::BeginPlay();
 
-	Mesh->bUseAsyncCooking = true;
 	CollisionMesh->bUseAsyncCooking = true;
 
 	
-	// Set random seed for stream
-	Stream.GenerateNewSeed();
-	for (int i = 0; i < 1000; i++)
-	{
-		SeedArray.Add(Stream.RandRange(-1000, 1000));
+	// A seed given before play began, by the game mode or a replay, is kept. Otherwise the world is new every run
+	if (!bHasSeed) {
+		Stream.GenerateNewSeed();
+		SetSeed(Stream.GetInitialSeed());
 	}
 }
 
-void ATerrainLoader::LoadChunkTerrain(int ChunkDataIndex, EChunkQuality ChunkTargetQuality, FVector2D ChunkCoord) {
-
-	// Create mesh data and optional collision data
-	FMeshData NewMeshData;
-	FMeshData NewMeshCollisionData;
-	GetChunkRenderData(&NewMeshData, ChunkCoord, ChunkTargetQuality);
-	if (ChunkTargetQuality == EChunkQuality::High) {
-		GetChunkRenderData(&NewMeshCollisionData, ChunkCoord, EChunkQuality::Collision);
+void ATerrainLoader::SetWorldSettings(const FMyWorldSettings& NewWorldSettings) {
+	LoadedWorldSettings = NewWorldSettings;
+
+	NoiseLayers.Reset(LoadedWorldSettings.MountainLayer.Num());
+	for (const FNoiseLayer& Layer : LoadedWorldSettings.MountainLayer) {
+		LumberCore::FNoiseLayer& CoreLayer = NoiseLayers.AddDefaulted_GetRef();
+		CoreLayer.XScale = Layer.XScale;
+		CoreLayer.YScale = Layer.YScale;
+		CoreLayer.XOffset = Layer.XOffset;
+		CoreLayer.YOffset = Layer.YOffset;
+		CoreLayer.Gain = Layer.Gain;
+		CoreLayer.Operation = Layer.OperationType == EOperationType::Multiplicative ? LumberCore::ENoiseOperation::Multiplicative : LumberCore::ENoiseOperation::Additive;
 	}
+}
 
-	// Create mesh section for the mesh and collision mesh
-	CreateMeshSection(Mesh, ChunkDataIndex, NewMeshData.Vertices, NewMeshData.Triangles, NewMeshData.Normals, NewMeshData.UVs, NewMeshData.Colors, NewMeshData.Tangents, false);
-	if (ChunkTargetQuality == EChunkQuality::High) {
-		CreateMeshSection(CollisionMesh, ChunkDataIndex, NewMeshCollisionData.Vertices, NewMeshCollisionData.Triangles, NewMeshCollisionData.Normals, NewMeshCollisionData.UVs, NewMeshCollisionData.Colors, NewMeshCollisionData.Tangents, true);
+void ATerrainLoader::SetSeed(int32 Seed) {
+	bHasSeed = true;
+	Stream.Initialize(Seed);
+	SeedArray.Reset();
+	for (int i = 0; i < 1000; i++)
+	{
+		SeedArray.Add(Stream.RandRange(-1000, 1000));
 	}
 }
 
-/*
-Returns data for a point using a seed
-*/
-float ATerrainLoader::GetTerrainPointData(FVector2D Point) {
-	int i_Seed = 0;
-	float ResultZ = 0;
-
-	for (const FNoiseLayer Layer : LoadedWorldSettings.MountainLayer) {
-
-		// Stretch or translate point for the perlin noise function
-		FVector2D ProcessedPoint = Point;
-		ProcessedPoint.X = ProcessedPoint.X * Layer.XScale;
-		ProcessedPoint.Y = ProcessedPoint.Y * Layer.YScale;
-		ProcessedPoint.X += Layer.XOffset;
-		ProcessedPoint.Y += Layer.YOffset;
-
-		// Amplify the point
-		float NewResultZ = FMath::PerlinNoise2D(ProcessedPoint);
-		NewResultZ = NewResultZ * Layer.Gain;
-
-		// Operation to the resulting Z point
-		switch (Layer.OperationType.GetValue())
-		{	
-		case Additive:
-			ResultZ += NewResultZ;
-			break;
-		case Multiplicative:
-			ResultZ = ResultZ * NewResultZ;
-			break;
-		default:
-			break;
+void ATerrainLoader::UploadChunkTerrain(int ChunkDataIndex, FTerrainChunkMeshData&& ChunkData, EJobPriority UploadPriority, int32 TraceId) {
+	Gamemode->GetGameThreadWork().Enqueue(EGameThreadWorkCategory::TerrainUpload, UploadPriority, [this, ChunkDataIndex, ChunkData = MoveTemp(ChunkData), TraceId]() mutable {
+		LUMBER_SCOPE(LumberTerrain, SetTerrainSection);
+		Mesh->SetChunkSection(ChunkDataIndex, MoveTemp(ChunkData), false, TraceId);
+		if (Mesh->GetMaterial(0) != Gamemode->TerrainMaterial) {
+			Mesh->SetMaterial(0, Gamemode->TerrainMaterial);
 		}
-	}
+	}, ChunkDataIndex);
+}
 
+void ATerrainLoader::UploadChunkCollision(int ChunkDataIndex, const FMeshData& CollisionData, EJobPriority UploadPriority) {
+	CreateMeshSection(CollisionMesh, ChunkDataIndex, CollisionData.Vertices, CollisionData.Triangles, CollisionData.Normals, CollisionData.UVs, CollisionData.Colors, CollisionData.Tangents, true, UploadPriority);
+}
 
+bool ATerrainLoader::HasChunkCollision(FVector2D ChunkCoord) const {
+	check(IsInGameThread());
 
-	//// Bumps
-	//ResultZ += GetNoiseValueAtPoint(Point, 0.001, &i_Seed) * GetNoiseValueAtPoint(Point, 0.00001, &i_Seed) * 50;
-	//ResultZ += GetNoiseValueAtPoint(Point, 0.00001, &i_Seed) * 5000;
-	//ResultZ += GetNoiseValueAtPoint(Point, 0.0000005, &i_Seed) * 50000;
-	//ResultZ += GetNoiseValueAtPoint(Point, 0.0000005, &i_Seed) * 50000;
+	const float HalfChunkSize = Gamemode->GetChunkLoader()->totalChunkSize / 2.0f;
+	const FVector ChunkMiddle = CollisionMesh->GetComponentTransform().TransformPosition(FVector(ChunkCoord.X + HalfChunkSize, ChunkCoord.Y + HalfChunkSize, 0));
 
-	//// Mountains
-	//ResultZ += GetNoiseValueAtPoint(Point, 0.00005, &i_Seed) * 50000 * GetNoiseValueAtPoint(Point, 0.000004, &i_Seed);
+	FHitResult Hit;
+	return CollisionMesh->LineTraceComponent(Hit, ChunkMiddle + FVector(0, 0, WORLD_MAX), ChunkMiddle - FVector(0, 0, WORLD_MAX), FCollisionQueryParams(SCENE_QUERY_STAT(LumberChunkCollision), true));
+}
 
-	//// Rivers
-	//ResultZ += FMath::Abs(GetNoiseValueAtPoint(Point, 0.000004, &i_Seed)) * 100000;
+void ATerrainLoader::LoadChunkCollision(int ChunkDataIndex, FVector2D ChunkCoord, bool bParallel, EJobPriority UploadPriority) {
+	FMeshData NewMeshCollisionData;
+	GetChunkRenderData(&NewMeshCollisionData, ChunkCoord, EChunkQuality::Collision, bParallel);
+	UploadChunkCollision(ChunkDataIndex, NewMeshCollisionData, UploadPriority);
+}
 
-	//// Mountain peaks
-	//ResultZ += FMath::Abs(GetNoiseValueAtPoint(Point, 0.000004, &i_Seed)) * -60000;
+void ATerrainLoader::LoadChunkTerrainPreview(int ChunkDataIndex, FVector2D ChunkCoord) {
+	FTerrainChunkMeshData NewChunkData;
+	GetChunkTerrainData(&NewChunkData, ChunkCoord, EChunkQuality::Low);
 
+	Gamemode->GetGameThreadWork().Enqueue(EGameThreadWorkCategory::TerrainUpload, EJobPriority::Near, [this, ChunkDataIndex, NewChunkData = MoveTemp(NewChunkData)]() mutable {
+		// The full quality mesh may have already finished, which should never be replaced by the preview
+		const FTerrainChunkMeshData* ExistingSection = Mesh->GetChunkSection(ChunkDataIndex);
+		if (ExistingSection != nullptr && ExistingSection->GetNumVertices() > 0) { return; }
 
-	//ResultZ += GetNoiseValueAtPoint(Point, 0.0000005, &i_Seed) * 1000000;
-	//ResetLookupTable();
-	return ResultZ;
+		Mesh->SetChunkSection(ChunkDataIndex, MoveTemp(NewChunkData), true);
+		if (Mesh->GetMaterial(0) != Gamemode->TerrainMaterial) {
+			Mesh->SetMaterial(0, Gamemode->TerrainMaterial);
+		}
+	}, ChunkDataIndex);
+}
+
+/*
+Returns data for a point using a seed
+*/
+float ATerrainLoader::GetTerrainPointData(FVector2D Point) {
+	return LumberCore::SampleTerrainHeight(NoiseLayers.GetData(), NoiseLayers.Num(), Point.X, Point.Y);
 }
 
 /*
@@ -119,7 +130,8 @@ float ATerrainLoader::GetTerrainPointData(FVector2D Point) {
 Returns value from a perlin noise function, using a seed for point offset
 */
 float ATerrainLoader::GetNoiseValueAtPoint(FVector2D Point, float Frequency, int* i_Seed) {
-	return FMath::PerlinNoise2D((Point + FVector2D(ExtractRandomNumber(i_Seed), ExtractRandomNumber(i_Seed))) * Frequency);
+	const FVector2D NoisePoint = (Point + FVector2D(ExtractRandomNumber(i_Seed), ExtractRandomNumber(i_Seed))) * Frequency;
+	return LumberCore::PerlinNoise2D(NoisePoint.X, NoisePoint.Y);
 }
 
 /*
@@ -132,14 +144,27 @@ int ATerrainLoader::ExtractRandomNumber(int* i_Seed) {
 
 
 /*
-Get mesh data for a chunk at given location and LOD
+Get mesh data for a chunk at given location and LOD.
+With bParallel the vertex and triangle stages are split into row blocks across worker threads.
 */
-void ATerrainLoader::GetChunkRenderData(FMeshData* MeshData, FVector2D ChunkCoord, EChunkQuality Quality)
+void ATerrainLoader::GetChunkRenderData(FMeshData* MeshData, FVector2D ChunkCoord, EChunkQuality Quality, bool bParallel)
 {
-	// Change the quality of the mesh generated
-	int NewChunkSize = Gamemode->GetChunkLoader()->chunkSize;
-	int NewTileSize = Gamemode->GetChunkLoader()->tileSize;
-	Gamemode->GetChunkLoader()->GetChunkSizesFromQuality(Quality, &NewChunkSize, &NewTileSize);
+	FChunkHeightfield Heightfield;
+	GetChunkHeightfield(&Heightfield, ChunkCoord, Quality, bParallel);
+	GetChunkRenderData(MeshData, Heightfield, Quality, bParallel);
+}
+
+/*
+Get mesh data for a chunk from an already sampled heightfield, at the heightfield's resolution
+*/
+void ATerrainLoader::GetChunkRenderData(FMeshData* MeshData, const FChunkHeightfield& Heightfield, EChunkQuality Quality, bool bParallel)
+{
+	LUMBER_SCOPE(LumberTerrain, GetChunkRenderData);
+
+	const int NewChunkSize = Heightfield.GridSize;
+	const int NumRows = NewChunkSize + 1;
+	const EParallelForFlags ParallelFlags = bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+	const int RowsPerBlock = FMath::Max(ParallelRowsPerBlock, 1);
 
 	TArray<FVector> Vertices;
 	TArray<int> Triangles;
@@ -149,45 +174,128 @@ void ATerrainLoader::GetChunkRenderData(FMeshData* MeshData, FVector2D ChunkCoor
 	TArray<FColor> Colors;
 
 	// Add vertices
-	for (int row_i = 0; row_i < NewChunkSize + 1; row_i++) {
-		for (int col_i = 0; col_i < NewChunkSize + 1; col_i++) {
-			FVector2D Point = ChunkCoord + FVector2D(NewTileSize * row_i, NewTileSize * col_i);
-			FVector NewVertex = FVector(Point.X, Point.Y, GetTerrainPointData(Point));
-			Vertices.Add(NewVertex);
+	Vertices.SetNumUninitialized(NumRows * NumRows);
+	ParallelFor(FMath::DivideAndRoundUp(NumRows, RowsPerBlock), [&](int32 Block) {
+		const int EndRow = FMath::Min((Block + 1) * RowsPerBlock, NumRows);
+		for (int row_i = Block * RowsPerBlock; row_i < EndRow; row_i++) {
+			for (int col_i = 0; col_i < NumRows; col_i++) {
+				Vertices[row_i * NumRows + col_i] = Heightfield.GetVertex(row_i, col_i);
+			}
 		}
+	}, ParallelFlags);
+
+	// Add triangles, each tile writes its own six indices so blocks never overlap
+	Triangles.SetNumUninitialized(NewChunkSize * NewChunkSize * 6);
+	ParallelFor(FMath::DivideAndRoundUp(NewChunkSize, RowsPerBlock), [&](int32 Block) {
+		const int EndRow = FMath::Min((Block + 1) * RowsPerBlock, NewChunkSize);
+		LumberCore::BuildGridTriangleRows(NewChunkSize, Block * RowsPerBlock, EndRow, Triangles.GetData());
+	}, ParallelFlags);
+
+	// Collision only uses vertices and triangles
+	if (Quality != EChunkQuality::Collision) {
+		UKismetProceduralMeshLibrary::CalculateTangentsForMesh(Vertices, Triangles, UVs, Normals, Tangents);
 	}
 
-	// Add triangles
-	for (int row_i = 0; row_i < NewChunkSize; row_i++) {
-		for (int col_i = 0; col_i < NewChunkSize; col_i++) {
-			//// Add rightmost triangle
-			Triangles.Add(row_i * (NewChunkSize + 1) + col_i);
-			Triangles.Add(row_i * (NewChunkSize + 1) + col_i + 1);
-			Triangles.Add((row_i + 1) * (NewChunkSize + 1) + col_i + 1);
-
-			//// Add leftmost triangle
-			Triangles.Add(row_i * (NewChunkSize + 1) + col_i);
-			Triangles.Add((row_i + 1) * (NewChunkSize + 1) + col_i + 1);
-			Triangles.Add((row_i + 1) * (NewChunkSize + 1) + col_i);
-		}
-	}
+	MeshData->Vertices = MoveTemp(Vertices);
+	MeshData->UVs = MoveTemp(UVs);
+	MeshData->Colors = MoveTemp(Colors);
+	MeshData->Normals = MoveTemp(Normals);
+	MeshData->Tangents = MoveTemp(Tangents);
+	MeshData->Triangles = MoveTemp(Triangles);
+}
 
-	UKismetProceduralMeshLibrary::CalculateTangentsForMesh(Vertices, Triangles, UVs, Normals, Tangents);
+/*
+Samples the heights of a chunk's vertex grid at given LOD, including a border of one tile on every side.
+With bParallel the rows are split into blocks across worker threads.
+Nearly all of the time is spent sampling noise per point, which is timed here rather than per point so the scope itself doesn't dominate the cost
+*/
+void ATerrainLoader::GetChunkHeightfield(FChunkHeightfield* Heightfield, FVector2D ChunkCoord, EChunkQuality Quality, bool bParallel)
+{
+	LUMBER_SCOPE(LumberTerrain, GetChunkHeightfield);
 
-	MeshData->Vertices = Vertices;
-	MeshData->UVs = UVs;
-	MeshData->Colors = Colors;
-	MeshData->Normals = Normals;
-	MeshData->Tangents = Tangents;
-	MeshData->Triangles = Triangles;
+	// Change the quality of the mesh generated
+	int NewChunkSize = Gamemode->GetChunkLoader()->chunkSize;
+	int NewTileSize = Gamemode->GetChunkLoader()->tileSize;
+	Gamemode->GetChunkLoader()->GetChunkSizesFromQuality(Quality, &NewChunkSize, &NewTileSize);
+
+	const EParallelForFlags ParallelFlags = bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+	const int RowsPerBlock = FMath::Max(ParallelRowsPerBlock, 1);
+
+	Heightfield->ChunkCoord = ChunkCoord;
+	Heightfield->GridSize = NewChunkSize;
+	Heightfield->TileSize = NewTileSize;
+
+	// Keep the height range of the inner vertices of each block
+	const int BorderedSize = Heightfield->GetBorderedSize();
+	const int NumHeightBlocks = FMath::DivideAndRoundUp(BorderedSize, RowsPerBlock);
+	TArray<LumberCore::FHeightRange> BlockHeightRanges;
+	Heightfield->Heights.SetNumUninitialized(BorderedSize * BorderedSize);
+	BlockHeightRanges.SetNum(NumHeightBlocks);
+
+	ParallelFor(NumHeightBlocks, [&](int32 Block) {
+		const int EndRow = FMath::Min((Block + 1) * RowsPerBlock, BorderedSize);
+		BlockHeightRanges[Block] = LumberCore::SampleHeightfieldRows(NoiseLayers.GetData(), NoiseLayers.Num(), ChunkCoord.X, ChunkCoord.Y,
+			NewTileSize, BorderedSize, Block * RowsPerBlock, EndRow, Heightfield->Heights.GetData());
+	}, ParallelFlags);
+
+	LumberCore::FHeightRange HeightRange;
+	for (const LumberCore::FHeightRange& BlockHeightRange : BlockHeightRanges) {
+		HeightRange.Add(BlockHeightRange);
+	}
+	Heightfield->MinHeight = HeightRange.Min;
+	Heightfield->MaxHeight = HeightRange.Max;
+}
+
+void ATerrainLoader::GetChunkTerrainData(FTerrainChunkMeshData* ChunkData, FVector2D ChunkCoord, EChunkQuality Quality, bool bParallel)
+{
+	FChunkHeightfield Heightfield;
+	GetChunkHeightfield(&Heightfield, ChunkCoord, Quality, bParallel);
+	GetChunkTerrainData(ChunkData, Heightfield, bParallel);
 }
 
+/*
+Get packed mesh data for a chunk from its heightfield, normals are taken including the heightfield's border
+so that they line up with neighbouring chunks.
+With bParallel the rows are split into blocks across worker threads.
+*/
+void ATerrainLoader::GetChunkTerrainData(FTerrainChunkMeshData* ChunkData, const FChunkHeightfield& Heightfield, bool bParallel)
+{
+	LUMBER_SCOPE(LumberTerrain, GetChunkTerrainData);
+
+	const EParallelForFlags ParallelFlags = bParallel ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread;
+	const int RowsPerBlock = FMath::Max(ParallelRowsPerBlock, 1);
+	const int TileSize = Heightfield.TileSize;
+
+	ChunkData->ChunkCoord = Heightfield.ChunkCoord;
+	ChunkData->GridSize = Heightfield.GridSize;
+	ChunkData->TileSize = TileSize;
+	ChunkData->MinHeight = Heightfield.MinHeight;
+	ChunkData->MaxHeight = Heightfield.MaxHeight;
+
+	// Pack vertices, with the normal from the central difference of neighbouring heights
+	const int NumRows = Heightfield.GridSize + 1;
+	ChunkData->Vertices.SetNumUninitialized(NumRows * NumRows);
+	ParallelFor(FMath::DivideAndRoundUp(NumRows, RowsPerBlock), [&](int32 Block) {
+		const int EndRow = FMath::Min((Block + 1) * RowsPerBlock, NumRows);
+		for (int row_i = Block * RowsPerBlock; row_i < EndRow; row_i++) {
+			for (int col_i = 0; col_i < NumRows; col_i++) {
+				const float Height = Heightfield.GetHeight(row_i, col_i);
+				const LumberCore::FVec3 CoreNormal = LumberCore::GetHeightfieldNormal(Heightfield.Heights.GetData(), Heightfield.GetBorderedSize(), TileSize, row_i, col_i);
+				const FVector Normal = FVector(CoreNormal.X, CoreNormal.Y, CoreNormal.Z);
+
+				ChunkData->Vertices[row_i * NumRows + col_i] = ChunkData->PackVertex(Height, Normal);
+			}
+		}
+	}, ParallelFlags);
+}
 
 /*
 Own implementation of ProceduralMeshComponent's CreateMeshSection
 */
-void ATerrainLoader::CreateMeshSection(UProceduralMeshComponent* ProcMesh, int32 SectionIndex, const TArray<FVector>& Vertices, const TArray<int32>& Triangles, const TArray<FVector>& Normals, const TArray<FVector2D>& UV0, const TArray<FVector2D>& UV1, const TArray<FVector2D>& UV2, const TArray<FVector2D>& UV3, const TArray<FColor>& VertexColors, const TArray<FProcMeshTangent>& Tangents, bool bCreateCollision)
+void ATerrainLoader::CreateMeshSection(UProceduralMeshComponent* ProcMesh, int32 SectionIndex, const TArray<FVector>& Vertices, const TArray<int32>& Triangles, const TArray<FVector>& Normals, const TArray<FVector2D>& UV0, const TArray<FVector2D>& UV1, const TArray<FVector2D>& UV2, const TArray<FVector2D>& UV3, const TArray<FColor>& VertexColors, const TArray<FProcMeshTangent>& Tangents, bool bCreateCollision, EJobPriority UploadPriority)
 {
+	LUMBER_SCOPE(LumberTerrain, CreateMeshSection);
+
 	// Reset this section (in case it already existed)
 	FProcMeshSection NewSection;
 
@@ -261,14 +369,20 @@ void ATerrainLoader::CreateMeshSection(UProceduralMeshComponent* ProcMesh, int32
 	check(CopyIndexIdx == NewSection.ProcIndexBuffer.Num());
 
 	NewSection.bEnableCollision = bCreateCollision;
-	AsyncTask(GamePriority, [this, ProcMesh, SectionIndex, NewSection]() {
+	Gamemode->GetGameThreadWork().Enqueue(EGameThreadWorkCategory::CollisionUpload, UploadPriority, [this, ProcMesh, SectionIndex, UploadPriority, NewSection = MoveTemp(NewSection)]() {
+		LUMBER_SCOPE(LumberTerrain, SetCollisionSection);
+
+		// Collision under the player and dynamic actors can't wait frames for an async cook, or they fall through it
+		const bool bCookNow = NewSection.bEnableCollision && UploadPriority == EJobPriority::Critical && ProcMesh->bUseAsyncCooking;
+		if (bCookNow) { ProcMesh->bUseAsyncCooking = false; }
 		ProcMesh->SetProcMeshSection(SectionIndex, NewSection);
+		if (bCookNow) { ProcMesh->bUseAsyncCooking = true; }
 		ProcMesh->SetMaterial(SectionIndex, Gamemode->TerrainMaterial);
-	});
+	}, SectionIndex);
 }
 
-void ATerrainLoader::CreateMeshSection(UProceduralMeshComponent* ProcMesh, int32 SectionIndex, const TArray<FVector>& Vertices, const TArray<int32>& Triangles, const TArray<FVector>& Normals, const TArray<FVector2D>& UV0, const TArray<FColor>& VertexColors, const TArray<FProcMeshTangent>& Tangents, bool bCreateCollision)
+void ATerrainLoader::CreateMeshSection(UProceduralMeshComponent* ProcMesh, int32 SectionIndex, const TArray<FVector>& Vertices, const TArray<int32>& Triangles, const TArray<FVector>& Normals, const TArray<FVector2D>& UV0, const TArray<FColor>& VertexColors, const TArray<FProcMeshTangent>& Tangents, bool bCreateCollision, EJobPriority UploadPriority)
 {
 	TArray<FVector2D> EmptyArray;
-	CreateMeshSection(ProcMesh, SectionIndex, Vertices, Triangles, Normals, UV0, EmptyArray, EmptyArray, EmptyArray, VertexColors, Tangents, bCreateCollision);
+	CreateMeshSection(ProcMesh, SectionIndex, Vertices, Triangles, Normals, UV0, EmptyArray, EmptyArray, EmptyArray, VertexColors, Tangents, bCreateCollision, UploadPriority);
 }
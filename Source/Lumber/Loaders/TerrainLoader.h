@@ -6,6 +6,8 @@
 #include "Loader.h"
 #include "ProceduralMeshComponent.h"
 #include "../Serialization/MyWorld.h"
+#include "../TerrainClasses/TerrainMeshComponent.h"
+#include "../GenerationCore/TerrainGeneration.h"
 #include "TerrainLoader.generated.h"
 
 struct FMyWorldSettings;
@@ -21,33 +23,110 @@ struct FMeshData {
 	TArray<FColor> Colors;
 };
 
+/*
+	Heights of a chunk's vertex grid at one quality, with a border of one tile on every side so normals can be
+	taken across chunk edges. Sampled once per chunk load and shared by every stage that needs terrain heights
+*/
+struct FChunkHeightfield {
+	FVector2D ChunkCoord = FVector2D::ZeroVector;
+
+	// Number of tiles along each side of the chunk, not counting the border
+	int GridSize = 0;
+
+	int TileSize = 0;
+
+	// Range of the heights inside the chunk, not counting the border
+	float MinHeight = 0;
+	float MaxHeight = 0;
+
+	TArray<float> Heights;
+
+public:
+	int GetBorderedSize() const { return GridSize + 3; }
+
+	/*
+		Height of a vertex of the chunk, rows and columns of -1 and GridSize + 1 are the border
+	*/
+	float GetHeight(int Row, int Col) const { return Heights[(Row + 1) * GetBorderedSize() + Col + 1]; }
+
+	FVector GetVertex(int Row, int Col) const { return FVector(ChunkCoord.X + TileSize * Row, ChunkCoord.Y + TileSize * Col, GetHeight(Row, Col)); }
+};
+
 UCLASS()
 class LUMBER_API ATerrainLoader : public ALoader
 {
 	GENERATED_BODY()
 
 public:
+	// Visual terrain, stored in a packed vertex format
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
-	UProceduralMeshComponent* Mesh;
+	UTerrainMeshComponent* Mesh;
 
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	UProceduralMeshComponent* CollisionMesh;
 
+	// Rows of vertices given to each worker when a chunk's generation is split across threads
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ClampMin = 1))
+	int ParallelRowsPerBlock = 8;
+
 public:
 	ATerrainLoader();
 
-	void GetChunkRenderData(FMeshData* MeshData, FVector2D ChunkCoord, EChunkQuality Quality);
+	void GetChunkRenderData(FMeshData* MeshData, FVector2D ChunkCoord, EChunkQuality Quality, bool bParallel = false);
+
+	void GetChunkRenderData(FMeshData* MeshData, const FChunkHeightfield& Heightfield, EChunkQuality Quality, bool bParallel = false);
 
-	void CreateMeshSection(UProceduralMeshComponent* ProcMesh, int32 SectionIndex, const TArray<FVector>& Vertices, const TArray<int32>& Triangles, const TArray<FVector>& Normals, const TArray<FVector2D>& UV0, const TArray<FVector2D>& UV1, const TArray<FVector2D>& UV2, const TArray<FVector2D>& UV3, const TArray<FColor>& VertexColors, const TArray<FProcMeshTangent>& Tangents, bool bCreateCollision);
+	void GetChunkHeightfield(FChunkHeightfield* Heightfield, FVector2D ChunkCoord, EChunkQuality Quality, bool bParallel = false);
 
-	void CreateMeshSection(UProceduralMeshComponent* ProcMesh, int32 SectionIndex, const TArray<FVector>& Vertices, const TArray<int32>& Triangles, const TArray<FVector>& Normals, const TArray<FVector2D>& UV0, const TArray<FColor>& VertexColors, const TArray<FProcMeshTangent>& Tangents, bool bCreateCollision);
+	void GetChunkTerrainData(FTerrainChunkMeshData* ChunkData, FVector2D ChunkCoord, EChunkQuality Quality, bool bParallel = false);
+
+	void GetChunkTerrainData(FTerrainChunkMeshData* ChunkData, const FChunkHeightfield& Heightfield, bool bParallel = false);
+
+	void CreateMeshSection(UProceduralMeshComponent* ProcMesh, int32 SectionIndex, const TArray<FVector>& Vertices, const TArray<int32>& Triangles, const TArray<FVector>& Normals, const TArray<FVector2D>& UV0, const TArray<FVector2D>& UV1, const TArray<FVector2D>& UV2, const TArray<FVector2D>& UV3, const TArray<FColor>& VertexColors, const TArray<FProcMeshTangent>& Tangents, bool bCreateCollision, EJobPriority UploadPriority = EJobPriority::Near);
+
+	void CreateMeshSection(UProceduralMeshComponent* ProcMesh, int32 SectionIndex, const TArray<FVector>& Vertices, const TArray<int32>& Triangles, const TArray<FVector>& Normals, const TArray<FVector2D>& UV0, const TArray<FColor>& VertexColors, const TArray<FProcMeshTangent>& Tangents, bool bCreateCollision, EJobPriority UploadPriority = EJobPriority::Near);
 	
 	float GetTerrainPointData(FVector2D Point);
 
-	void LoadChunkTerrain(int ChunkDataIndex, EChunkQuality ChunkTargetQuality, FVector2D ChunkCoord);
+	/*
+		Queues the chunk section to be set on the game thread
+	*/
+	void UploadChunkTerrain(int ChunkDataIndex, FTerrainChunkMeshData&& ChunkData, EJobPriority UploadPriority = EJobPriority::Near, int32 TraceId = INDEX_NONE);
+
+	/*
+		Queues the collision section to be set on the game thread. Critical uploads are cooked there and then, the rest
+		are cooked asynchronously and have collision some frames later
+	*/
+	void UploadChunkCollision(int ChunkDataIndex, const FMeshData& CollisionData, EJobPriority UploadPriority = EJobPriority::Near);
+
+	/*
+		Returns if cooked collision exists at the middle of a chunk, traced against the collision mesh. Game thread only
+	*/
+	bool HasChunkCollision(FVector2D ChunkCoord) const;
+
+	/*
+		Generates and uploads a cheap low quality mesh for a chunk that has nothing shown yet, ahead of its full quality mesh
+	*/
+	void LoadChunkTerrainPreview(int ChunkDataIndex, FVector2D ChunkCoord);
+
+	/*
+		Generates the full resolution collision of a chunk, independent of the quality of its visual mesh
+	*/
+	void LoadChunkCollision(int ChunkDataIndex, FVector2D ChunkCoord, bool bParallel = false, EJobPriority UploadPriority = EJobPriority::Near);
 
 	int ExtractRandomNumber(int* i_Seed);
 
+	/*
+		Reseeds the stream and the seed lookup table, so a replay generates the same terrain every run. A seed set
+		before BeginPlay is kept instead of a random one
+	*/
+	void SetSeed(int32 Seed);
+
+	/*
+		Sets the noise layers the terrain is generated from
+	*/
+	void SetWorldSettings(const FMyWorldSettings& NewWorldSettings);
+
 	float GetNoiseValueAtPoint(FVector2D Point, float Frequency, int* i_Seed);
 
 	// Stream for psudorandom numbers
@@ -55,8 +134,15 @@ public:
 
 	TArray<int> SeedArray;
 
+	// SetSeed has been called
+	bool bHasSeed = false;
+
 	FMyWorldSettings LoadedWorldSettings;
 
+private:
+	// The world settings' noise layers in the generation core's format
+	TArray<LumberCore::FNoiseLayer> NoiseLayers;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay();
@@ -7,6 +7,14 @@
 #include "Kismet/GameplayStatics.h"
 #include "ChunkLoader.h"
 #include "TerrainLoader.h"
+#include "../Lumber.h"
+#include "../GenerationCore/TreeSkeleton.h"
+#include "../TreeClasses/TreeArchetypeLibrary.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+
+DECLARE_CYCLE_STAT(TEXT("Get tree placements"), STAT_Lumber_GetTreePlacements, STATGROUP_Lumber);
+DECLARE_CYCLE_STAT(TEXT("Spawn chunk trees (GT)"), STAT_Lumber_SpawnTrees, STATGROUP_Lumber);
 
 ATreeLoader::ATreeLoader()
 {
@@ -27,16 +35,73 @@ void ATreeLoader::OnGeneratedTree(FTreeChunkRenderData *AssignedArray, bool* Ass
 	}
 }
 
-void ATreeLoader::GenerateTrees(int ChunkDataIndex, FVector2D ChunkCoord)
+/*
+Samples the chunk's heights itself, use GetTreePlacements and SpawnTrees to share an existing heightfield
+*/
+void ATreeLoader::GenerateTrees(int ChunkDataIndex, EChunkQuality ChunkQuality, FVector2D ChunkCoord)
+{
+	FChunkHeightfield Heightfield;
+	Gamemode->GetTerrainLoader()->GetChunkHeightfield(&Heightfield, ChunkCoord, EChunkQuality::Low);
+
+	TArray<FVector> TreePlacements;
+	GetTreePlacements(&TreePlacements, Heightfield);
+	SpawnTrees(ChunkDataIndex, ChunkQuality, MoveTemp(TreePlacements));
+}
+
+/*
+Places trees on a grid of the chunk at low quality spacing, taking the heights from the chunk's heightfield
+*/
+void ATreeLoader::GetTreePlacements(TArray<FVector>* TreePlacements, const FChunkHeightfield& Heightfield)
 {
-	AsyncTask(GamePriority, [this, ChunkDataIndex, ChunkCoord]() {
+	LUMBER_SCOPE(LumberTrees, GetTreePlacements);
 
-		int NewChunkSize = Gamemode->GetChunkLoader()->chunkSize;
-		int NewTileSize = Gamemode->GetChunkLoader()->tileSize;
+	int NewChunkSize = Gamemode->GetChunkLoader()->chunkSize;
+	int NewTileSize = Gamemode->GetChunkLoader()->tileSize;
 
-		int scale = 10;
-		NewChunkSize = NewChunkSize / scale;
-		NewTileSize = NewTileSize * scale;
+	int scale = 10;
+	NewChunkSize = NewChunkSize / scale;
+	NewTileSize = NewTileSize * scale;
+
+	// Tree spacing in heightfield vertices, low quality heightfields have a vertex for every tree
+	const int Stride = FMath::Max(NewTileSize / Heightfield.TileSize, 1);
+
+	TreePlacements->Reset((NewChunkSize + 1) * (NewChunkSize + 1));
+	for (int row_i = 0; row_i < NewChunkSize + 1; row_i++) {
+		for (int col_i = 0; col_i < NewChunkSize + 1; col_i++) {
+			TreePlacements->Add(Heightfield.GetVertex(row_i * Stride, col_i * Stride));
+		}
+	}
+}
+
+void ATreeLoader::SpawnTrees(int ChunkDataIndex, EChunkQuality ChunkQuality, TArray<FVector>&& TreePlacements)
+{
+	Gamemode->GetGameThreadWork().Enqueue(EGameThreadWorkCategory::TreeSpawn, EJobPriority::Near, [this, ChunkDataIndex, ChunkQuality, TreePlacements = MoveTemp(TreePlacements)]() {
+		LUMBER_SCOPE(LumberTrees, SpawnTrees);
+
+		// Trees are seeded by where they stand rather than when they spawn, so the forest is the same every load
+		const int32 WorldSeed = Gamemode->GetTerrainLoader()->Stream.GetInitialSeed();
+
+		if (bInstanceFarTrees) {
+			// The chunk may have been deleted while its trees were queued
+			if (!Gamemode->GetChunkLoader()->ChunkValid(ChunkDataIndex)) { return; }
+
+			if (Gamemode->TreeRootBlueprintClass == nullptr) {
+				UE_LOG(LogTemp, Warning, TEXT("NO TREE ROOT BLUEPRINT"));
+				return;
+			}
+
+			FChunkTreeInstances& ChunkTrees = InstancedChunkTrees.FindOrAdd(ChunkDataIndex);
+			if (ChunkQuality == EChunkQuality::High) {
+				MakeChunkTreesInteractive(ChunkDataIndex, ChunkTrees, TreePlacements, WorldSeed);
+			}
+			else {
+				InstanceChunkTrees(ChunkDataIndex, ChunkTrees, TreePlacements, WorldSeed);
+			}
+
+			// Instances are drawn as soon as they are added, and interactive trees don't report back
+			Gamemode->GetChunkLoader()->OnFinishLoadedChunkTrees(ChunkDataIndex);
+			return;
+		}
 
 		// Create new TreeChunkRenderData to keep track of Trees and their associated chunk to track generation progress
 		FTreeChunkRenderData NewTreeChunkRenderData = FTreeChunkRenderData();
@@ -44,25 +109,146 @@ void ATreeLoader::GenerateTrees(int ChunkDataIndex, FVector2D ChunkCoord)
 
 		TreeCompletion.Add(&NewTreeChunkRenderData);
 
-		for (int row_i = 0; row_i < NewChunkSize + 1; row_i++) {
-			for (int col_i = 0; col_i < NewChunkSize + 1; col_i++) {
-				bool NewState = false;
-				NewTreeChunkRenderData.AssignedTrees.Add(&NewState);
-
-				FVector2D Point = ChunkCoord + FVector2D(NewTileSize * row_i, NewTileSize * col_i);
-				FVector NewVertex = FVector(Point.X, Point.Y, Gamemode->GetTerrainLoader()->GetTerrainPointData(Point));
-
-				if (Gamemode->TreeRootBlueprintClass != nullptr) {
-					ATreeRoot* NewTree = GetWorld()->SpawnActor<ATreeRoot>(Gamemode->TreeRootBlueprintClass, NewVertex, FRotator());
-					NewTree->TreeSeed = FMath::Rand();
-					NewTree->GenerateTree(EChunkQuality::Low, &NewTreeChunkRenderData, &NewState);
-				}
-				else {
-					UE_LOG(LogTemp, Warning, TEXT("NO TREE ROOT BLUEPRINT"));
-				}
+		for (FVector NewVertex : TreePlacements) {
+			bool NewState = false;
+			NewTreeChunkRenderData.AssignedTrees.Add(&NewState);
+
+			if (Gamemode->TreeRootBlueprintClass != nullptr) {
+				ATreeRoot* NewTree = SpawnTreeRoot(ChunkDataIndex, NewVertex, LumberCore::GetTreeSeed(WorldSeed, FMath::RoundToInt64(NewVertex.X), FMath::RoundToInt64(NewVertex.Y)));
+				NewTree->GenerateTree(EChunkQuality::Low, &NewTreeChunkRenderData, &NewState);
+			}
+			else {
+				UE_LOG(LogTemp, Warning, TEXT("NO TREE ROOT BLUEPRINT"));
 			}
 		}
-	});
+	}, ChunkDataIndex);
+}
+
+ATreeRoot* ATreeLoader::SpawnTreeRoot(int ChunkDataIndex, const FVector& Location, int32 TreeSeed)
+{
+	ATreeRoot* NewTree = GetWorld()->SpawnActor<ATreeRoot>(Gamemode->TreeRootBlueprintClass, Location, FRotator());
+	NewTree->TreeSeed = TreeSeed;
+	NewTree->SourceChunk = ChunkDataIndex;
+	return NewTree;
+}
+
+/*
+The species' archetypes are kept for the rest of the game, so changing TreeSpecies afterwards has no effect
+*/
+void ATreeLoader::PrepareTreeArchetypes()
+{
+	if (SpeciesArchetypes.Num() > 0 || Gamemode->TreeRootBlueprintClass == nullptr) { return; }
+
+	if (ArchetypeLibrary == nullptr) {
+		ArchetypeLibrary = NewObject<UTreeArchetypeLibrary>(this);
+	}
+	ArchetypeLibrary->NumVariants = FMath::Max(NumTreeVariants, 1);
+	ArchetypeLibrary->bUseDiskCache = bCacheTreeArchetypes;
+
+	TArray<FData> Species = TreeSpecies;
+	if (Species.Num() == 0) {
+		Species.Add(Gamemode->TreeRootBlueprintClass->GetDefaultObject<ATreeRoot>()->InitialTreeData);
+	}
+
+	// A species listed twice would be picked twice as often
+	for (const FData& SpeciesData : Species) {
+		SpeciesArchetypes.AddUnique(ArchetypeLibrary->FindOrBuildArchetype(GetWorld(), Gamemode->TreeRootBlueprintClass, SpeciesData).ArchetypeKey);
+	}
+}
+
+void ATreeLoader::InstanceChunkTrees(int ChunkDataIndex, FChunkTreeInstances& ChunkTrees, const TArray<FVector>& TreePlacements, int32 WorldSeed)
+{
+	// Already drawn by an earlier load of the chunk at another far quality
+	if (!ChunkTrees.bInteractive && ChunkTrees.VariantInstances.Num() > 0) { return; }
+
+	// The chunk dropped out of high quality, its tree actors and anything cut off them go back to being instances
+	DestroyChunkTreeRoots(ChunkTrees);
+	ChunkTrees.bInteractive = false;
+
+	PrepareTreeArchetypes();
+	const int32 NumVariants = ArchetypeLibrary->NumVariants;
+
+	// A tree only costs its seed and two picks, its mesh was made when its archetype was
+	TArray<TArray<FTransform>> VariantTransforms;
+	VariantTransforms.SetNum(SpeciesArchetypes.Num() * NumVariants);
+	for (const FVector& Placement : TreePlacements) {
+		const int32 TreeSeed = LumberCore::GetTreeSeed(WorldSeed, FMath::RoundToInt64(Placement.X), FMath::RoundToInt64(Placement.Y));
+		const int32 Species = LumberCore::GetTreeSpecies(TreeSeed, SpeciesArchetypes.Num());
+		VariantTransforms[Species * NumVariants + LumberCore::GetTreeVariant(TreeSeed, NumVariants)].Add(FTransform(Placement));
+	}
+
+	ChunkTrees.VariantInstances.SetNumZeroed(VariantTransforms.Num());
+	for (int32 Species = 0; Species < SpeciesArchetypes.Num(); Species++) {
+		const FTreeArchetype* Archetype = ArchetypeLibrary->FindArchetype(SpeciesArchetypes[Species]);
+
+		for (int32 Variant = 0; Variant < NumVariants; Variant++) {
+			const TArray<FTransform>& Transforms = VariantTransforms[Species * NumVariants + Variant];
+			if (Transforms.Num() == 0) { continue; }
+
+			UHierarchicalInstancedStaticMeshComponent* Instances = NewObject<UHierarchicalInstancedStaticMeshComponent>(this);
+			Instances->SetStaticMesh(Archetype->VariantMeshes[Variant]);
+			// The variant's mesh may be shared with a species that only differs in materials
+			Instances->SetMaterial(0, Archetype->Species.LogMaterial);
+			Instances->SetMaterial(1, Archetype->Species.LeafMaterial);
+			Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			Instances->RegisterComponent();
+			Instances->AddInstances(Transforms, false, true);
+			ChunkTrees.VariantInstances[Species * NumVariants + Variant] = Instances;
+		}
+	}
+}
+
+void ATreeLoader::MakeChunkTreesInteractive(int ChunkDataIndex, FChunkTreeInstances& ChunkTrees, const TArray<FVector>& TreePlacements, int32 WorldSeed)
+{
+	if (ChunkTrees.bInteractive) { return; }
+
+	PrepareTreeArchetypes();
+	DestroyChunkInstances(ChunkTrees);
+	ChunkTrees.bInteractive = true;
+
+	// Each actor grows its instance's species and variant, so nothing changes when the instance is swapped for it
+	for (const FVector& Placement : TreePlacements) {
+		const int32 TreeSeed = LumberCore::GetTreeSeed(WorldSeed, FMath::RoundToInt64(Placement.X), FMath::RoundToInt64(Placement.Y));
+		const FTreeArchetype* Archetype = ArchetypeLibrary->FindArchetype(SpeciesArchetypes[LumberCore::GetTreeSpecies(TreeSeed, SpeciesArchetypes.Num())]);
+		const int32 Variant = LumberCore::GetTreeVariant(TreeSeed, Archetype->VariantSeeds.Num());
+
+		ATreeRoot* NewTree = SpawnTreeRoot(ChunkDataIndex, Placement, Archetype->VariantSeeds[Variant]);
+		NewTree->InitialTreeData = Archetype->Species;
+		NewTree->GenerateTree(EChunkQuality::High, nullptr, nullptr);
+		ChunkTrees.TreeRoots.Add(NewTree);
+	}
+}
+
+void ATreeLoader::DestroyChunkInstances(FChunkTreeInstances& ChunkTrees)
+{
+	for (UHierarchicalInstancedStaticMeshComponent* Instances : ChunkTrees.VariantInstances) {
+		if (Instances != nullptr) {
+			Instances->DestroyComponent();
+		}
+	}
+	ChunkTrees.VariantInstances.Empty();
+}
+
+void ATreeLoader::DestroyChunkTreeRoots(FChunkTreeInstances& ChunkTrees)
+{
+	for (const TWeakObjectPtr<ATreeRoot>& TreeRoot : ChunkTrees.TreeRoots) {
+		if (TreeRoot.IsValid()) {
+			TreeRoot->DestroyTree();
+		}
+	}
+	ChunkTrees.TreeRoots.Empty();
+}
+
+/*
+Chunk slots are reused, so everything spawned for the chunk has to go with it
+*/
+void ATreeLoader::RemoveChunkTrees(int ChunkDataIndex)
+{
+	if (FChunkTreeInstances* ChunkTrees = InstancedChunkTrees.Find(ChunkDataIndex)) {
+		DestroyChunkInstances(*ChunkTrees);
+		DestroyChunkTreeRoots(*ChunkTrees);
+		InstancedChunkTrees.Remove(ChunkDataIndex);
+	}
 }
 
 bool ATreeLoader::TreesInChunkRendered(TArray<bool*> Array)
@@ -77,3 +263,14 @@ bool ATreeLoader::TreesInChunkRendered(TArray<bool*> Array)
 
 	return true;
 }
+
+int32 ATreeLoader::GetNumTreeInstances() const
+{
+	int32 NumInstances = 0;
+	for (const TPair<int32, FChunkTreeInstances>& ChunkTrees : InstancedChunkTrees) {
+		for (const UHierarchicalInstancedStaticMeshComponent* Instances : ChunkTrees.Value.VariantInstances) {
+			NumInstances += Instances != nullptr ? Instances->GetInstanceCount() : 0;
+		}
+	}
+	return NumInstances;
+}
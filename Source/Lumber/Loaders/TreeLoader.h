@@ -4,15 +4,38 @@
 
 #include "CoreMinimal.h"
 #include "Loader.h"
+#include "../TreeClasses/LogData.h"
 #include "TreeLoader.generated.h"
 
 class ALumberGameMode;
+class ATreeRoot;
+class UHierarchicalInstancedStaticMeshComponent;
+class UTreeArchetypeLibrary;
+struct FChunkHeightfield;
 
 struct FTreeChunkRenderData {
 	int ChunkIndex;
 	TArray<bool*> AssignedTrees;
 };
 
+/*
+	Trees of one chunk while far trees are instanced, either drawn as instances or spawned as tree actors
+*/
+USTRUCT()
+struct FChunkTreeInstances {
+	GENERATED_BODY()
+
+	// One component for each variant of each species, null for variants no tree of the chunk uses
+	UPROPERTY()
+	TArray<TObjectPtr<UHierarchicalInstancedStaticMeshComponent>> VariantInstances;
+
+	// Tree actors spawned while the chunk is at high quality, destroyed with their logs when it drops below
+	TArray<TWeakObjectPtr<ATreeRoot>> TreeRoots;
+
+	// The chunk's trees have been spawned as actors instead of instances
+	bool bInteractive = false;
+};
+
 /**
  * Class that ideally works with the Terrain class to efficiently load Trees, using call back functions to notify end of generation
  */
@@ -35,11 +58,96 @@ public:
 	*/
 	void OnGeneratedTree(FTreeChunkRenderData* AssignedArray, bool *AssignedTree);
 
-	void GenerateTrees(int ChunkDataIndex, FVector2D ChunkCoord);
+	void GenerateTrees(int ChunkDataIndex, EChunkQuality ChunkQuality, FVector2D ChunkCoord);
+
+	void GetTreePlacements(TArray<FVector>* TreePlacements, const FChunkHeightfield& Heightfield);
+
+	/*
+		Queues spawning trees at the given locations on the game thread, as instances if far trees are instanced and
+		the chunk isn't at high quality
+	*/
+	void SpawnTrees(int ChunkDataIndex, EChunkQuality ChunkQuality, TArray<FVector>&& TreePlacements);
+
+	/*
+		Removes the instances or tree actors of a chunk's trees, called on the game thread when the chunk is deleted
+	*/
+	void RemoveChunkTrees(int ChunkDataIndex);
+
+	/*
+		Instances or tree actors of a chunk's trees, nullptr if the chunk has none or far trees aren't instanced
+	*/
+	const FChunkTreeInstances* FindChunkTrees(int ChunkDataIndex) const { return InstancedChunkTrees.Find(ChunkDataIndex); }
+
+	/*
+		Variants far trees are drawn with, nullptr until the archetypes are prepared
+	*/
+	const UTreeArchetypeLibrary* GetArchetypeLibrary() const { return ArchetypeLibrary; }
 
 	/*
 		Returns if all trees in array are rendered (all bools are true)
 	*/
 	bool TreesInChunkRendered(TArray<bool*> Array);
 
+	/*
+		Number of trees drawn as instances over every chunk
+	*/
+	int32 GetNumTreeInstances() const;
+
+	/*
+		Builds or reads the variants of every species, called at startup so the first far chunk doesn't wait on them
+	*/
+	void PrepareTreeArchetypes();
+
+	/*
+		Draws the trees of chunks below high quality as instances of a few pre-generated trees, through one hierarchical
+		instanced static mesh component per species variant and chunk. Tree actors are only spawned for high quality chunks
+	*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bInstanceFarTrees = true;
+
+	/*
+		Settings of the species trees grow as, each tree picks one by its seed. Empty uses the tree root blueprint's settings
+	*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	TArray<FData> TreeSpecies;
+
+	/*
+		How many pre-generated trees of each species far trees are drawn with
+	*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int32 NumTreeVariants = 16;
+
+	/*
+		Keeps the generated variants under Saved/TreeArchetypes, so later runs read them instead of generating them again
+	*/
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bCacheTreeArchetypes = true;
+
+private:
+	ATreeRoot* SpawnTreeRoot(int ChunkDataIndex, const FVector& Location, int32 TreeSeed);
+
+	/*
+		Draws a chunk's trees as instances of the variants, swapping back any tree actors the chunk had at high quality
+	*/
+	void InstanceChunkTrees(int ChunkDataIndex, FChunkTreeInstances& ChunkTrees, const TArray<FVector>& TreePlacements, int32 WorldSeed);
+
+	/*
+		Swaps a chunk's instances for tree actors of the same species and variants, so they look the same and can be cut
+	*/
+	void MakeChunkTreesInteractive(int ChunkDataIndex, FChunkTreeInstances& ChunkTrees, const TArray<FVector>& TreePlacements, int32 WorldSeed);
+
+	void DestroyChunkInstances(FChunkTreeInstances& ChunkTrees);
+
+	void DestroyChunkTreeRoots(FChunkTreeInstances& ChunkTrees);
+
+private:
+	UPROPERTY(Transient)
+	TObjectPtr<UTreeArchetypeLibrary> ArchetypeLibrary;
+
+	// Archetype key of each distinct species in the library, empty until the archetypes are prepared
+	TArray<uint32> SpeciesArchetypes;
+
+	UPROPERTY(Transient)
+	TMap<int32, FChunkTreeInstances> InstancedChunkTrees;
+
 };
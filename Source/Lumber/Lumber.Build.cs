@@ -8,6 +8,6 @@ public class Lumber : ModuleRules
 	{
 		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
 
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "HeadMountedDisplay", "Paper2D", "Niagara", "Json", "JsonUtilities" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "RenderCore", "RHI", "InputCore", "HeadMountedDisplay", "Paper2D", "Niagara", "Json", "JsonUtilities", "MeshDescription", "StaticMeshDescription" });
 	}
 }
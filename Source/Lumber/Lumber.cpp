@@ -3,5 +3,13 @@
 #include "Lumber.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_STAT(STAT_LumberResidentChunks);
+DEFINE_STAT(STAT_LumberTreeRoots);
+DEFINE_STAT(STAT_LumberTreeActors);
+DEFINE_STAT(STAT_LumberTerrainSectionMemory);
+
+CSV_DEFINE_CATEGORY_MODULE(LUMBER_API, LumberTerrain, true);
+CSV_DEFINE_CATEGORY_MODULE(LUMBER_API, LumberTrees, true);
+CSV_DEFINE_CATEGORY_MODULE(LUMBER_API, LumberLoading, true);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Lumber, "Lumber" );
- 
\ No newline at end of file
@@ -3,3 +3,28 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+// "stat Lumber" shows every Lumber cycle counter and the counters below
+DECLARE_STATS_GROUP(TEXT("Lumber"), STATGROUP_Lumber, STATCAT_Advanced);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Resident chunks"), STAT_LumberResidentChunks, STATGROUP_Lumber, LUMBER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Tree roots"), STAT_LumberTreeRoots, STATGROUP_Lumber, LUMBER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Tree log actors"), STAT_LumberTreeActors, STATGROUP_Lumber, LUMBER_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Terrain section memory"), STAT_LumberTerrainSectionMemory, STATGROUP_Lumber, LUMBER_API);
+
+// CSV profiler categories, one per subsystem
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(LUMBER_API, LumberTerrain);
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(LUMBER_API, LumberTrees);
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(LUMBER_API, LumberLoading);
+
+/*
+	Times the rest of the scope as a cycle counter, an Insights CPU scope and a CSV profiler stat.
+	The cycle stat STAT_Lumber_<Name> must be declared with DECLARE_CYCLE_STAT in the same file
+*/
+#define LUMBER_SCOPE(CsvCategory, Name) \
+	SCOPE_CYCLE_COUNTER(STAT_Lumber_##Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(Lumber_##Name); \
+	CSV_SCOPED_TIMING_STAT(CsvCategory, Name)
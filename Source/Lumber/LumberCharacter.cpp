@@ -11,7 +11,7 @@
 #include "MotionControllerComponent.h"
 #include "TreeClasses/Tree.h"
 #include "Engine/Engine.h"
-#include "DrawDebugHelpers.h"
+#include "LumberDebug.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogFPChar, Warning, All);
 
@@ -165,7 +165,7 @@ void ALumberCharacter::OnFire()
 		ECollisionChannel::ECC_Pawn, 
 		Params
 	);
-	DrawDebugLine(GetWorld(), Hit.TraceStart, Hit.ImpactPoint, FColor::Red, false, 1, 0, 1);
+	LUMBER_DEBUG_LINE(Weapon, GetWorld(), Hit.TraceStart, Hit.ImpactPoint, FColor::Red, 1, 1);
 	if (
 		Hit.bBlockingHit
 		&& Hit.GetActor() != nullptr 
@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LumberDebug.h"
+
+#if LUMBER_DEBUG_VIS
+
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<bool> CVarDebugTrees(
+	TEXT("Lumber.Debug.Trees"),
+	false,
+	TEXT("Draws the skeleton of generated trees and shows how long each tree took to generate"));
+
+static TAutoConsoleVariable<bool> CVarDebugTreeCuts(
+	TEXT("Lumber.Debug.TreeCuts"),
+	false,
+	TEXT("Draws the cuts on tree logs and shows the distance of a new cut to the nearest existing one"));
+
+static TAutoConsoleVariable<bool> CVarDebugChunks(
+	TEXT("Lumber.Debug.Chunks"),
+	false,
+	TEXT("Shows chunk loader messages, like whether the observer was found"));
+
+static TAutoConsoleVariable<bool> CVarDebugWeapon(
+	TEXT("Lumber.Debug.Weapon"),
+	false,
+	TEXT("Draws the player's tree cutting trace"));
+
+bool FLumberDebugVis::IsEnabled(ELumberDebugCategory Category) {
+	switch (Category) {
+	case ELumberDebugCategory::Trees: return CVarDebugTrees.GetValueOnGameThread();
+	case ELumberDebugCategory::TreeCuts: return CVarDebugTreeCuts.GetValueOnGameThread();
+	case ELumberDebugCategory::Chunks: return CVarDebugChunks.GetValueOnGameThread();
+	case ELumberDebugCategory::Weapon: return CVarDebugWeapon.GetValueOnGameThread();
+	default: return false;
+	}
+}
+
+#endif
@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DrawDebugHelpers.h"
+#include "Engine/Engine.h"
+
+/*
+	Debug visualisation is compiled in for every build but Shipping and Test, where the macros below expand to nothing,
+	so their arguments (and any strings built for them) are never evaluated
+*/
+#ifndef LUMBER_DEBUG_VIS
+#define LUMBER_DEBUG_VIS (ENABLE_DRAW_DEBUG && !(UE_BUILD_SHIPPING || UE_BUILD_TEST))
+#endif
+
+/*
+	What a piece of debug visualisation is about, each category is switched on with its own Lumber.Debug.<Category> cvar
+*/
+enum class ELumberDebugCategory : uint8 {
+	// Tree generation: log skeletons and generation times
+	Trees,
+	// Cuts on tree logs
+	TreeCuts,
+	// Chunk loading and the observer
+	Chunks,
+	// The player's tree cutting trace
+	Weapon,
+	Count
+};
+
+#if LUMBER_DEBUG_VIS
+
+class LUMBER_API FLumberDebugVis {
+public:
+	/*
+		Returns whether a category's cvar is on, game thread only
+	*/
+	static bool IsEnabled(ELumberDebugCategory Category);
+};
+
+#define LUMBER_DEBUG_ENABLED(Category) FLumberDebugVis::IsEnabled(ELumberDebugCategory::Category)
+
+#define LUMBER_DEBUG_LINE(Category, World, Start, End, Color, LifeTime, Thickness) \
+	do { if (LUMBER_DEBUG_ENABLED(Category)) { DrawDebugLine(World, Start, End, Color, false, LifeTime, 0, Thickness); } } while (0)
+
+#define LUMBER_DEBUG_POINT(Category, World, Location, Size, Color, LifeTime) \
+	do { if (LUMBER_DEBUG_ENABLED(Category)) { DrawDebugPoint(World, Location, Size, Color, false, LifeTime); } } while (0)
+
+// Key works like AddOnScreenDebugMessage's, -1 adds a new message instead of replacing the one with the same key
+#define LUMBER_DEBUG_MESSAGE(Category, Key, TimeToDisplay, Color, Format, ...) \
+	do { if (LUMBER_DEBUG_ENABLED(Category) && GEngine != nullptr) { GEngine->AddOnScreenDebugMessage(Key, TimeToDisplay, Color, FString::Printf(Format, ##__VA_ARGS__)); } } while (0)
+
+#else
+
+#define LUMBER_DEBUG_ENABLED(Category) false
+#define LUMBER_DEBUG_LINE(Category, World, Start, End, Color, LifeTime, Thickness) do {} while (0)
+#define LUMBER_DEBUG_POINT(Category, World, Location, Size, Color, LifeTime) do {} while (0)
+#define LUMBER_DEBUG_MESSAGE(Category, Key, TimeToDisplay, Color, Format, ...) do {} while (0)
+
+#endif
@@ -7,6 +7,7 @@
 #include "TreeClasses/Tree.h"
 #include "TreeClasses/TreeRoot.h"
 #include "Kismet/GameplayStatics.h"
+#include "LumberDebug.h"
 
 #include "Loaders/ChunkLoader.h"
 #include "Loaders/TreeLoader.h"
@@ -14,6 +15,7 @@
 #include "Loaders/JobHandler.h"
 
 #include "Serialization/MyWorld.h"
+#include "Benchmarks/ObserverReplay.h"
 
 ALumberGameMode::ALumberGameMode()
 	: Super()
@@ -31,7 +33,23 @@ ALumberGameMode::ALumberGameMode()
 }
 
 void ALumberGameMode::BeginPlay() {
+	CreateLoaders();
+
+	// Streaming benchmark, plays back a recorded observer path
+	FString ReplayFilePath;
+	if (FParse::Value(FCommandLine::Get(), TEXT("LumberReplay="), ReplayFilePath)) {
+		AObserverReplay* Replay = AObserverReplay::FindOrSpawn(GetWorld());
+		Replay->bExitWhenFinished = FParse::Param(FCommandLine::Get(), TEXT("LumberReplayExit"));
+		Replay->StartPlayback(ReplayFilePath);
+	}
+
+	Super::BeginPlay();
+	Points = MakeCircleGrid(25, 2000);
+	iPoint = 0;
+	nextSpawnTime = 8;
+}
 
+void ALumberGameMode::CreateLoaders() {
 	// Create loaders
 	ChunkLoader = GetWorld()->SpawnActor<AChunkLoader>();
 	TreeLoader = GetWorld()->SpawnActor<ATreeLoader>();
@@ -43,15 +61,25 @@ void ALumberGameMode::BeginPlay() {
 	TreeLoader->SetGamemode(this);
 	TerrainLoader->SetGamemode(this);
 	JobHandler->SetGamemode(this);
+	TerrainLoader->Mesh->SetLifecycleTracer(&ChunkLoader->GetLifecycleTracer());
+	GameThreadWork.SetChunkLocationLookup([this](int32 SourceChunk, FVector2D& OutLocation) {
+		return ChunkLoader->GetChunkLocation(SourceChunk, OutLocation);
+	});
+
+	// A fixed seed generates the same world every run, a replay sets the one it was recorded with
+	int32 Seed = 0;
+	if (FParse::Value(FCommandLine::Get(), TEXT("LumberSeed="), Seed)) {
+		TerrainLoader->SetSeed(Seed);
+	}
+
+	// Far tree variants are generated or read from disk up front, rather than when the first chunk's trees spawn
+	if (ChunkLoader->IsGeneratingTrees() && TreeLoader->bInstanceFarTrees) {
+		TreeLoader->PrepareTreeArchetypes();
+	}
 
 	// Create new world
 	UMyWorld* NewWorld = UMyWorld::CreateNewWorld(this, WorldToLoad);
-	TerrainLoader->LoadedWorldSettings = NewWorld->WorldSettings;
-
-	Super::BeginPlay();
-	Points = MakeCircleGrid(25, 2000);
-	iPoint = 0;
-	nextSpawnTime = 8;
+	TerrainLoader->SetWorldSettings(NewWorld->WorldSettings);
 }
 
 void ALumberGameMode::Tick(float DeltaSeconds) {
@@ -79,12 +107,28 @@ void ALumberGameMode::Tick(float DeltaSeconds) {
 		iPoint++;
 	}*/
 
-	//Cast<ATree::BuildTreeMeshRecursive()>TaskQueue.Pop()();
+	// The sampled work ran in the frame that has just ended, between the last tick and this one
+	if (bDetectHitches) {
+		HitchDetector.HitchThresholdMilliseconds = HitchThresholdMs;
+		HitchDetector.EndFrame(GameThreadWork);
+	}
+	else {
+		GameThreadWork.ResetFrameSamples();
+	}
+
+	GameThreadWork.Tick(GameThreadWorkBudgetMs);
+}
+
+void ALumberGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason) {
+	// Queued work points at loaders that are being destroyed
+	GameThreadWork.Reset();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void ALumberGameMode::StartPlanting() {
 	// return if there are no trees to spawn
-	GEngine->AddOnScreenDebugMessage(FMath::Rand(), 5, FColor::Orange, FString("Planting trees"));
+	LUMBER_DEBUG_MESSAGE(Trees, -1, 5, FColor::Orange, TEXT("Planting trees"));
 
 	if (TreeClasses.Num() == 0) { return; }
 	TArray<ATreeRoot*> NewTrees;
@@ -162,3 +206,8 @@ AJobHandler* ALumberGameMode::GetJobHandler()
 {
 	return JobHandler;
 }
+
+FGameThreadWorkQueue& ALumberGameMode::GetGameThreadWork()
+{
+	return GameThreadWork;
+}
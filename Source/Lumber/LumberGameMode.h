@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "Loaders/GameThreadWorkQueue.h"
+#include "Loaders/HitchDetector.h"
 #include "LumberGameMode.generated.h"
 
 class ATree;
@@ -22,11 +24,14 @@ class ALumberGameMode : public AGameModeBase
 public:
 	ALumberGameMode();
 	virtual void BeginPlay();
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaSeconds) override;
 
 	void StartPlanting();
 
-	//TQueue<void> TaskQueue;
+	// Spawns and wires up the loaders, called from BeginPlay or directly by benchmarks that run without play
+	void CreateLoaders();
+
 
 	bool Started = false;
 	float CurrentTime = 0;
@@ -48,6 +53,17 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	UMaterialInterface* TerrainMaterial;
 
+	// Milliseconds each frame the game thread spends on work queued by the loaders, critical work ignores this
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float GameThreadWorkBudgetMs = 4.0f;
+
+	// Frames longer than this are logged along with the game thread work that ran in them
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float HitchThresholdMs = 33.3f;
+
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	bool bDetectHitches = true;
+
 	// variable to hold points where trees will spawn
 	TArray<FVector> Points;
 	int iPoint;
@@ -66,6 +82,11 @@ private:
 	AChunkLoader* ChunkLoader;
 	ATerrainLoader* TerrainLoader;
 	AJobHandler* JobHandler;
+
+	// Main thread work of the loaders, like creating mesh sections and spawning actors
+	FGameThreadWorkQueue GameThreadWork;
+
+	FHitchDetector HitchDetector;
 /*
 	Getter Functions
 */
@@ -74,6 +95,8 @@ public:
 	AChunkLoader* GetChunkLoader();
 	ATerrainLoader* GetTerrainLoader();
 	AJobHandler* GetJobHandler();
+	FGameThreadWorkQueue& GetGameThreadWork();
+	const FHitchDetector& GetHitchDetector() const { return HitchDetector; }
 
 
 };
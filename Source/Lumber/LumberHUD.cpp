@@ -2,10 +2,23 @@
 
 #include "LumberHUD.h"
 #include "Engine/Canvas.h"
+#include "Engine/Engine.h"
 #include "Engine/Texture2D.h"
 #include "TextureResource.h"
 #include "CanvasItem.h"
+#include "HAL/IConsoleManager.h"
 #include "UObject/ConstructorHelpers.h"
+#include "LumberGameMode.h"
+#include "Loaders/ChunkLoader.h"
+#include "Loaders/JobHandler.h"
+#include "Loaders/TreeLoader.h"
+#include "TreeClasses/Tree.h"
+#include "TreeClasses/TreeRoot.h"
+
+static TAutoConsoleVariable<bool> CVarStreamingStats(
+	TEXT("Lumber.StreamingStats"),
+	false,
+	TEXT("Draws resident chunks per quality, jobs, game thread budget use, upload latency, tree counts and a minimap of chunk states on the HUD"));
 
 ALumberHUD::ALumberHUD()
 {
@@ -19,6 +32,18 @@ void ALumberHUD::DrawHUD()
 {
 	Super::DrawHUD();
 
+	// Nothing is gathered while the overlay is off
+	if (CVarStreamingStats.GetValueOnGameThread()) {
+		ALumberGameMode* Gamemode = GetWorld()->GetAuthGameMode<ALumberGameMode>();
+		if (Gamemode != nullptr && Gamemode->GetChunkLoader() != nullptr) {
+			DrawStreamingStats(Gamemode);
+		}
+	}
+	else if (StreamingStatsLines.Num() > 0) {
+		StreamingStatsLines.Empty();
+		NextStreamingStatsRefresh = 0;
+	}
+
 	//// Draw very simple crosshair
 
 	//// find center of the Canvas
@@ -33,3 +58,105 @@ void ALumberHUD::DrawHUD()
 	//TileItem.BlendMode = SE_BLEND_Translucent;
 	//Canvas->DrawItem( TileItem );
 }
+
+void ALumberHUD::UpdateStreamingStats(ALumberGameMode* Gamemode, const TArray<FChunkRenderData>& Chunks)
+{
+	AChunkLoader* ChunkLoader = Gamemode->GetChunkLoader();
+	AJobHandler* JobHandler = Gamemode->GetJobHandler();
+	const FGameThreadWorkQueue& GameThreadWork = Gamemode->GetGameThreadWork();
+
+	int32 ResidentChunks[EChunkQuality::Collision + 1] = {};
+	int32 LoadingChunks = 0;
+	for (const FChunkRenderData& Chunk : Chunks) {
+		if (Chunk.ChunkIndex == INDEX_NONE) { continue; }
+		ResidentChunks[(int)Chunk.ChunkQuality]++;
+		LoadingChunks += Chunk.TerrainRenderState == EChunkRenderState::Rendering;
+	}
+
+	TArray<double> UploadLatencies;
+	ChunkLoader->GetLifecycleTracer().GetSortedLatencies(EChunkLifecycleEvent::SectionApplied, UploadLatencies);
+
+	StreamingStatsLines.Reset();
+	StreamingStatsLines.Add(FString::Printf(TEXT("Chunks  high %d  medium %d  low %d  loading %d"),
+		ResidentChunks[EChunkQuality::High], ResidentChunks[EChunkQuality::Medium], ResidentChunks[EChunkQuality::Low], LoadingChunks));
+	if (JobHandler != nullptr) {
+		StreamingStatsLines.Add(FString::Printf(TEXT("Jobs  queued %d  running %d  workers %d/%d"),
+			JobHandler->GetNumQueuedJobs(), JobHandler->GetNumRunningJobs(), JobHandler->GetNumActiveWorkers(), JobHandler->GetNumWorkers()));
+	}
+	StreamingStatsLines.Add(FString::Printf(TEXT("Game thread work  %.2f / %.2f ms  queued %d"),
+		GameThreadWork.GetLastFrameMilliseconds(), Gamemode->GameThreadWorkBudgetMs, GameThreadWork.GetNumQueued()));
+	StreamingStatsLines.Add(FString::Printf(TEXT("Request to visible  p50 %.0f ms  p95 %.0f ms"),
+		GetSortedPercentile(UploadLatencies, 50), GetSortedPercentile(UploadLatencies, 95)));
+	StreamingStatsLines.Add(FString::Printf(TEXT("Trees  roots %d  logs %d  instances %d"), ATreeRoot::NumInWorld, ATree::NumInWorld,
+		Gamemode->GetTreeLoader() != nullptr ? Gamemode->GetTreeLoader()->GetNumTreeInstances() : 0));
+}
+
+void ALumberHUD::DrawStreamingStats(ALumberGameMode* Gamemode)
+{
+	TArray<FChunkRenderData> Chunks;
+	Gamemode->GetChunkLoader()->GetChunksSnapshot(Chunks);
+
+	const double Now = GetWorld()->GetRealTimeSeconds();
+	if (Now >= NextStreamingStatsRefresh) {
+		NextStreamingStatsRefresh = Now + StreamingStatsRefreshPeriod;
+		UpdateStreamingStats(Gamemode, Chunks);
+	}
+
+	UFont* Font = GEngine->GetSmallFont();
+	const float Left = 20.0f;
+	float Top = 60.0f;
+	for (const FString& Line : StreamingStatsLines) {
+		DrawText(Line, FLinearColor::White, Left, Top, Font);
+		Top += Font->GetMaxCharHeight() + 2.0f;
+	}
+
+	DrawChunkMinimap(Gamemode, Chunks, Left, Top + 8.0f);
+}
+
+void ALumberHUD::DrawChunkMinimap(ALumberGameMode* Gamemode, const TArray<FChunkRenderData>& Chunks, float Left, float Top)
+{
+	AChunkLoader* ChunkLoader = Gamemode->GetChunkLoader();
+	const APawn* Observer = GetOwningPawn();
+	if (Observer == nullptr || ChunkLoader->totalChunkSize <= 0) { return; }
+
+	// Chunks are kept up to the deletion distance, which sets the extent of the map
+	const int32 Radius = ChunkLoader->ChunkRenderDistance + ChunkLoader->ChunkDeletionOffset;
+	const float MapSize = (2 * Radius + 1) * MinimapCellSize;
+	DrawRect(FLinearColor(0, 0, 0, 0.5f), Left, Top, MapSize, MapSize);
+
+	// Same offset the chunk loader applies to the observer, so the observer's chunk is the centre cell
+	const FVector Location = Observer->GetActorLocation();
+	const FVector2D ObserverLocation = FVector2D(Location.X, Location.Y) - FVector2D(ChunkLoader->totalChunkSize / 2, ChunkLoader->totalChunkSize / 2);
+	const float CentreX = Left + Radius * MinimapCellSize;
+	const float CentreY = Top + Radius * MinimapCellSize;
+
+	for (const FChunkRenderData& Chunk : Chunks) {
+		if (Chunk.ChunkIndex == INDEX_NONE) { continue; }
+
+		// World X points up the map
+		const FVector2D Offset = (Chunk.ChunkLocation - ObserverLocation) / ChunkLoader->totalChunkSize;
+		const float CellX = CentreX + FMath::RoundToFloat(Offset.Y) * MinimapCellSize;
+		const float CellY = CentreY - FMath::RoundToFloat(Offset.X) * MinimapCellSize;
+		if (CellX < Left || CellY < Top || CellX >= Left + MapSize || CellY >= Top + MapSize) { continue; }
+
+		FLinearColor Color;
+		if (Chunk.TerrainRenderState != EChunkRenderState::Rendered) {
+			Color = FLinearColor(1.0f, 0.5f, 0.0f);
+		}
+		else {
+			switch (Chunk.ChunkQuality) {
+			case High: Color = FLinearColor(0.4f, 0.9f, 0.4f); break;
+			case Medium: Color = FLinearColor(0.2f, 0.6f, 0.2f); break;
+			default: Color = FLinearColor(0.1f, 0.3f, 0.1f); break;
+			}
+		}
+		DrawRect(Color, CellX, CellY, MinimapCellSize - 1, MinimapCellSize - 1);
+
+		// Collidable chunks get a dot in the middle
+		if (Chunk.CollisionRenderState == EChunkRenderState::Rendered) {
+			DrawRect(FLinearColor(0.2f, 0.4f, 1.0f), CellX + MinimapCellSize * 0.25f, CellY + MinimapCellSize * 0.25f, MinimapCellSize * 0.5f - 1, MinimapCellSize * 0.5f - 1);
+		}
+	}
+
+	DrawRect(FLinearColor::White, CentreX + MinimapCellSize * 0.375f, CentreY + MinimapCellSize * 0.375f, MinimapCellSize * 0.25f, MinimapCellSize * 0.25f);
+}
@@ -1,11 +1,14 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
-#pragma once 
+#pragma once
 
 #include "CoreMinimal.h"
 #include "GameFramework/HUD.h"
 #include "LumberHUD.generated.h"
 
+class ALumberGameMode;
+struct FChunkRenderData;
+
 UCLASS()
 class ALumberHUD : public AHUD
 {
@@ -17,9 +20,33 @@ public:
 	/** Primary draw call for the HUD */
 	virtual void DrawHUD() override;
 
+	/** Seconds between refreshes of the streaming stats overlay's numbers, the minimap is drawn every frame */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float StreamingStatsRefreshPeriod = 0.5f;
+
+	/** Size in pixels of a chunk on the streaming stats minimap */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	float MinimapCellSize = 8.0f;
+
+private:
+	/** Rebuilds the overlay's lines of text from the loaders and a copy of the chunks */
+	void UpdateStreamingStats(ALumberGameMode* Gamemode, const TArray<FChunkRenderData>& Chunks);
+
+	/** Draws the overlay's text and the chunk minimap below it, only called while the overlay is on. The chunk loader's
+		background task can reallocate its chunks at any time, so both read a copy taken once a frame */
+	void DrawStreamingStats(ALumberGameMode* Gamemode);
+
+	/** Draws every resident chunk around the observer, coloured by quality and load state */
+	void DrawChunkMinimap(ALumberGameMode* Gamemode, const TArray<FChunkRenderData>& Chunks, float Left, float Top);
+
 private:
 	/** Crosshair asset pointer */
 	class UTexture2D* CrosshairTex;
 
+	/** Lines of the streaming stats overlay, as of the last refresh */
+	TArray<FString> StreamingStatsLines;
+
+	double NextStreamingStatsRefresh = 0;
+
 };
 
@@ -0,0 +1,615 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TerrainMeshComponent.h"
+#include "PrimitiveSceneProxy.h"
+#include "LocalVertexFactory.h"
+#include "StaticMeshResources.h"
+#include "RawIndexBuffer.h"
+#include "MaterialDomain.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialRenderProxy.h"
+#include "Engine/Engine.h"
+#include "SceneManagement.h"
+#include "SceneInterface.h"
+#include "../Lumber.h"
+#include "../Loaders/ChunkLifecycleTracer.h"
+
+/*
+	Render thread copy of one chunk section
+*/
+struct FTerrainProxySection {
+	FStaticMeshVertexBuffers VertexBuffers;
+	FLocalVertexFactory VertexFactory;
+
+	// Owned by the proxy, shared between all sections with the same grid size
+	FRawStaticIndexBuffer* IndexBuffer = nullptr;
+
+	int32 NumVertices = 0;
+
+	int GridSize = 0;
+
+	FTerrainProxySection(ERHIFeatureLevel::Type FeatureLevel)
+		: VertexFactory(FeatureLevel, "FTerrainProxySection")
+	{
+	}
+};
+
+/*
+	Scene proxy for UTerrainMeshComponent.
+	GPU vertices use position (12 bytes), packed tangents (8 bytes) and a single half precision UV (4 bytes) with no colour stream,
+	and indices are 16 bit and shared between chunks of the same grid size.
+	Sections are created, replaced or updated in place on the render thread through UpdateSections_RenderThread.
+*/
+class FTerrainMeshSceneProxy final : public FPrimitiveSceneProxy
+{
+public:
+	SIZE_T GetTypeHash() const override
+	{
+		static size_t UniquePointer;
+		return reinterpret_cast<size_t>(&UniquePointer);
+	}
+
+	FTerrainMeshSceneProxy(UTerrainMeshComponent* Component)
+		: FPrimitiveSceneProxy(Component)
+		, MaterialRelevance(Component->GetMaterialRelevance(GetScene().GetFeatureLevel()))
+	{
+		Material = Component->GetMaterial(0);
+		if (Material == nullptr) {
+			Material = UMaterial::GetDefaultMaterial(MD_Surface);
+		}
+
+		// Copy every current chunk, the proxy builds them on the render thread like any other update
+		TArray<FTerrainSectionUpdate> InitialSections;
+		for (int SectionIdx = 0; SectionIdx < Component->ChunkSections.Num(); SectionIdx++)
+		{
+			if (Component->ChunkSections[SectionIdx].GetNumVertices() == 0) { continue; }
+
+			FTerrainSectionUpdate& Update = InitialSections.AddDefaulted_GetRef();
+			Update.SectionIndex = SectionIdx;
+			Update.ChunkData = Component->ChunkSections[SectionIdx];
+		}
+
+		ENQUEUE_RENDER_COMMAND(InitTerrainProxySections)(
+			[this, InitialSections = MoveTemp(InitialSections)](FRHICommandListImmediate& RHICmdList)
+			{
+				UpdateSections_RenderThread(RHICmdList, InitialSections);
+			});
+	}
+
+	virtual ~FTerrainMeshSceneProxy()
+	{
+		for (int SectionIdx = 0; SectionIdx < Sections.Num(); SectionIdx++)
+		{
+			ReleaseSection(SectionIdx);
+		}
+
+		for (TPair<int, FRawStaticIndexBuffer*>& Pair : SharedIndexBuffers)
+		{
+			Pair.Value->ReleaseResource();
+			delete Pair.Value;
+		}
+	}
+
+	/*
+		Applies a batch of chunk changes. Sections with the same grid size as before only have their positions and tangents
+		rewritten in the existing buffers, otherwise only that section's buffers are recreated.
+	*/
+	void UpdateSections_RenderThread(FRHICommandListBase& RHICmdList, const TArray<FTerrainSectionUpdate>& Updates)
+	{
+		check(IsInRenderingThread());
+
+		for (const FTerrainSectionUpdate& Update : Updates)
+		{
+			if (Update.SectionIndex >= Sections.Num()) {
+				Sections.SetNumZeroed(Update.SectionIndex + 1);
+			}
+
+			FTerrainProxySection* Section = Sections[Update.SectionIndex];
+
+			// Empty chunk data removes the section
+			if (Update.ChunkData.GetNumVertices() == 0) {
+				ReleaseSection(Update.SectionIndex);
+				continue;
+			}
+
+			// Same layout as before, so the existing buffers can be written to directly
+			if (Section != nullptr && Section->GridSize == Update.ChunkData.GridSize) {
+				WriteVertices_RenderThread(RHICmdList, Section, Update.ChunkData);
+				continue;
+			}
+
+			ReleaseSection(Update.SectionIndex);
+			Sections[Update.SectionIndex] = CreateSection_RenderThread(RHICmdList, Update.ChunkData);
+		}
+	}
+
+	virtual void GetDynamicMeshElements(const TArray<const FSceneView*>& Views, const FSceneViewFamily& ViewFamily, uint32 VisibilityMap, FMeshElementCollector& Collector) const override
+	{
+		const bool bWireframe = AllowDebugViewmodes() && ViewFamily.EngineShowFlags.Wireframe;
+
+		FColoredMaterialRenderProxy* WireframeMaterialInstance = nullptr;
+		if (bWireframe)
+		{
+			WireframeMaterialInstance = new FColoredMaterialRenderProxy(
+				GEngine->WireframeMaterial ? GEngine->WireframeMaterial->GetRenderProxy() : nullptr,
+				FLinearColor(0, 0.5f, 1.f)
+			);
+			Collector.RegisterOneFrameMaterialProxy(WireframeMaterialInstance);
+		}
+
+		FMaterialRenderProxy* MaterialProxy = bWireframe ? WireframeMaterialInstance : Material->GetRenderProxy();
+
+		for (const FTerrainProxySection* Section : Sections)
+		{
+			if (Section == nullptr) { continue; }
+
+			for (int32 ViewIndex = 0; ViewIndex < Views.Num(); ViewIndex++)
+			{
+				if (!(VisibilityMap & (1 << ViewIndex))) { continue; }
+
+				FMeshBatch& Mesh = Collector.AllocateMesh();
+				FMeshBatchElement& BatchElement = Mesh.Elements[0];
+				BatchElement.IndexBuffer = Section->IndexBuffer;
+				Mesh.bWireframe = bWireframe;
+				Mesh.VertexFactory = &Section->VertexFactory;
+				Mesh.MaterialRenderProxy = MaterialProxy;
+
+				bool bHasPrecomputedVolumetricLightmap;
+				FMatrix PreviousLocalToWorld;
+				int32 SingleCaptureIndex;
+				bool bOutputVelocity;
+				GetScene().GetPrimitiveUniformShaderParameters_RenderThread(GetPrimitiveSceneInfo(), bHasPrecomputedVolumetricLightmap, PreviousLocalToWorld, SingleCaptureIndex, bOutputVelocity);
+				bOutputVelocity |= AlwaysHasVelocity();
+
+				FDynamicPrimitiveUniformBuffer& DynamicPrimitiveUniformBuffer = Collector.AllocateOneFrameResource<FDynamicPrimitiveUniformBuffer>();
+				DynamicPrimitiveUniformBuffer.Set(Collector.GetRHICommandList(), GetLocalToWorld(), PreviousLocalToWorld, GetBounds(), GetLocalBounds(), GetLocalBounds(), true, bHasPrecomputedVolumetricLightmap, bOutputVelocity, GetCustomPrimitiveData());
+				BatchElement.PrimitiveUniformBufferResource = &DynamicPrimitiveUniformBuffer.UniformBuffer;
+
+				BatchElement.FirstIndex = 0;
+				BatchElement.NumPrimitives = Section->IndexBuffer->GetNumIndices() / 3;
+				BatchElement.MinVertexIndex = 0;
+				BatchElement.MaxVertexIndex = Section->NumVertices - 1;
+				Mesh.ReverseCulling = IsLocalToWorldDeterminantNegative();
+				Mesh.Type = PT_TriangleList;
+				Mesh.DepthPriorityGroup = SDPG_World;
+				Mesh.bCanApplyViewModeOverrides = false;
+				Collector.AddMesh(ViewIndex, Mesh);
+			}
+		}
+	}
+
+	virtual FPrimitiveViewRelevance GetViewRelevance(const FSceneView* View) const override
+	{
+		FPrimitiveViewRelevance Result;
+		Result.bDrawRelevance = IsShown(View);
+		Result.bShadowRelevance = IsShadowCast(View);
+		Result.bDynamicRelevance = true;
+		Result.bRenderInMainPass = ShouldRenderInMainPass();
+		Result.bUsesLightingChannels = GetLightingChannelMask() != GetDefaultLightingChannelMask();
+		Result.bRenderCustomDepth = ShouldRenderCustomDepth();
+		Result.bTranslucentSelfShadow = bCastVolumetricTranslucentShadow;
+		MaterialRelevance.SetPrimitiveViewRelevance(Result);
+		Result.bVelocityRelevance = DrawsVelocity() && Result.bOpaque && Result.bRenderInMainPass;
+		return Result;
+	}
+
+	virtual bool CanBeOccluded() const override
+	{
+		return !MaterialRelevance.bDisableDepthTest;
+	}
+
+	virtual uint32 GetMemoryFootprint(void) const override
+	{
+		return sizeof(*this) + GetAllocatedSize();
+	}
+
+	uint32 GetAllocatedSize(void) const
+	{
+		return FPrimitiveSceneProxy::GetAllocatedSize() + Sections.GetAllocatedSize() + SharedIndexBuffers.GetAllocatedSize();
+	}
+
+private:
+	/*
+		Decodes the packed chunk into new GPU vertex buffers
+	*/
+	FTerrainProxySection* CreateSection_RenderThread(FRHICommandListBase& RHICmdList, const FTerrainChunkMeshData& ChunkData)
+	{
+		FTerrainProxySection* Section = new FTerrainProxySection(GetScene().GetFeatureLevel());
+		Section->NumVertices = ChunkData.GetNumVertices();
+		Section->GridSize = ChunkData.GridSize;
+		Section->IndexBuffer = FindOrCreateIndexBuffer_RenderThread(RHICmdList, ChunkData.GridSize);
+
+		// CPU copies are not kept around once uploaded
+		FStaticMeshVertexBuffers& VertexBuffers = Section->VertexBuffers;
+		VertexBuffers.PositionVertexBuffer.Init(Section->NumVertices, false);
+		VertexBuffers.StaticMeshVertexBuffer.Init(Section->NumVertices, 1, false);
+
+		for (int VertIdx = 0; VertIdx < Section->NumVertices; VertIdx++)
+		{
+			FVector TangentX, TangentY, TangentZ;
+			GetVertexTangents(ChunkData, VertIdx, TangentX, TangentY, TangentZ);
+
+			VertexBuffers.PositionVertexBuffer.VertexPosition(VertIdx) = FVector3f(ChunkData.GetVertexPosition(VertIdx));
+			VertexBuffers.StaticMeshVertexBuffer.SetVertexTangents(VertIdx, FVector3f(TangentX), FVector3f(TangentY), FVector3f(TangentZ));
+
+			// Grid coordinates as UVs, matching one tile per UV unit
+			const int Row = VertIdx / (ChunkData.GridSize + 1);
+			const int Col = VertIdx % (ChunkData.GridSize + 1);
+			VertexBuffers.StaticMeshVertexBuffer.SetVertexUV(VertIdx, 0, FVector2f(Row, Col));
+		}
+
+		VertexBuffers.PositionVertexBuffer.InitResource(RHICmdList);
+		VertexBuffers.StaticMeshVertexBuffer.InitResource(RHICmdList);
+		VertexBuffers.ColorVertexBuffer.InitResource(RHICmdList);
+
+		// Colour buffer is empty, so it binds the global null colour buffer
+		FLocalVertexFactory::FDataType Data;
+		VertexBuffers.PositionVertexBuffer.BindPositionVertexBuffer(&Section->VertexFactory, Data);
+		VertexBuffers.StaticMeshVertexBuffer.BindTangentVertexBuffer(&Section->VertexFactory, Data);
+		VertexBuffers.StaticMeshVertexBuffer.BindPackedTexCoordVertexBuffer(&Section->VertexFactory, Data);
+		VertexBuffers.StaticMeshVertexBuffer.BindLightMapVertexBuffer(&Section->VertexFactory, Data, 0);
+		VertexBuffers.ColorVertexBuffer.BindColorVertexBuffer(&Section->VertexFactory, Data);
+		Section->VertexFactory.SetData(RHICmdList, Data);
+		Section->VertexFactory.InitResource(RHICmdList);
+
+		return Section;
+	}
+
+	/*
+		Rewrites positions and tangents of an existing section, UVs only depend on the grid so they are left alone
+	*/
+	void WriteVertices_RenderThread(FRHICommandListBase& RHICmdList, FTerrainProxySection* Section, const FTerrainChunkMeshData& ChunkData)
+	{
+		typedef TStaticMeshVertexTangentDatum<FPackedNormal> FTangentDatum;
+
+		const uint32 NumVerts = Section->NumVertices;
+		FRHIBuffer* PositionBuffer = Section->VertexBuffers.PositionVertexBuffer.VertexBufferRHI;
+		FRHIBuffer* TangentBuffer = Section->VertexBuffers.StaticMeshVertexBuffer.TangentsVertexBuffer.VertexBufferRHI;
+
+		FVector3f* Positions = (FVector3f*)RHICmdList.LockBuffer(PositionBuffer, 0, NumVerts * sizeof(FVector3f), RLM_WriteOnly);
+		FTangentDatum* Tangents = (FTangentDatum*)RHICmdList.LockBuffer(TangentBuffer, 0, NumVerts * sizeof(FTangentDatum), RLM_WriteOnly);
+
+		for (uint32 VertIdx = 0; VertIdx < NumVerts; VertIdx++)
+		{
+			FVector TangentX, TangentY, TangentZ;
+			GetVertexTangents(ChunkData, VertIdx, TangentX, TangentY, TangentZ);
+
+			Positions[VertIdx] = FVector3f(ChunkData.GetVertexPosition(VertIdx));
+			Tangents[VertIdx].SetTangents(FVector3f(TangentX), FVector3f(TangentY), FVector3f(TangentZ));
+		}
+
+		RHICmdList.UnlockBuffer(TangentBuffer);
+		RHICmdList.UnlockBuffer(PositionBuffer);
+	}
+
+	void ReleaseSection(int SectionIndex)
+	{
+		FTerrainProxySection* Section = Sections[SectionIndex];
+		if (Section == nullptr) { return; }
+
+		Section->VertexBuffers.PositionVertexBuffer.ReleaseResource();
+		Section->VertexBuffers.StaticMeshVertexBuffer.ReleaseResource();
+		Section->VertexBuffers.ColorVertexBuffer.ReleaseResource();
+		Section->VertexFactory.ReleaseResource();
+		delete Section;
+
+		Sections[SectionIndex] = nullptr;
+	}
+
+	/*
+		Returns the index buffer for a grid size, creating it if this is the first chunk of that size
+	*/
+	FRawStaticIndexBuffer* FindOrCreateIndexBuffer_RenderThread(FRHICommandListBase& RHICmdList, int GridSize)
+	{
+		if (FRawStaticIndexBuffer** Found = SharedIndexBuffers.Find(GridSize)) {
+			return *Found;
+		}
+
+		TArray<uint32> Indices;
+		UTerrainMeshComponent::BuildGridIndices(GridSize, Indices);
+
+		const int NumVertices = (GridSize + 1) * (GridSize + 1);
+		FRawStaticIndexBuffer* IndexBuffer = new FRawStaticIndexBuffer(false);
+		IndexBuffer->SetIndices(Indices, NumVertices <= MAX_uint16 + 1 ? EIndexBufferStride::Force16Bit : EIndexBufferStride::Force32Bit);
+		IndexBuffer->InitResource(RHICmdList);
+
+		SharedIndexBuffers.Add(GridSize, IndexBuffer);
+		return IndexBuffer;
+	}
+
+	static void GetVertexTangents(const FTerrainChunkMeshData& ChunkData, int VertexIndex, FVector& TangentX, FVector& TangentY, FVector& TangentZ)
+	{
+		TangentZ = ChunkData.GetVertexNormal(VertexIndex);
+		TangentX = (FVector::ForwardVector - TangentZ * TangentZ.X).GetSafeNormal();
+		TangentY = FVector::CrossProduct(TangentZ, TangentX);
+	}
+
+private:
+	// Sections by chunk section index, only touched on the render thread
+	TArray<FTerrainProxySection*> Sections;
+
+	// Index buffers keyed by grid size
+	TMap<int, FRawStaticIndexBuffer*> SharedIndexBuffers;
+
+	UMaterialInterface* Material;
+
+	FMaterialRelevance MaterialRelevance;
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+FVector FTerrainChunkMeshData::GetVertexPosition(int VertexIndex) const
+{
+	const FTerrainPackedVertex& Vertex = Vertices[VertexIndex];
+	const int Row = VertexIndex / (GridSize + 1);
+	const int Col = VertexIndex % (GridSize + 1);
+
+	const float Height = MinHeight + (MaxHeight - MinHeight) * (Vertex.Height / (float)MAX_uint16);
+	return FVector(ChunkCoord.X + TileSize * Row, ChunkCoord.Y + TileSize * Col, Height);
+}
+
+FVector FTerrainChunkMeshData::GetVertexNormal(int VertexIndex) const
+{
+	const FTerrainPackedVertex& Vertex = Vertices[VertexIndex];
+	return OctahedralDecode(FVector2D(Vertex.NormalX / (float)MAX_int8, Vertex.NormalY / (float)MAX_int8));
+}
+
+FBox FTerrainChunkMeshData::GetLocalBox() const
+{
+	if (Vertices.Num() == 0) {
+		return FBox(ForceInit);
+	}
+
+	const float Length = GridSize * TileSize;
+	return FBox(FVector(ChunkCoord.X, ChunkCoord.Y, MinHeight), FVector(ChunkCoord.X + Length, ChunkCoord.Y + Length, MaxHeight));
+}
+
+SIZE_T FTerrainChunkMeshData::GetAllocatedSize() const
+{
+	return Vertices.GetAllocatedSize();
+}
+
+FTerrainPackedVertex FTerrainChunkMeshData::PackVertex(float Height, const FVector& Normal) const
+{
+	FTerrainPackedVertex Packed;
+
+	const float Range = MaxHeight - MinHeight;
+	const float Alpha = Range > 0 ? (Height - MinHeight) / Range : 0;
+	Packed.Height = (uint16)FMath::Clamp(FMath::RoundToInt(Alpha * MAX_uint16), 0, MAX_uint16);
+
+	const FVector2D Encoded = OctahedralEncode(Normal);
+	Packed.NormalX = (int8)FMath::Clamp(FMath::RoundToInt(Encoded.X * MAX_int8), -MAX_int8, MAX_int8);
+	Packed.NormalY = (int8)FMath::Clamp(FMath::RoundToInt(Encoded.Y * MAX_int8), -MAX_int8, MAX_int8);
+
+	return Packed;
+}
+
+/*
+	Projects a unit normal onto an octahedron and unfolds it onto a square in [-1, 1]
+*/
+FVector2D FTerrainChunkMeshData::OctahedralEncode(const FVector& Normal)
+{
+	const float L1Norm = FMath::Abs(Normal.X) + FMath::Abs(Normal.Y) + FMath::Abs(Normal.Z);
+	if (L1Norm <= UE_SMALL_NUMBER) {
+		return FVector2D::ZeroVector;
+	}
+
+	FVector2D Result(Normal.X / L1Norm, Normal.Y / L1Norm);
+
+	// Fold the lower hemisphere over the diagonals
+	if (Normal.Z < 0) {
+		const FVector2D Folded = Result;
+		Result.X = (1 - FMath::Abs(Folded.Y)) * (Folded.X >= 0 ? 1 : -1);
+		Result.Y = (1 - FMath::Abs(Folded.X)) * (Folded.Y >= 0 ? 1 : -1);
+	}
+
+	return Result;
+}
+
+FVector FTerrainChunkMeshData::OctahedralDecode(const FVector2D& Encoded)
+{
+	FVector Normal(Encoded.X, Encoded.Y, 1 - FMath::Abs(Encoded.X) - FMath::Abs(Encoded.Y));
+
+	const float T = FMath::Max(-Normal.Z, 0.0f);
+	Normal.X += Normal.X >= 0 ? -T : T;
+	Normal.Y += Normal.Y >= 0 ? -T : T;
+
+	return Normal.GetSafeNormal(UE_SMALL_NUMBER, FVector::UpVector);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UTerrainMeshComponent::UTerrainMeshComponent(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// Ticks to commit queued chunk changes
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = true;
+
+	// Collision is handled by a separate procedural mesh in the terrain loader
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+}
+
+void UTerrainMeshComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	CommitPendingChunks(MaxUploadVerticesPerFrame);
+}
+
+void UTerrainMeshComponent::SetChunkSection(int32 SectionIndex, FTerrainChunkMeshData&& ChunkData, bool bUrgent, int32 TraceId)
+{
+	check(IsInGameThread());
+
+	if (SectionIndex >= ChunkSections.Num()) {
+		ChunkSections.SetNum(SectionIndex + 1);
+		while (SectionTraceIds.Num() < ChunkSections.Num()) {
+			SectionTraceIds.Add(INDEX_NONE);
+		}
+	}
+	SectionTraceIds[SectionIndex] = TraceId;
+
+	DEC_MEMORY_STAT_BY(STAT_LumberTerrainSectionMemory, ChunkSections[SectionIndex].GetAllocatedSize());
+	ChunkSections[SectionIndex] = MoveTemp(ChunkData);
+	INC_MEMORY_STAT_BY(STAT_LumberTerrainSectionMemory, ChunkSections[SectionIndex].GetAllocatedSize());
+	QueueSectionUpdate(SectionIndex, bUrgent);
+}
+
+void UTerrainMeshComponent::ClearChunkSection(int32 SectionIndex)
+{
+	if (!ChunkSections.IsValidIndex(SectionIndex)) { return; }
+
+	DEC_MEMORY_STAT_BY(STAT_LumberTerrainSectionMemory, ChunkSections[SectionIndex].GetAllocatedSize());
+	ChunkSections[SectionIndex] = FTerrainChunkMeshData();
+	SectionTraceIds[SectionIndex] = INDEX_NONE;
+	QueueSectionUpdate(SectionIndex);
+}
+
+void UTerrainMeshComponent::ClearAllChunkSections()
+{
+	for (const FTerrainChunkMeshData& ChunkData : ChunkSections)
+	{
+		DEC_MEMORY_STAT_BY(STAT_LumberTerrainSectionMemory, ChunkData.GetAllocatedSize());
+	}
+	ChunkSections.Empty();
+	PendingSections.Empty();
+	SectionTraceIds.Empty();
+
+	UpdateLocalBounds();
+	MarkRenderStateDirty();
+}
+
+void UTerrainMeshComponent::QueueSectionUpdate(int32 SectionIndex, bool bUrgent)
+{
+	if (bUrgent) {
+		PendingSections.Remove(SectionIndex);
+		PendingSections.Insert(SectionIndex, 0);
+		return;
+	}
+
+	// A section changed twice before being committed only needs to be uploaded once
+	PendingSections.AddUnique(SectionIndex);
+}
+
+int UTerrainMeshComponent::CommitPendingChunks(int VertexBudget)
+{
+	if (PendingSections.Num() == 0) { return 0; }
+
+	// Without a proxy there is nothing to update, the next proxy is built from every chunk anyway
+	if (SceneProxy == nullptr) {
+		for (int32 SectionIndex : PendingSections) {
+			MarkSectionApplied(SectionIndex);
+		}
+		PendingSections.Empty();
+		UpdateLocalBounds();
+		MarkRenderStateDirty();
+		return 0;
+	}
+
+	// Take chunks in order until the vertex budget is used up, always taking at least one so the queue keeps moving
+	static const FTerrainChunkMeshData EmptyChunk;
+	TArray<FTerrainSectionUpdate> Updates;
+	int UsedVertices = 0;
+	int NumCommitted = 0;
+	bool bBoundsGrew = false;
+
+	while (NumCommitted < PendingSections.Num())
+	{
+		const int32 SectionIndex = PendingSections[NumCommitted];
+		const FTerrainChunkMeshData& ChunkData = ChunkSections.IsValidIndex(SectionIndex) ? ChunkSections[SectionIndex] : EmptyChunk;
+
+		if (NumCommitted > 0 && UsedVertices + ChunkData.GetNumVertices() > VertexBudget) { break; }
+
+		FTerrainSectionUpdate& Update = Updates.AddDefaulted_GetRef();
+		Update.SectionIndex = SectionIndex;
+		Update.ChunkData = ChunkData;
+
+		UsedVertices += ChunkData.GetNumVertices();
+		NumCommitted++;
+		MarkSectionApplied(SectionIndex);
+
+		if (ChunkData.GetNumVertices() > 0 && !LocalBounds.GetBox().IsInside(ChunkData.GetLocalBox())) {
+			bBoundsGrew = true;
+		}
+	}
+
+	PendingSections.RemoveAt(0, NumCommitted);
+
+	// Bounds only ever need to grow for new chunks to be drawn, this is a transform update rather than a new proxy
+	if (bBoundsGrew) {
+		UpdateLocalBounds();
+	}
+
+	FTerrainMeshSceneProxy* TerrainProxy = (FTerrainMeshSceneProxy*)SceneProxy;
+	ENQUEUE_RENDER_COMMAND(UpdateTerrainChunkSections)(
+		[TerrainProxy, Updates = MoveTemp(Updates)](FRHICommandListImmediate& RHICmdList)
+		{
+			TerrainProxy->UpdateSections_RenderThread(RHICmdList, Updates);
+		});
+
+	return NumCommitted;
+}
+
+void UTerrainMeshComponent::MarkSectionApplied(int32 SectionIndex)
+{
+	if (!SectionTraceIds.IsValidIndex(SectionIndex) || SectionTraceIds[SectionIndex] == INDEX_NONE) { return; }
+
+	if (LifecycleTracer != nullptr) {
+		LifecycleTracer->Mark(SectionTraceIds[SectionIndex], EChunkLifecycleEvent::SectionApplied);
+	}
+	SectionTraceIds[SectionIndex] = INDEX_NONE;
+}
+
+const FTerrainChunkMeshData* UTerrainMeshComponent::GetChunkSection(int32 SectionIndex) const
+{
+	if (!ChunkSections.IsValidIndex(SectionIndex)) { return nullptr; }
+	return &ChunkSections[SectionIndex];
+}
+
+SIZE_T UTerrainMeshComponent::GetChunkSectionsAllocatedSize() const
+{
+	SIZE_T Size = ChunkSections.GetAllocatedSize() + PendingSections.GetAllocatedSize();
+	for (const FTerrainChunkMeshData& ChunkData : ChunkSections)
+	{
+		Size += ChunkData.GetAllocatedSize();
+	}
+	return Size;
+}
+
+FPrimitiveSceneProxy* UTerrainMeshComponent::CreateSceneProxy()
+{
+	// Proxy is created even without chunks so that later chunks can be added to it in place
+	return new FTerrainMeshSceneProxy(this);
+}
+
+int32 UTerrainMeshComponent::GetNumMaterials() const
+{
+	// Every chunk uses the same terrain material
+	return 1;
+}
+
+FBoxSphereBounds UTerrainMeshComponent::CalcBounds(const FTransform& LocalToWorld) const
+{
+	FBoxSphereBounds Ret(LocalBounds.TransformBy(LocalToWorld));
+
+	Ret.BoxExtent *= BoundsScale;
+	Ret.SphereRadius *= BoundsScale;
+
+	return Ret;
+}
+
+void UTerrainMeshComponent::UpdateLocalBounds()
+{
+	FBox LocalBox(ForceInit);
+
+	for (const FTerrainChunkMeshData& ChunkData : ChunkSections)
+	{
+		LocalBox += ChunkData.GetLocalBox();
+	}
+
+	LocalBounds = LocalBox.IsValid ? FBoxSphereBounds(LocalBox) : FBoxSphereBounds(FVector(0, 0, 0), FVector(0, 0, 0), 0);
+
+	UpdateBounds();
+	MarkRenderTransformDirty();
+}
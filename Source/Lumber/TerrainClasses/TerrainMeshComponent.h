@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/MeshComponent.h"
+#include "TerrainMeshComponent.generated.h"
+
+class FChunkLifecycleTracer;
+class FPrimitiveSceneProxy;
+
+/*
+	Packed terrain vertex, 4 bytes per vertex instead of the ~150 bytes of FProcMeshVertex.
+	X and Y are not stored since they can be derived from the vertex index and the chunk's grid,
+	height is quantised between the chunk's min and max height, and the normal is octahedral encoded
+*/
+struct FTerrainPackedVertex {
+	uint16 Height = 0;
+	int8 NormalX = 0;
+	int8 NormalY = 0;
+};
+
+/*
+	Compact mesh data of a single terrain chunk. Index data is not stored since every chunk with the same
+	grid size shares the same triangles, the scene proxy builds one shared 16 bit index buffer per grid size instead.
+*/
+struct FTerrainChunkMeshData {
+
+	// Location of the first vertex of the chunk, in the component's local space
+	FVector2D ChunkCoord = FVector2D::ZeroVector;
+
+	// Number of tiles along each side of the chunk, the chunk has (GridSize + 1) x (GridSize + 1) vertices
+	int GridSize = 0;
+
+	// Length and width of each tile
+	int TileSize = 0;
+
+	// Range that the quantised heights are mapped to
+	float MinHeight = 0;
+	float MaxHeight = 0;
+
+	TArray<FTerrainPackedVertex> Vertices;
+
+public:
+	int GetNumVertices() const { return Vertices.Num(); }
+
+	int GetNumIndices() const { return GridSize * GridSize * 6; }
+
+	/*
+		Decodes the position of a vertex from its index in the grid and its quantised height
+	*/
+	FVector GetVertexPosition(int VertexIndex) const;
+
+	/*
+		Decodes the octahedral encoded normal of a vertex
+	*/
+	FVector GetVertexNormal(int VertexIndex) const;
+
+	FBox GetLocalBox() const;
+
+	SIZE_T GetAllocatedSize() const;
+
+	/*
+		Quantises a height and encodes a normal into a packed vertex, MinHeight and MaxHeight must already be set
+	*/
+	FTerrainPackedVertex PackVertex(float Height, const FVector& Normal) const;
+
+	static FVector2D OctahedralEncode(const FVector& Normal);
+	static FVector OctahedralDecode(const FVector2D& Encoded);
+};
+
+/*
+	Update of a single chunk section sent to the scene proxy, empty chunk data removes the section
+*/
+struct FTerrainSectionUpdate {
+	int32 SectionIndex = -1;
+	FTerrainChunkMeshData ChunkData;
+};
+
+/*
+	Lightweight replacement for UProceduralMeshComponent used to render the visual terrain.
+	Each section holds one chunk in the packed vertex format, and sections share 16 bit index buffers per grid size.
+	Chunk changes are not sent to the render thread straight away, they are queued and committed in batches each tick,
+	and the scene proxy updates the buffers of that section in place instead of the whole proxy being recreated.
+	Collision is not handled by this component, see ATerrainLoader::CollisionMesh.
+*/
+UCLASS(ClassGroup = (Rendering), meta = (BlueprintSpawnableComponent))
+class LUMBER_API UTerrainMeshComponent : public UMeshComponent
+{
+	GENERATED_BODY()
+
+public:
+	// Maximum vertices that are uploaded to the render thread in one frame, at least one chunk is always committed per frame
+	UPROPERTY(BlueprintReadWrite, EditAnywhere)
+	int MaxUploadVerticesPerFrame = 25000;
+
+public:
+	UTerrainMeshComponent(const FObjectInitializer& ObjectInitializer);
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/*
+		Replaces the chunk at given section index, must be called on the game thread.
+		The change is queued and uploaded by CommitPendingChunks, urgent chunks skip to the front of the queue.
+		A chunk load's trace id is marked as applied once the section is committed
+	*/
+	void SetChunkSection(int32 SectionIndex, FTerrainChunkMeshData&& ChunkData, bool bUrgent = false, int32 TraceId = INDEX_NONE);
+
+	void ClearChunkSection(int32 SectionIndex);
+
+	void ClearAllChunkSections();
+
+	/*
+		Sends queued chunk changes to the scene proxy in one render command, until the vertex budget is used up.
+		Returns the number of chunks committed
+	*/
+	int CommitPendingChunks(int VertexBudget);
+
+	const FTerrainChunkMeshData* GetChunkSection(int32 SectionIndex) const;
+
+	int32 GetNumChunkSections() const { return ChunkSections.Num(); }
+
+	int32 GetNumPendingChunks() const { return PendingSections.Num(); }
+
+	/*
+		Tracer that committed sections are marked applied in, must outlive the component
+	*/
+	void SetLifecycleTracer(FChunkLifecycleTracer* NewLifecycleTracer) { LifecycleTracer = NewLifecycleTracer; }
+
+	/*
+		Returns bytes of CPU memory held by the chunk sections
+	*/
+	SIZE_T GetChunkSectionsAllocatedSize() const;
+
+	/*
+		Builds the triangles of a chunk grid, shared between all chunks with the same grid size
+	*/
+	template<typename IndexType>
+	static void BuildGridIndices(int GridSize, TArray<IndexType>& OutIndices);
+
+public:
+	//~ Begin UPrimitiveComponent Interface.
+	virtual FPrimitiveSceneProxy* CreateSceneProxy() override;
+	//~ End UPrimitiveComponent Interface.
+
+	//~ Begin UMeshComponent Interface.
+	virtual int32 GetNumMaterials() const override;
+	//~ End UMeshComponent Interface.
+
+private:
+	//~ Begin USceneComponent Interface.
+	virtual FBoxSphereBounds CalcBounds(const FTransform& LocalToWorld) const override;
+	//~ End USceneComponent Interface.
+
+	void UpdateLocalBounds();
+
+	void QueueSectionUpdate(int32 SectionIndex, bool bUrgent = false);
+
+	void MarkSectionApplied(int32 SectionIndex);
+
+private:
+	// Chunk data stored by section index, chunks with no vertices are empty sections
+	TArray<FTerrainChunkMeshData> ChunkSections;
+
+	// Section indices changed since they were last sent to the scene proxy, in order of change
+	TArray<int32> PendingSections;
+
+	// Trace id of the chunk load each pending section came from, by section index
+	TArray<int32> SectionTraceIds;
+
+	FChunkLifecycleTracer* LifecycleTracer = nullptr;
+
+	// Union of all the chunk section bounds
+	FBoxSphereBounds LocalBounds;
+
+	friend class FTerrainMeshSceneProxy;
+};
+
+template<typename IndexType>
+void UTerrainMeshComponent::BuildGridIndices(int GridSize, TArray<IndexType>& OutIndices)
+{
+	OutIndices.Reset(GridSize * GridSize * 6);
+
+	// Same winding as ATerrainLoader::GetChunkRenderData
+	for (int row_i = 0; row_i < GridSize; row_i++) {
+		for (int col_i = 0; col_i < GridSize; col_i++) {
+			OutIndices.Add(row_i * (GridSize + 1) + col_i);
+			OutIndices.Add(row_i * (GridSize + 1) + col_i + 1);
+			OutIndices.Add((row_i + 1) * (GridSize + 1) + col_i + 1);
+
+			OutIndices.Add(row_i * (GridSize + 1) + col_i);
+			OutIndices.Add((row_i + 1) * (GridSize + 1) + col_i + 1);
+			OutIndices.Add((row_i + 1) * (GridSize + 1) + col_i);
+		}
+	}
+}
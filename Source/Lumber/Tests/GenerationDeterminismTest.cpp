@@ -0,0 +1,304 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Async/ParallelFor.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Hash/CityHash.h"
+#include "Misc/ConfigCacheIni.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "../LumberGameMode.h"
+#include "../Loaders/ChunkLoader.h"
+#include "../Loaders/TerrainLoader.h"
+#include "../TerrainClasses/TerrainMeshComponent.h"
+#include "../TreeClasses/Tree.h"
+#include "../TreeClasses/TreeRoot.h"
+
+/*
+	Hash of the buffers the game actually uploads. Floats are rounded to a thousandth like in Tools/GenerationBenchmark,
+	so a last bit difference in the maths library doesn't count as different content
+*/
+struct FGeneratedContentHash {
+	uint64 Value = 0;
+
+	void Add(const void* Data, SIZE_T NumBytes) {
+		Value = CityHash64WithSeed(static_cast<const char*>(Data), NumBytes, Value);
+	}
+
+	template<typename ElementType>
+	void AddArray(const TArray<ElementType>& Elements) { Add(Elements.GetData(), Elements.Num() * sizeof(ElementType)); }
+
+	void AddRounded(double Number) {
+		const int64 Rounded = int64(FMath::RoundHalfFromZero(Number * 1000.0));
+		Add(&Rounded, sizeof(Rounded));
+	}
+
+	void AddRounded(const FVector& Vector) {
+		AddRounded(Vector.X);
+		AddRounded(Vector.Y);
+		AddRounded(Vector.Z);
+	}
+
+	void AddRounded(const FVector2D& Vector) {
+		AddRounded(Vector.X);
+		AddRounded(Vector.Y);
+	}
+
+	void AddMesh(const FProcMeshInfo& MeshInfo) {
+		for (const FVector& Vertex : MeshInfo.Vertices) { AddRounded(Vertex); }
+		for (const FVector& Normal : MeshInfo.Normals) { AddRounded(Normal); }
+		for (const FVector2D& UV : MeshInfo.UVs) { AddRounded(UV); }
+		for (const FProcMeshTangent& Tangent : MeshInfo.MeshTangents) {
+			AddRounded(Tangent.TangentX);
+			Add(&Tangent.bFlipTangentY, sizeof(Tangent.bFlipTangentY));
+		}
+		AddArray(MeshInfo.Triangles);
+		AddArray(MeshInfo.Colors);
+	}
+};
+
+/*
+	Hashes of each kind of buffer the game uploads, so a golden mismatch says which one changed
+*/
+struct FGenerationHashes {
+	uint64 TerrainVertices = 0;
+	uint64 TerrainIndices = 0;
+	uint64 Logs = 0;
+	uint64 Leaves = 0;
+};
+
+/*
+	Runs Body for every index spread over at most NumThreads threads, 0 for as many as ParallelFor uses
+*/
+static void RunOnThreads(int32 Num, int32 NumThreads, TFunctionRef<void(int32)> Body) {
+	if (NumThreads == 0) {
+		ParallelFor(Num, Body);
+		return;
+	}
+
+	ParallelFor(NumThreads, [&](int32 Thread) {
+		for (int32 Index = Thread; Index < Num; Index += NumThreads) {
+			Body(Index);
+		}
+	}, NumThreads == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+}
+
+/*
+	Packed vertices of a grid of chunks at every visual quality, and the index buffer the scene proxy draws each grid size
+	with. Without a thread cap each chunk also splits its rows across ParallelFor like the loader does
+*/
+static void HashTerrain(ATerrainLoader* TerrainLoader, float ChunkSpacing, int32 NumThreads, FGenerationHashes& OutHashes) {
+	const int32 GridChunks = 4;
+	const EChunkQuality Qualities[] = { EChunkQuality::Low, EChunkQuality::Medium, EChunkQuality::High };
+	const int32 NumChunks = int32(UE_ARRAY_COUNT(Qualities)) * GridChunks * GridChunks;
+
+	TArray<FTerrainChunkMeshData> Chunks;
+	Chunks.SetNum(NumChunks);
+	RunOnThreads(NumChunks, NumThreads, [&](int32 Index) {
+		const int32 ChunkIndex = Index % (GridChunks * GridChunks);
+		const FVector2D ChunkCoord = FVector2D(ChunkIndex / GridChunks, ChunkIndex % GridChunks) * ChunkSpacing;
+		TerrainLoader->GetChunkTerrainData(&Chunks[Index], ChunkCoord, Qualities[Index / (GridChunks * GridChunks)], NumThreads == 0);
+	});
+
+	FGeneratedContentHash VertexHash;
+	FGeneratedContentHash IndexHash;
+	for (const FTerrainChunkMeshData& ChunkData : Chunks) {
+		const int32 Ints[] = { ChunkData.GridSize, ChunkData.TileSize };
+		VertexHash.Add(Ints, sizeof(Ints));
+		VertexHash.AddRounded(ChunkData.ChunkCoord);
+		VertexHash.AddRounded(ChunkData.MinHeight);
+		VertexHash.AddRounded(ChunkData.MaxHeight);
+		VertexHash.AddArray(ChunkData.Vertices);
+
+		TArray<uint32> Indices;
+		UTerrainMeshComponent::BuildGridIndices(ChunkData.GridSize, Indices);
+		IndexHash.AddArray(Indices);
+	}
+
+	OutHashes.TerrainVertices = VertexHash.Value;
+	OutHashes.TerrainIndices = IndexHash.Value;
+}
+
+/*
+	Low quality meshes and every log's high quality mesh of a patch of trees, with the trees spread across threads like
+	tree generation jobs
+*/
+static void HashTrees(UWorld* World, TSubclassOf<ATreeRoot> TreeRootClass, int32 NumThreads, FGenerationHashes& OutHashes) {
+	const int32 NumTrees = 64;
+
+	// Roots are spawned on the game thread without beginning play, only their generation runs on the workers
+	TArray<ATreeRoot*> TreeRoots;
+	for (int32 TreeIndex = 0; TreeIndex < NumTrees; TreeIndex++) {
+		ATreeRoot* TreeRoot = World->SpawnActor<ATreeRoot>(TreeRootClass);
+		TreeRoot->TreeSeed = LumberCore::GetTreeSeed(1337, TreeIndex / 8 * 1000, TreeIndex % 8 * 1000);
+		TreeRoots.Add(TreeRoot);
+	}
+
+	TArray<TArray<FProcMeshInfo>> LogMeshes;
+	TArray<TArray<FProcMeshInfo>> LeafMeshes;
+	LogMeshes.SetNum(NumTrees);
+	LeafMeshes.SetNum(NumTrees);
+	RunOnThreads(NumTrees, NumThreads, [&](int32 TreeIndex) {
+		ATreeRoot* TreeRoot = TreeRoots[TreeIndex];
+		TreeRoot->GenerateTreeData();
+		TreeRoot->GenerateMeshOnly();
+
+		// The meshes interactive trees give their logs
+		for (int32 BranchIndex = 0; BranchIndex < int32(TreeRoot->Skeleton.Num()); BranchIndex++) {
+			const FData Data = TreeRoot->GetBranchData(BranchIndex);
+			const FRandomStream LogStream(TreeRoot->TreeSeed);
+			LogMeshes[TreeIndex].Add(ATree::CreateMeshData(Data.bMakeLeaves, Data, LogStream, EChunkQuality::High, FVector::ZeroVector, FVector::UpVector));
+			if (Data.bMakeLeaves) {
+				LeafMeshes[TreeIndex].Add(ATree::CreateLeavesMeshData(Data, LogStream, FVector::ZeroVector, FVector::UpVector));
+			}
+		}
+	});
+
+	FGeneratedContentHash LogHash;
+	FGeneratedContentHash LeafHash;
+	for (int32 TreeIndex = 0; TreeIndex < NumTrees; TreeIndex++) {
+		LogHash.AddMesh(TreeRoots[TreeIndex]->LogMeshInfo);
+		for (const FProcMeshInfo& LogMesh : LogMeshes[TreeIndex]) {
+			LogHash.AddMesh(LogMesh);
+		}
+		LeafHash.AddMesh(TreeRoots[TreeIndex]->LeavesMeshInfo);
+		for (const FProcMeshInfo& LeafMesh : LeafMeshes[TreeIndex]) {
+			LeafHash.AddMesh(LeafMesh);
+		}
+
+		TreeRoots[TreeIndex]->Skeleton.Release();
+		TreeRoots[TreeIndex]->Destroy();
+	}
+
+	OutHashes.Logs = LogHash.Value;
+	OutHashes.Leaves = LeafHash.Value;
+}
+
+/*
+	Golden hashes are checked in as hex strings, JSON numbers can't hold every uint64
+*/
+static bool LoadGoldenHashes(const FString& FilePath, TMap<FString, uint64>& OutHashes) {
+	FString JsonString;
+	if (!FFileHelper::LoadFileToString(JsonString, *FilePath)) { return false; }
+
+	TSharedPtr<FJsonObject> JsonObject;
+	TSharedRef<TJsonReader<>> Reader = TJsonReaderFactory<>::Create(JsonString);
+	if (!FJsonSerializer::Deserialize(Reader, JsonObject) || !JsonObject.IsValid()) { return false; }
+
+	// Fields starting with an underscore are notes, not hashes
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& Field : JsonObject->Values) {
+		FString HashString;
+		if (!Field.Key.StartsWith(TEXT("_")) && Field.Value->TryGetString(HashString)) {
+			OutHashes.Add(Field.Key, FCString::Strtoui64(*HashString, nullptr, 16));
+		}
+	}
+	return true;
+}
+
+static bool SaveGoldenHashes(const FString& FilePath, const TMap<FString, uint64>& Hashes) {
+	TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject());
+	for (const TPair<FString, uint64>& Hash : Hashes) {
+		JsonObject->SetStringField(Hash.Key, FString::Printf(TEXT("%016llx"), Hash.Value));
+	}
+
+	FString JsonString;
+	TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&JsonString);
+	return FJsonSerializer::Serialize(JsonObject.ToSharedRef(), Writer) && FFileHelper::SaveStringToFile(JsonString, *FilePath);
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLumberGenerationDeterminismTest, "Lumber.Generation.Determinism",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+/*
+	Generated content must be the same on 1, 2 or every thread, every time it is generated, and match the checked-in
+	Benchmarks/GenerationGoldenHashes.json. Run with -LumberWriteGoldens on the reference machine to record new goldens
+	after an intended change to the generated world
+*/
+bool FLumberGenerationDeterminismTest::RunTest(const FString& Parameters)
+{
+	// The game mode holds the terrain loader class, world settings and tree root class the game runs with
+	FString GameModeClassPath;
+	GConfig->GetString(TEXT("/Script/EngineSettings.GameMapsSettings"), TEXT("GlobalDefaultGameMode"), GameModeClassPath, GEngineIni);
+	UClass* GameModeClass = LoadClass<ALumberGameMode>(nullptr, *GameModeClassPath);
+	if (!TestNotNull(TEXT("Game mode class"), GameModeClass)) {
+		return false;
+	}
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	// Loaders are created without BeginPlay, so nothing streams around a player and no worker threads start
+	ALumberGameMode* Gamemode = World->SpawnActor<ALumberGameMode>(GameModeClass);
+	Gamemode->CreateLoaders();
+	ATerrainLoader* TerrainLoader = Gamemode->GetTerrainLoader();
+	TerrainLoader->SetSeed(1337);
+	const float ChunkSpacing = Gamemode->GetChunkLoader()->totalChunkSize;
+	const bool bHasTreeRootClass = TestNotNull(TEXT("Tree root class"), Gamemode->TreeRootBlueprintClass.Get());
+
+	// Single threaded first, every other run is compared against it. The last run repeats every thread, to catch content
+	// that changes from one generation to the next
+	const int32 ThreadCounts[] = { 1, 2, 0, 0 };
+	const TCHAR* RunNames[] = { TEXT("on 1 thread"), TEXT("on 2 threads"), TEXT("on every thread"), TEXT("generated again") };
+	FGenerationHashes SerialHashes;
+	for (int32 Run = 0; Run < int32(UE_ARRAY_COUNT(ThreadCounts)); Run++) {
+		const int32 NumThreads = ThreadCounts[Run];
+		const TCHAR* RunName = RunNames[Run];
+
+		FGenerationHashes Hashes;
+		HashTerrain(TerrainLoader, ChunkSpacing, NumThreads, Hashes);
+		if (bHasTreeRootClass) {
+			HashTrees(World, Gamemode->TreeRootBlueprintClass, NumThreads, Hashes);
+		}
+
+		if (Run == 0) {
+			SerialHashes = Hashes;
+			continue;
+		}
+		TestEqual(FString::Printf(TEXT("Terrain vertices are the same %s"), RunName), Hashes.TerrainVertices, SerialHashes.TerrainVertices);
+		TestEqual(FString::Printf(TEXT("Terrain indices are the same %s"), RunName), Hashes.TerrainIndices, SerialHashes.TerrainIndices);
+		TestEqual(FString::Printf(TEXT("Logs are the same %s"), RunName), Hashes.Logs, SerialHashes.Logs);
+		TestEqual(FString::Printf(TEXT("Leaves are the same %s"), RunName), Hashes.Leaves, SerialHashes.Leaves);
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	// Runs only agree with each other above, the goldens catch a change to the world that every run makes the same way
+	TMap<FString, uint64> Hashes;
+	Hashes.Add(TEXT("TerrainVertices"), SerialHashes.TerrainVertices);
+	Hashes.Add(TEXT("TerrainIndices"), SerialHashes.TerrainIndices);
+	if (bHasTreeRootClass) {
+		Hashes.Add(TEXT("Logs"), SerialHashes.Logs);
+		Hashes.Add(TEXT("Leaves"), SerialHashes.Leaves);
+	}
+
+	const FString GoldenPath = FPaths::ProjectDir() / TEXT("Benchmarks/GenerationGoldenHashes.json");
+	if (FParse::Param(FCommandLine::Get(), TEXT("LumberWriteGoldens"))) {
+		TestTrue(TEXT("Golden hashes written"), SaveGoldenHashes(GoldenPath, Hashes));
+		return true;
+	}
+
+	TMap<FString, uint64> GoldenHashes;
+	if (!LoadGoldenHashes(GoldenPath, GoldenHashes)) {
+		AddError(FString::Printf(TEXT("Golden hashes at %s couldn't be read"), *GoldenPath));
+		return true;
+	}
+	for (const TPair<FString, uint64>& Hash : Hashes) {
+		const uint64* GoldenHash = GoldenHashes.Find(Hash.Key);
+		if (GoldenHash == nullptr) {
+			AddError(FString::Printf(TEXT("%s has no golden hash in %s, record it with -LumberWriteGoldens on the reference machine"), *Hash.Key, *GoldenPath));
+			continue;
+		}
+		TestEqual(FString::Printf(TEXT("%s match the golden hash"), *Hash.Key), FString::Printf(TEXT("%016llx"), Hash.Value), FString::Printf(TEXT("%016llx"), *GoldenHash));
+	}
+	return true;
+}
+
+#endif
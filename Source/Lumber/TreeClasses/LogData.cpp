@@ -1,9 +0,0 @@
-// Fill out your copyright notice in the Description page of Project Settings.
-
-
-#include "LogData.h"
-
-ULogData::ULogData()
-{
-
-}
\ No newline at end of file
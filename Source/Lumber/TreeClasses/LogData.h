@@ -101,17 +101,3 @@ struct FData {
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	UMaterialInterface* CrossSectionMaterial;
 };
-
-UCLASS()
-class LUMBER_API ULogData : public UObject
-{
-	GENERATED_BODY()
-public:
-	ULogData();
-
-	ULogData *Parent;
-	TArray<ULogData*> Children;
-
-	UPROPERTY(BlueprintReadWrite, EditAnywhere)
-	FData Data;
-};
\ No newline at end of file
@@ -6,7 +6,6 @@
 #include "KismetProceduralMeshLibrary.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Engine/Engine.h"
-#include "DrawDebugHelpers.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/BoxComponent.h"
 #include "PaperSpriteComponent.h"
@@ -19,6 +18,13 @@
 #include "../LumberGameMode.h"
 #include "TreeRoot.h"
 #include "../Loaders/ChunkLoader.h"
+#include "../Loaders/GameThreadWorkQueue.h"
+#include "../Lumber.h"
+#include "../LumberDebug.h"
+
+DECLARE_CYCLE_STAT(TEXT("Cut tree"), STAT_Lumber_CutTree, STATGROUP_Lumber);
+
+int32 ATree::NumInWorld = 0;
 
 #define GamePriority ENamedThreads::GameThread
 #define BackgroundPriority ENamedThreads::AnyBackgroundHiPriTask
@@ -48,6 +54,15 @@ ATree::ATree()
 void ATree::BeginPlay()
 {
 	Super::BeginPlay();
+	INC_DWORD_STAT(STAT_LumberTreeActors);
+	NumInWorld++;
+}
+
+void ATree::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DEC_DWORD_STAT(STAT_LumberTreeActors);
+	NumInWorld--;
+	Super::EndPlay(EndPlayReason);
 }
 
 FProcMeshInfo ATree::CreateMeshData(bool bBuildLeaves, FData NewLogData, FRandomStream NumberStream, EChunkQuality RenderQuality = EChunkQuality::Low, FVector LocalOrigin = FVector::ZeroVector, FVector UpVector = FVector::UpVector) {
@@ -66,18 +81,19 @@ FProcMeshInfo ATree::CreateMeshData(bool bBuildLeaves, FData NewLogData, FRandom
 
 /* builds geometry for this branch */
 void ATree::BuildTreeMesh(bool bBuildLeaves) {
+	FGameThreadWorkQueue& GameThreadWork = FGameThreadWorkQueue::Get(this);
 
 	if (!ThisLogData.bMakeLeaves) {
 		// make empty mesh section as placeholder for leaves
-		AsyncTask(GamePriority, [this]() {
+		GameThreadWork.Enqueue(EGameThreadWorkCategory::TreeMesh, EJobPriority::Near, [this]() {
 			Mesh->CreateMeshSection(0, TArray<FVector>(), TArray<int32>(), TArray<FVector>(), TArray<FVector2D>(), TArray<FColor>(), TArray<FProcMeshTangent>(), false);
-		});
+		}, TreeRoot->SourceChunk);
 	}
 	else {
 		FProcMeshInfo NewLeavesMeshInfo = CreateLeavesMeshData(ThisLogData, TreeRoot->NumberStream, FVector::ZeroVector, FVector::UpVector);
 		LeafMeshInfo = NewLeavesMeshInfo;
 
-		AsyncTask(GamePriority, [this]() {
+		GameThreadWork.Enqueue(EGameThreadWorkCategory::TreeMesh, EJobPriority::Near, [this]() {
 			Mesh->CreateMeshSection(
 				LeafMeshInfo.Index,
 				LeafMeshInfo.Vertices,
@@ -90,13 +106,13 @@ void ATree::BuildTreeMesh(bool bBuildLeaves) {
 			);
 
 		Mesh->SetMaterial(LeafMeshIndex, ThisLogData.LeafMaterial);
-		});
+		}, TreeRoot->SourceChunk);
 	}
 
 	FProcMeshInfo NewMeshInfo = CreateMeshData(bBuildLeaves, ThisLogData, TreeRoot->NumberStream);
 	BranchMeshInfo = NewMeshInfo;
 
-	AsyncTask(GamePriority, [this]() {
+	GameThreadWork.Enqueue(EGameThreadWorkCategory::TreeMesh, EJobPriority::Near, [this]() {
 		Mesh->CreateMeshSection(
 			BranchMeshInfo.Index,
 			BranchMeshInfo.Vertices,
@@ -109,7 +125,7 @@ void ATree::BuildTreeMesh(bool bBuildLeaves) {
 		);
 
 		Mesh->SetMaterial(LogMeshIndex, ThisLogData.LogMaterial);
-	});
+	}, TreeRoot->SourceChunk);
 }
 
 /* creates geometry at index 0 for this tree */
@@ -158,13 +174,13 @@ FProcMeshInfo ATree::CreateLeavesMeshData(FData NewLogData, FRandomStream Number
 			LeafNormals.Add(RandomNormals[j]);
 
 			FVector LeafPoint = FVector(RandLeafX, RandLeafY, NewLogData.BranchHeight + RandLeafZ);
-			int leafSizeMult = FMath::RandRange(0.5, 1.5);
+			const float LeafSizeMult = ATreeRoot::FRandRange(0.5f, 1.5f, NumberStream);
 
 			// projects a random point to the plane to get the location of the first point of the leaf vertex
 			FVector next_vertex_offset = FVector::VectorPlaneProject(
 				FVector(ATreeRoot::FRandRange(-1.0f, 1.0f, NumberStream), ATreeRoot::FRandRange(-1.0f, 1.0f, NumberStream), ATreeRoot::FRandRange(-1.0f, 1.0f, NumberStream)),
 				RandomNormals[j]
-			).GetSafeNormal() * NewLogData.LeafSize * leafSizeMult;
+			).GetSafeNormal() * NewLogData.LeafSize * LeafSizeMult;
 			//DrawDebugPoint(GetWorld(), next_vertex_offset, 4, FColor::Green, false, 10, 6);
 
 			TArray<int32> Verts;
@@ -440,6 +456,9 @@ void ATree::GenerateMeshRecursive(ATree* BranchToGenerate) {
 
 /* cuts the tree */
 void ATree::CutTree(FVector CutLocation, UProceduralMeshComponent *ProcMesh, ATree *Tree) {
+	LUMBER_SCOPE(LumberTrees, CutTree);
+	FScopedGameThreadWork ScopedWork(FGameThreadWorkQueue::Get(this), EGameThreadWorkCategory::TreeCut, TreeRoot != nullptr ? TreeRoot->SourceChunk : INDEX_NONE);
+
 	FVector BottomLocation = ProcMesh->GetComponentLocation();
 	FVector TopLocation = BottomLocation + ProcMesh->GetUpVector() * ThisLogData.BranchHeight;
 
@@ -462,7 +481,7 @@ void ATree::CutTree(FVector CutLocation, UProceduralMeshComponent *ProcMesh, ATr
 		}
 	}
 
-	GEngine->AddOnScreenDebugMessage(356, 10, FColor::Red, FString::SanitizeFloat(MinimumDistance));
+	LUMBER_DEBUG_MESSAGE(TreeCuts, 356, 10, FColor::Red, TEXT("Distance to nearest cut %f"), MinimumDistance);
 	int NewCutIndex = 0;
 	// if the new cut is close enough to an existing cut, 
 	// increment number of cuts for that existing cuts
@@ -517,7 +536,7 @@ void ATree::CutTree(FVector CutLocation, UProceduralMeshComponent *ProcMesh, ATr
 	TArray<AActor*> TreeChildren;
 	TArray<FVector> ChildrenLoc;
 	Tree->GetAttachedActors(TreeChildren);
-	GEngine->AddOnScreenDebugMessage(10, 5, FColor::White, FString::FromInt(TreeChildren.Num()));
+	LUMBER_DEBUG_MESSAGE(TreeCuts, 10, 5, FColor::White, TEXT("%d logs attached to the cut log"), TreeChildren.Num());
 	for (int i = 0; i < TreeChildren.Num(); i++) {
 		ChildrenLoc.Add(TreeChildren[i]->GetActorLocation());
 	}
@@ -544,6 +563,9 @@ void ATree::CutTree(FVector CutLocation, UProceduralMeshComponent *ProcMesh, ATr
 	ATree* NewTree = GetWorld()->SpawnActor<ATree>(this->GetClass(), CutWorldLocation, OtherRotation);
 
 	NewTree->TreeRoot = TreeRoot;
+	if (TreeRoot != nullptr) {
+		TreeRoot->Logs.Add(NewTree);
+	}
 	NewTree->ThisLogData.BranchHeight = TopSegLength;
 	this->ThisLogData.BranchHeight = BottomSegLength;
 	NewTree->ThisLogData.WIDTH = this->ThisLogData.WIDTH;
@@ -673,8 +695,10 @@ void ATree::SetupTree(ATree* Tree, int NewBranchHeight, int NewBranchWidth) {
 void ATree::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
-	for (int i = 0; i < ExistingCuts.Num(); i++)
-	{
-		DrawDebugPoint(GetWorld(), GetActorLocation() + GetActorUpVector() * ExistingCuts[i].RelativeDistance, 10, FColor::Red, false, DeltaTime * 2, 11);
+	if (LUMBER_DEBUG_ENABLED(TreeCuts)) {
+		for (int i = 0; i < ExistingCuts.Num(); i++)
+		{
+			LUMBER_DEBUG_POINT(TreeCuts, GetWorld(), GetActorLocation() + GetActorUpVector() * ExistingCuts[i].RelativeDistance, 10, FColor::Red, DeltaTime * 2);
+		}
 	}
 }
\ No newline at end of file
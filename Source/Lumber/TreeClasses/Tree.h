@@ -55,10 +55,15 @@ public:
 	// Sets default values for this actor's properties
 	ATree();
 
+	// Tree logs that have begun play and not ended it yet, over every world
+	static int32 NumInWorld;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	FVector TraceMesh(FVector Start, FVector End, UProceduralMeshComponent* ProcMesh);
 
 public:	
@@ -73,9 +78,7 @@ public:
 
 	FData ThisLogData;
 
-	// Asyncing tasks make trees unique regardless of seed because it accesses a random value at different times
-	// therefore skewing actual random variables.
-	// Solution to make a stream for each Async task
+	// Mesh functions take the root's stream by value, so logs built on different threads never draw from a shared stream
 
 public:
 	// Functions
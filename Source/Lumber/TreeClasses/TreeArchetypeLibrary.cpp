@@ -0,0 +1,251 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TreeArchetypeLibrary.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "TreeRoot.h"
+#include "../Lumber.h"
+#include "../GenerationCore/TreeSkeleton.h"
+
+DECLARE_CYCLE_STAT(TEXT("Build tree archetype (GT)"), STAT_Lumber_BuildTreeArchetype, STATGROUP_Lumber);
+
+// Bump when the generated meshes or the cache layout change, so old caches are regenerated
+static const int32 ArchetypeCacheVersion = 2;
+
+/*
+	Levels of detail of every variant, each keeps fewer of the tree's leaves. The logs are the same low quality logs in each
+*/
+struct FTreeArchetypeLOD {
+	int32 LeafKeepOneIn;
+	float ScreenSize;
+};
+
+static const FTreeArchetypeLOD ArchetypeLODs[] = {
+	{ 1, 1.0f },
+	{ 2, 0.3f },
+	{ 4, 0.1f },
+};
+
+static void SerializeMeshInfo(FArchive& Ar, FProcMeshInfo& MeshInfo)
+{
+	Ar << MeshInfo.Vertices;
+	Ar << MeshInfo.Triangles;
+	Ar << MeshInfo.Normals;
+	Ar << MeshInfo.UVs;
+	Ar << MeshInfo.Colors;
+
+	int32 NumTangents = MeshInfo.MeshTangents.Num();
+	Ar << NumTangents;
+	if (Ar.IsLoading()) {
+		if (NumTangents < 0 || NumTangents > MeshInfo.Vertices.Num()) {
+			Ar.SetError();
+			return;
+		}
+		MeshInfo.MeshTangents.SetNum(NumTangents);
+	}
+	for (FProcMeshTangent& Tangent : MeshInfo.MeshTangents) {
+		Ar << Tangent.TangentX;
+		Ar << Tangent.bFlipTangentY;
+	}
+}
+
+uint32 UTreeArchetypeLibrary::GetSpeciesHash(const FData& Species)
+{
+	uint32 Hash = GetTypeHash(ArchetypeCacheVersion);
+	Hash = HashCombine(Hash, GetTypeHash(Species.ROWS));
+	Hash = HashCombine(Hash, GetTypeHash(Species.WIDTH));
+	Hash = HashCombine(Hash, GetTypeHash(Species.SECTION_HEIGHT));
+	Hash = HashCombine(Hash, GetTypeHash(Species.INCREMENT));
+	Hash = HashCombine(Hash, GetTypeHash(Species.R));
+	Hash = HashCombine(Hash, GetTypeHash(Species.LeafSize));
+	Hash = HashCombine(Hash, GetTypeHash(Species.RandLeafThreshold));
+	Hash = HashCombine(Hash, GetTypeHash(Species.SideStemChance));
+	Hash = HashCombine(Hash, GetTypeHash(Species.BranchNumMin));
+	Hash = HashCombine(Hash, GetTypeHash(Species.BranchNumMax));
+	Hash = HashCombine(Hash, GetTypeHash(Species.ExtendChance));
+	Hash = HashCombine(Hash, GetTypeHash(Species.NumLeaves));
+	Hash = HashCombine(Hash, GetTypeHash(Species.bHasLeaves));
+	Hash = HashCombine(Hash, GetTypeHash(Species.TrunkHeightMultiplier));
+	Hash = HashCombine(Hash, GetTypeHash(Species.StraightAmount));
+	return Hash;
+}
+
+uint32 UTreeArchetypeLibrary::GetArchetypeKey(const FData& Species)
+{
+	uint32 Key = GetSpeciesHash(Species);
+	Key = HashCombine(Key, GetTypeHash(Species.LogMaterial));
+	Key = HashCombine(Key, GetTypeHash(Species.LeafMaterial));
+	return Key;
+}
+
+const FTreeArchetype* UTreeArchetypeLibrary::FindArchetype(uint32 ArchetypeKey) const
+{
+	return Archetypes.Find(ArchetypeKey);
+}
+
+void UTreeArchetypeLibrary::GetVariantMeshes(TArray<UStaticMesh*>& OutMeshes) const
+{
+	for (const TPair<uint32, FTreeArchetype>& Archetype : Archetypes) {
+		for (UStaticMesh* VariantMesh : Archetype.Value.VariantMeshes) {
+			if (VariantMesh != nullptr) {
+				OutMeshes.AddUnique(VariantMesh);
+			}
+		}
+	}
+}
+
+const FTreeArchetype& UTreeArchetypeLibrary::FindOrBuildArchetype(UWorld* World, TSubclassOf<ATreeRoot> TreeRootClass, const FData& Species)
+{
+	check(IsInGameThread());
+
+	const uint32 ArchetypeKey = GetArchetypeKey(Species);
+	if (const FTreeArchetype* Found = Archetypes.Find(ArchetypeKey)) {
+		return *Found;
+	}
+
+	// A species of the same shape with other materials already has the variants
+	const uint32 SpeciesHash = GetSpeciesHash(Species);
+	const FTreeArchetype* SameShape = nullptr;
+	for (const TPair<uint32, FTreeArchetype>& Other : Archetypes) {
+		if (Other.Value.SpeciesHash == SpeciesHash) {
+			SameShape = &Other.Value;
+			break;
+		}
+	}
+	if (SameShape != nullptr) {
+		FTreeArchetype Archetype = *SameShape;
+		Archetype.ArchetypeKey = ArchetypeKey;
+		Archetype.Species = Species;
+		return Archetypes.Add(ArchetypeKey, MoveTemp(Archetype));
+	}
+
+	LUMBER_SCOPE(LumberTrees, BuildTreeArchetype);
+
+	TArray<int32> VariantSeeds;
+	TArray<TArray<FTreeMeshLOD>> VariantLODs;
+	const bool bLoaded = bUseDiskCache && LoadCachedVariants(SpeciesHash, VariantSeeds, VariantLODs);
+	if (!bLoaded) {
+		GenerateVariants(World, TreeRootClass, Species, SpeciesHash, VariantSeeds, VariantLODs);
+		if (bUseDiskCache) {
+			SaveCachedVariants(SpeciesHash, VariantSeeds, VariantLODs);
+		}
+	}
+
+	FTreeArchetype& Archetype = Archetypes.Add(ArchetypeKey);
+	Archetype.SpeciesHash = SpeciesHash;
+	Archetype.ArchetypeKey = ArchetypeKey;
+	Archetype.Species = Species;
+	Archetype.VariantSeeds = MoveTemp(VariantSeeds);
+	for (const TArray<FTreeMeshLOD>& LODs : VariantLODs) {
+		Archetype.VariantMeshes.Add(FTreeStaticMesh::Build(this, LODs, Species.LogMaterial, Species.LeafMaterial));
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Tree archetype %08x: %d variants %s"), SpeciesHash, Archetype.VariantMeshes.Num(),
+		bLoaded ? TEXT("read from the disk cache") : TEXT("generated"));
+	return Archetype;
+}
+
+/*
+The variant trees are spawned only to run their generation, and are destroyed straight after
+*/
+void UTreeArchetypeLibrary::GenerateVariants(UWorld* World, TSubclassOf<ATreeRoot> TreeRootClass, const FData& Species, uint32 SpeciesHash, TArray<int32>& OutVariantSeeds, TArray<TArray<FTreeMeshLOD>>& OutVariantLODs) const
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	for (int32 Variant = 0; Variant < FMath::Max(NumVariants, 1); Variant++) {
+		ATreeRoot* VariantTree = World->SpawnActor<ATreeRoot>(TreeRootClass, FTransform::Identity, SpawnParams);
+		VariantTree->InitialTreeData = Species;
+		VariantTree->TreeSeed = LumberCore::GetVariantSeed(SpeciesHash, Variant);
+		VariantTree->BuildLowQualityMesh();
+
+		OutVariantSeeds.Add(VariantTree->TreeSeed);
+		TArray<FTreeMeshLOD>& LODs = OutVariantLODs.AddDefaulted_GetRef();
+		for (const FTreeArchetypeLOD& ArchetypeLOD : ArchetypeLODs) {
+			FTreeMeshLOD& LOD = LODs.AddDefaulted_GetRef();
+			LOD.LogMeshInfo = VariantTree->LogMeshInfo;
+			LOD.LeavesMeshInfo = FTreeStaticMesh::ThinLeaves(VariantTree->LeavesMeshInfo, ArchetypeLOD.LeafKeepOneIn);
+			LOD.ScreenSize = ArchetypeLOD.ScreenSize;
+		}
+
+		VariantTree->Destroy();
+	}
+}
+
+FString UTreeArchetypeLibrary::GetCachePath(uint32 SpeciesHash)
+{
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("TreeArchetypes"), FString::Printf(TEXT("%08x.bin"), SpeciesHash));
+}
+
+/*
+Reads a species' variants back, fails if the cache was written for another version, variant count or set of LODs
+*/
+bool UTreeArchetypeLibrary::LoadCachedVariants(uint32 SpeciesHash, TArray<int32>& OutVariantSeeds, TArray<TArray<FTreeMeshLOD>>& OutVariantLODs) const
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *GetCachePath(SpeciesHash), FILEREAD_Silent)) {
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+	int32 Version = 0;
+	uint32 CachedSpeciesHash = 0;
+	int32 NumCachedVariants = 0;
+	int32 NumLODs = 0;
+	Reader << Version << CachedSpeciesHash << NumCachedVariants << NumLODs;
+	if (Reader.IsError() || Version != ArchetypeCacheVersion || CachedSpeciesHash != SpeciesHash
+		|| NumCachedVariants != FMath::Max(NumVariants, 1) || NumLODs != int32(UE_ARRAY_COUNT(ArchetypeLODs))) {
+		return false;
+	}
+
+	OutVariantSeeds.SetNum(NumCachedVariants);
+	OutVariantLODs.SetNum(NumCachedVariants);
+	for (int32 Variant = 0; Variant < NumCachedVariants && !Reader.IsError(); Variant++) {
+		Reader << OutVariantSeeds[Variant];
+
+		TArray<FTreeMeshLOD>& LODs = OutVariantLODs[Variant];
+		LODs.SetNum(NumLODs);
+		for (int32 LODIndex = 0; LODIndex < NumLODs; LODIndex++) {
+			SerializeMeshInfo(Reader, LODs[LODIndex].LogMeshInfo);
+			SerializeMeshInfo(Reader, LODs[LODIndex].LeavesMeshInfo);
+			LODs[LODIndex].ScreenSize = ArchetypeLODs[LODIndex].ScreenSize;
+		}
+	}
+
+	if (Reader.IsError()) {
+		UE_LOG(LogTemp, Warning, TEXT("Tree archetype cache %s is corrupt, regenerating it"), *GetCachePath(SpeciesHash));
+		OutVariantSeeds.Reset();
+		OutVariantLODs.Reset();
+		return false;
+	}
+	return true;
+}
+
+void UTreeArchetypeLibrary::SaveCachedVariants(uint32 SpeciesHash, TArray<int32>& VariantSeeds, TArray<TArray<FTreeMeshLOD>>& VariantLODs) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+
+	int32 Version = ArchetypeCacheVersion;
+	int32 NumCachedVariants = VariantLODs.Num();
+	int32 NumLODs = int32(UE_ARRAY_COUNT(ArchetypeLODs));
+	Writer << Version << SpeciesHash << NumCachedVariants << NumLODs;
+
+	for (int32 Variant = 0; Variant < NumCachedVariants; Variant++) {
+		Writer << VariantSeeds[Variant];
+		for (FTreeMeshLOD& LOD : VariantLODs[Variant]) {
+			SerializeMeshInfo(Writer, LOD.LogMeshInfo);
+			SerializeMeshInfo(Writer, LOD.LeavesMeshInfo);
+		}
+	}
+
+	if (!FFileHelper::SaveArrayToFile(Bytes, *GetCachePath(SpeciesHash))) {
+		UE_LOG(LogTemp, Warning, TEXT("Couldn't write the tree archetype cache %s"), *GetCachePath(SpeciesHash));
+	}
+}
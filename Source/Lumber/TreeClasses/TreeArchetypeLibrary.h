@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "LogData.h"
+#include "TreeStaticMesh.h"
+#include "TreeArchetypeLibrary.generated.h"
+
+class ATreeRoot;
+class UStaticMesh;
+class UWorld;
+
+/*
+	Pre-generated variants of one tree species, far trees of the species are drawn as one of them
+*/
+USTRUCT()
+struct FTreeArchetype {
+	GENERATED_BODY()
+
+	// Hash of the species settings the variants were generated from
+	uint32 SpeciesHash = 0;
+
+	// Hash of the species settings and its materials, what the archetype is found by
+	uint32 ArchetypeKey = 0;
+
+	// Settings the variants were generated from, given to tree actors that stand in for a variant
+	UPROPERTY()
+	FData Species;
+
+	// Seed each variant was generated from
+	TArray<int32> VariantSeeds;
+
+	/*
+		Static mesh of each variant, with a LOD for every level of leaf thinning. Shared by the archetypes of species
+		that differ only in materials, so the mesh's materials may be another species', use the species' own instead
+	*/
+	UPROPERTY()
+	TArray<TObjectPtr<UStaticMesh>> VariantMeshes;
+};
+
+/*
+	Generates the variants of each tree species once and keeps their meshes, so a far tree costs a lookup instead of a
+	generation. Variant meshes are cached under Saved/TreeArchetypes and read back by later runs
+*/
+UCLASS()
+class LUMBER_API UTreeArchetypeLibrary : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/*
+		Returns the archetype of a species, generating its variants or reading them from the disk cache the first time.
+		Species that differ only in materials get their own archetype over the same variants. Trees are generated from
+		TreeRootClass with the species' settings. Game thread only, the reference is valid until another species is added
+	*/
+	const FTreeArchetype& FindOrBuildArchetype(UWorld* World, TSubclassOf<ATreeRoot> TreeRootClass, const FData& Species);
+
+	/*
+		Returns an archetype that has already been built, nullptr if it hasn't
+	*/
+	const FTreeArchetype* FindArchetype(uint32 ArchetypeKey) const;
+
+	/*
+		Hash of the settings that shape a species' trees, materials don't change the meshes and are left out
+	*/
+	static uint32 GetSpeciesHash(const FData& Species);
+
+	/*
+		Hash of a species' shape and materials
+	*/
+	static uint32 GetArchetypeKey(const FData& Species);
+
+	/*
+		Adds the static mesh of every variant of every archetype, once even if archetypes share it
+	*/
+	void GetVariantMeshes(TArray<UStaticMesh*>& OutMeshes) const;
+
+public:
+	// Variants generated for each species
+	int32 NumVariants = 16;
+
+	// Reads and writes variant meshes under Saved/TreeArchetypes
+	bool bUseDiskCache = true;
+
+private:
+	/*
+		Generates every variant of a species and its LODs
+	*/
+	void GenerateVariants(UWorld* World, TSubclassOf<ATreeRoot> TreeRootClass, const FData& Species, uint32 SpeciesHash, TArray<int32>& OutVariantSeeds, TArray<TArray<FTreeMeshLOD>>& OutVariantLODs) const;
+
+	bool LoadCachedVariants(uint32 SpeciesHash, TArray<int32>& OutVariantSeeds, TArray<TArray<FTreeMeshLOD>>& OutVariantLODs) const;
+
+	void SaveCachedVariants(uint32 SpeciesHash, TArray<int32>& VariantSeeds, TArray<TArray<FTreeMeshLOD>>& VariantLODs) const;
+
+	static FString GetCachePath(uint32 SpeciesHash);
+
+private:
+	// Archetypes by their key, the disk cache is by species hash
+	UPROPERTY()
+	TMap<uint32, FTreeArchetype> Archetypes;
+};
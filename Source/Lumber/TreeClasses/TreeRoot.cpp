@@ -7,7 +7,6 @@
 #include "KismetProceduralMeshLibrary.h"
 #include "Kismet/KismetMathLibrary.h"
 #include "Engine/Engine.h"
-#include "DrawDebugHelpers.h"
 #include "Components/CapsuleComponent.h"
 #include "Components/BoxComponent.h"
 #include "PaperSpriteComponent.h"
@@ -18,10 +17,19 @@
 #include "NiagaraFunctionLibrary.h"
 #include "NiagaraComponent.h"
 #include "Math/UnrealMathUtility.h"
-#include "LogData.h"
 #include "../Loaders/ChunkLoader.h"
+#include "../Loaders/GameThreadWorkQueue.h"
+#include "../Lumber.h"
+#include "../LumberDebug.h"
+#include "../GenerationCore/TreeSkeleton.h"
+
+DECLARE_CYCLE_STAT(TEXT("Generate tree data"), STAT_Lumber_GenerateTreeData, STATGROUP_Lumber);
+DECLARE_CYCLE_STAT(TEXT("Generate tree mesh"), STAT_Lumber_GenerateMeshOnly, STATGROUP_Lumber);
+DECLARE_CYCLE_STAT(TEXT("Spawn tree logs (GT)"), STAT_Lumber_SpawnLogs, STATGROUP_Lumber);
+DECLARE_CYCLE_STAT(TEXT("Create tree mesh sections (GT)"), STAT_Lumber_CreateTreeMeshSections, STATGROUP_Lumber);
+
+int32 ATreeRoot::NumInWorld = 0;
 
-class ULogData;
 #define GamePriority ENamedThreads::GameThread 
 #define BackgroundPriority ENamedThreads::AnyBackgroundHiPriTask
 
@@ -58,7 +66,15 @@ void ATreeRoot::DeserializeAndLoadObject(TSharedPtr<FJsonObject> ObjectData)
 void ATreeRoot::BeginPlay()
 {
 	Super::BeginPlay();
-	
+	INC_DWORD_STAT(STAT_LumberTreeRoots);
+	NumInWorld++;
+}
+
+void ATreeRoot::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	DEC_DWORD_STAT(STAT_LumberTreeRoots);
+	NumInWorld--;
+	Super::EndPlay(EndPlayReason);
 }
 
 /*
@@ -71,17 +87,22 @@ void ATreeRoot::GenerateTree(EChunkQuality TreeQuality, FTreeChunkRenderData* Ne
 	// Sets up stream with given seed
 	NumberStream = FRandomStream(TreeSeed);
 
-	// Generates LogData
-	AllLogData = GenerateTreeData();
+	// Generates the skeleton
+	GenerateTreeData();
 
 	switch (TreeQuality)
 	{
 	case Low:
-		AsyncTask(BackgroundPriority, [this]() {
+		AsyncTask(BackgroundPriority, [this, GameThreadWork = &FGameThreadWorkQueue::Get(this)]() {
 
-			GenerateMeshOnlyRecursive(AllLogData[0]);
+			{
+				LUMBER_SCOPE(LumberTrees, GenerateMeshOnly);
+				GenerateMeshOnly();
+			}
+			Skeleton.Release();
 
-			AsyncTask(GamePriority, [this]() {
+			GameThreadWork->Enqueue(EGameThreadWorkCategory::TreeMesh, EJobPriority::Near, [this]() {
+				LUMBER_SCOPE(LumberTrees, CreateTreeMeshSections);
 
 				// Create Log mesh
 				MaskMesh->CreateMeshSection(
@@ -109,16 +130,20 @@ void ATreeRoot::GenerateTree(EChunkQuality TreeQuality, FTreeChunkRenderData* Ne
 				);
 				MaskMesh->SetMaterial(1, InitialTreeData.LeafMaterial);
 
-
-			});
+				// The sections hold their own copy
+				LogMeshInfo = FProcMeshInfo();
+				LeavesMeshInfo = FProcMeshInfo();
+			}, SourceChunk);
 		});
 		break;
 
 	case High:
-
-		SpawnLogsRecursive(AllLogData[0], nullptr);
-
+	{
+		LUMBER_SCOPE(LumberTrees, SpawnLogs);
+		SpawnLogs();
+		Skeleton.Release();
 		break;
+	}
 	default:
 		break;
 	}
@@ -127,171 +152,116 @@ void ATreeRoot::GenerateTree(EChunkQuality TreeQuality, FTreeChunkRenderData* Ne
 /*
 Generates data for tree, including position, rotation of branches
 */
-TArray<ULogData*> ATreeRoot::GenerateTreeData() {
-
-	// Create new LogData array
-	TArray<ULogData*> NewLogDatas = TArray<ULogData*>();
-
-	// Sets up stream with given seed
-	NumberStream = FRandomStream(TreeSeed);
-
-	// Setup first log data array entry
-	ULogData* FirstLogData = NewObject<ULogData>();
-	FirstLogData->Data = InitialTreeData;
-
-	FirstLogData->Data.ROWS *= FirstLogData->Data.TrunkHeightMultiplier;
-	FirstLogData->Data.BranchHeight = (FirstLogData->Data.ROWS - 1) * FirstLogData->Data.SECTION_HEIGHT;
-
-	FirstLogData->Data.bPartOfRoot = true;
-	FirstLogData->Data.LocalLocation = FVector::UpVector * FirstLogData->Data.BranchHeight / 2;
-	NewLogDatas.Add(FirstLogData);
-
-	BuildTreeData(4, 0, FirstLogData, true, NewLogDatas);
-
-	return NewLogDatas;
+void ATreeRoot::GenerateTreeData() {
+	LUMBER_SCOPE(LumberTrees, GenerateTreeData);
+
+	// The skeleton is built by the generation core, from a stream with the tree's seed
+	LumberCore::FTreeParams Params;
+	Params.Rows = InitialTreeData.ROWS;
+	Params.Width = InitialTreeData.WIDTH;
+	Params.SectionHeight = InitialTreeData.SECTION_HEIGHT;
+	Params.SideStemChance = InitialTreeData.SideStemChance;
+	Params.BranchNumMin = InitialTreeData.BranchNumMin;
+	Params.BranchNumMax = InitialTreeData.BranchNumMax;
+	Params.ExtendChance = InitialTreeData.ExtendChance;
+	Params.TrunkHeightMultiplier = InitialTreeData.TrunkHeightMultiplier;
+	Params.StraightAmount = InitialTreeData.StraightAmount;
+
+	LumberCore::FGenerationStream SkeletonStream(TreeSeed);
+	LumberCore::BuildTreeSkeleton(Params, SkeletonStream, Skeleton);
+
+	// Mesh generation continues from where the skeleton left the stream
+	NumberStream.Initialize(SkeletonStream.GetCurrentSeed());
 }
 
-void ATreeRoot::BuildTreeData(int MaxDepth, int CurrentDepth, ULogData* Parent, bool Extension, TArray<ULogData*>& LogDatas) {
-	// stop building the tree if this branch exceeds the max depth
-	if (CurrentDepth > MaxDepth) { return; }
-
-	// get random number for how many branches branch off from the parent branch 
-	int iRange = RandRange(Parent->Data.BranchNumMin, Parent->Data.BranchNumMax - Parent->Data.BranchNumMax * (CurrentDepth / MaxDepth), NumberStream);
-	if (Extension) {
-		iRange = 1;
-	}
-
-	// for each new branch...
-	for (int i = 0; i < iRange; i++) {
-
-		// chance to spawn a branch at side of log instead of end of log
-		bool SideStem = RandRange(0, 100, NumberStream) <= Parent->Data.SideStemChance;
-		float StemAmount = RandRange(0.0f, 1.0f, NumberStream);
-		if (!SideStem || CurrentDepth <= 2) {
-			StemAmount = 1;
-		}
-		StemAmount = 1;
-
-		// random angle for new branch
-		float Randomness = (60 - (60 * (CurrentDepth / MaxDepth)) * 0.7) * (CurrentDepth * 2 / MaxDepth + Parent->Data.StraightAmount);
-		float RandPitch = FRandRange(-Randomness, Randomness, NumberStream);
-		float RandYaw = FRandRange(-Randomness, Randomness, NumberStream);
-		float RandRow = FRandRange(-Randomness, Randomness, NumberStream);
-
-		// spawns new branch and setups data
-		ULogData* NewLogData = NewObject<ULogData>();
-		NewLogData->Data = InitialTreeData;
-		NewLogData->Parent = Parent;
-		NewLogData->Data.WIDTH = FMath::Clamp(InitialTreeData.WIDTH * (MaxDepth - CurrentDepth) / MaxDepth, InitialTreeData.WIDTH / 4, InitialTreeData.WIDTH);
-		NewLogData->Data.ROWS = FRandRange(InitialTreeData.ROWS / (CurrentDepth + 1), InitialTreeData.ROWS, NumberStream);
-		NewLogData->Data.BranchHeight = (NewLogData->Data.ROWS - 1) * NewLogData->Data.SECTION_HEIGHT;
-
-
-		FVector NewUpVector = (Parent->Data.UpVector.Rotation() + FRotator(RandPitch, RandYaw, RandRow)).Vector();
-
-		// First move new log up by parent's branch height
-		FVector NewTreeLoc = Parent->Data.LocalLocation + Parent->Data.UpVector * (Parent->Data.BranchHeight / 2) * StemAmount;
-
-		// Then move new log up by this new log's branch height
-		NewTreeLoc = NewTreeLoc + NewUpVector * (NewLogData->Data.BranchHeight / 2) * StemAmount;
-
-		NewLogData->Data.LocalLocation = NewTreeLoc;
-		NewLogData->Data.UpVector = NewUpVector;
-
-		// Add this as parent's child
-		Parent->Children.Add(NewLogData);
-
-		//chance to extend this branch, recursing with the same depth
-		bool ExtendThis = (RandRange(0, 100, NumberStream) <= NewLogData->Data.ExtendChance);
-		if (CurrentDepth == MaxDepth && !ExtendThis) {
-			NewLogData->Data.bMakeLeaves = true;
-
-		}
-		else {
-			NewLogData->Data.bMakeLeaves = false;
-
-		}
-		LogDatas.Add(NewLogData);
-
-		if (ExtendThis) {
-			//Cast<ALumberGameMode>(GetWorld()->GetAuthGameMode())->TaskQueue.Enqueue();
-			BuildTreeData(MaxDepth, CurrentDepth, NewLogData, true, LogDatas);
-		}
-		else {
-			//Cast<ALumberGameMode>(GetWorld()->GetAuthGameMode())->TaskQueue.Enqueue();
-			BuildTreeData(MaxDepth, CurrentDepth + 1, NewLogData, false, LogDatas);
-		}
-
-
-	}
+FData ATreeRoot::GetBranchData(int32 BranchIndex) const {
+	FData Data = InitialTreeData;
+	Data.ROWS = Skeleton.Rows[BranchIndex];
+	Data.WIDTH = Skeleton.Widths[BranchIndex];
+	Data.BranchHeight = Skeleton.Lengths[BranchIndex];
+
+	const LumberCore::FVec3& LocalLocation = Skeleton.LocalLocations[BranchIndex];
+	const LumberCore::FVec3& UpVector = Skeleton.UpVectors[BranchIndex];
+	Data.LocalLocation = FVector(LocalLocation.X, LocalLocation.Y, LocalLocation.Z);
+	Data.UpVector = FVector(UpVector.X, UpVector.Y, UpVector.Z);
+	Data.bPartOfRoot = Skeleton.IsPartOfRoot(BranchIndex);
+	Data.bMakeLeaves = Skeleton.MakesLeaves(BranchIndex);
+	return Data;
 }
 
-void ATreeRoot::GenerateMeshOnlyRecursive(ULogData* NextData) {
-	FData Data = NextData->Data;
-
-	FProcMeshInfo NewMeshInfo = ATree::CreateMeshData(false, Data, NumberStream, EChunkQuality::Low, Data.LocalLocation - Data.UpVector * Data.BranchHeight / 2, Data.UpVector);
-
-	// We need to shift indexes of all triangles by the number of vertices already in the array,
-	// so the new triangles' index correspond to the correct vertex
-	for (int i = 0; i < NewMeshInfo.Triangles.Num(); i++)
+void ATreeRoot::BuildLowQualityMesh() {
+	GenerateTreeData();
 	{
-		NewMeshInfo.Triangles[i] += LogMeshInfo.Vertices.Num();
+		LUMBER_SCOPE(LumberTrees, GenerateMeshOnly);
+		GenerateMeshOnly();
 	}
+	Skeleton.Release();
+}
 
-	LogMeshInfo.Vertices.Append(NewMeshInfo.Vertices);
-	LogMeshInfo.Triangles.Append(NewMeshInfo.Triangles);
-	LogMeshInfo.Normals.Append(NewMeshInfo.Normals);
-	LogMeshInfo.UVs.Append(NewMeshInfo.UVs);
-	LogMeshInfo.Colors.Append(NewMeshInfo.Colors);
-	LogMeshInfo.MeshTangents.Append(NewMeshInfo.MeshTangents);
+void ATreeRoot::GenerateMeshOnly() {
+	// Branches are in depth first order, the order the stream is drawn in
+	for (int32 BranchIndex = 0; BranchIndex < int32(Skeleton.Num()); BranchIndex++) {
+		const FData Data = GetBranchData(BranchIndex);
 
-	if (Data.bMakeLeaves) {
-		FProcMeshInfo NewLeavesMeshInfo = ATree::CreateLeavesMeshData(Data, NumberStream, Data.LocalLocation, Data.UpVector);
+		FProcMeshInfo NewMeshInfo = ATree::CreateMeshData(false, Data, NumberStream, EChunkQuality::Low, Data.LocalLocation - Data.UpVector * Data.BranchHeight / 2, Data.UpVector);
 
-		for (int i = 0; i < NewLeavesMeshInfo.Triangles.Num(); i++)
+		// We need to shift indexes of all triangles by the number of vertices already in the array,
+		// so the new triangles' index correspond to the correct vertex
+		for (int i = 0; i < NewMeshInfo.Triangles.Num(); i++)
 		{
-			NewLeavesMeshInfo.Triangles[i] += LeavesMeshInfo.Vertices.Num();
+			NewMeshInfo.Triangles[i] += LogMeshInfo.Vertices.Num();
 		}
 
-		LeavesMeshInfo.Vertices.Append(NewLeavesMeshInfo.Vertices);
-		LeavesMeshInfo.Triangles.Append(NewLeavesMeshInfo.Triangles);
-		LeavesMeshInfo.Normals.Append(NewLeavesMeshInfo.Normals);
-		LeavesMeshInfo.UVs.Append(NewLeavesMeshInfo.UVs);
-		LeavesMeshInfo.Colors.Append(NewLeavesMeshInfo.Colors);
-		LeavesMeshInfo.MeshTangents.Append(NewLeavesMeshInfo.MeshTangents);
-
-	}
-
-	for (ULogData* Child : NextData->Children) {
-		GenerateMeshOnlyRecursive(Child);
+		LogMeshInfo.Vertices.Append(NewMeshInfo.Vertices);
+		LogMeshInfo.Triangles.Append(NewMeshInfo.Triangles);
+		LogMeshInfo.Normals.Append(NewMeshInfo.Normals);
+		LogMeshInfo.UVs.Append(NewMeshInfo.UVs);
+		LogMeshInfo.Colors.Append(NewMeshInfo.Colors);
+		LogMeshInfo.MeshTangents.Append(NewMeshInfo.MeshTangents);
+
+		if (Data.bMakeLeaves) {
+			FProcMeshInfo NewLeavesMeshInfo = ATree::CreateLeavesMeshData(Data, NumberStream, Data.LocalLocation, Data.UpVector);
+
+			for (int i = 0; i < NewLeavesMeshInfo.Triangles.Num(); i++)
+			{
+				NewLeavesMeshInfo.Triangles[i] += LeavesMeshInfo.Vertices.Num();
+			}
+
+			LeavesMeshInfo.Vertices.Append(NewLeavesMeshInfo.Vertices);
+			LeavesMeshInfo.Triangles.Append(NewLeavesMeshInfo.Triangles);
+			LeavesMeshInfo.Normals.Append(NewLeavesMeshInfo.Normals);
+			LeavesMeshInfo.UVs.Append(NewLeavesMeshInfo.UVs);
+			LeavesMeshInfo.Colors.Append(NewLeavesMeshInfo.Colors);
+			LeavesMeshInfo.MeshTangents.Append(NewLeavesMeshInfo.MeshTangents);
+		}
 	}
-
 }
 
-void ATreeRoot::SpawnLogsRecursive(ULogData *NextData, ATree* ParentTree) {
-	FData Data = NextData->Data;
-	FVector NewSpawnLocation = GetActorLocation() + Data.LocalLocation;
-
-	FVector NewLogLocalLocation = Data.LocalLocation;
-	FRotator NewLogRotation = Data.UpVector.Rotation();
-	NewLogRotation.Pitch += -90;
-	ATree* NewTree = GetWorld()->SpawnActor<ATree>(TreeClass, NewSpawnLocation, NewLogRotation);
-	NewTree->TreeRoot = this;
-	NewTree->ThisLogData = NextData->Data;
-	NewTree->BuildTreeMesh(Data.bMakeLeaves);
+void ATreeRoot::SpawnLogs() {
+	// Parents come before their children, so a log's parent has always been spawned by the time it is welded to it
+	TArray<ATree*> SpawnedLogs;
+	SpawnedLogs.Reserve(int32(Skeleton.Num()));
 
-	NewTree->SetupTree(NewTree, Data.BranchHeight, Data.WIDTH);
+	for (int32 BranchIndex = 0; BranchIndex < int32(Skeleton.Num()); BranchIndex++) {
+		const FData Data = GetBranchData(BranchIndex);
+		const int32 ParentIndex = Skeleton.Parents[BranchIndex];
+		FVector NewSpawnLocation = GetActorLocation() + Data.LocalLocation;
 
-	if (ParentTree != nullptr) {
-		NewTree->BoxCollision->WeldTo(ParentTree->BoxCollision);
-	}
+		FRotator NewLogRotation = Data.UpVector.Rotation();
+		NewLogRotation.Pitch += -90;
+		ATree* NewTree = GetWorld()->SpawnActor<ATree>(TreeClass, NewSpawnLocation, NewLogRotation);
+		NewTree->TreeRoot = this;
+		NewTree->ThisLogData = Data;
+		NewTree->BuildTreeMesh(Data.bMakeLeaves);
 
-	for (ULogData* Child : NextData->Children) {
-		SpawnLogsRecursive(Child, NewTree);
-	}
+		NewTree->SetupTree(NewTree, Data.BranchHeight, Data.WIDTH);
 
-	if (NextData->Parent != nullptr) {
-		DrawDebugLine(GetWorld(), NewSpawnLocation + Data.UpVector * Data.BranchHeight / 2, NewSpawnLocation - Data.UpVector * Data.BranchHeight / 2, FColor::Blue, false, 100, 0, 10);
+		if (ParentIndex != INDEX_NONE) {
+			NewTree->BoxCollision->WeldTo(SpawnedLogs[ParentIndex]->BoxCollision);
+			LUMBER_DEBUG_LINE(Trees, GetWorld(), NewSpawnLocation + Data.UpVector * Data.BranchHeight / 2, NewSpawnLocation - Data.UpVector * Data.BranchHeight / 2, FColor::Blue, 100, 10);
+		}
+		SpawnedLogs.Add(NewTree);
+		Logs.Add(NewTree);
 	}
 }
 
@@ -299,8 +269,17 @@ void ATreeRoot::SpawnLogsRecursive(ULogData *NextData, ATree* ParentTree) {
 Called by first branch to notify that the tree is fully generated and rendered
 */
 void ATreeRoot::OnFinishGeneration() {
-	double GenerationDuration = FPlatformTime::Seconds() - StartGenerationTime;
-	GEngine->AddOnScreenDebugMessage(FMath::Rand(), 20, FColor::Green, FString() + "Took " + FString::SanitizeFloat(GenerationDuration) + "s to make tree");
+	LUMBER_DEBUG_MESSAGE(Trees, -1, 20, FColor::Green, TEXT("Took %fs to make tree"), FPlatformTime::Seconds() - StartGenerationTime);
+}
+
+void ATreeRoot::DestroyTree() {
+	for (const TWeakObjectPtr<ATree>& Log : Logs) {
+		if (Log.IsValid()) {
+			Log->Destroy();
+		}
+	}
+	Logs.Empty();
+	Destroy();
 }
 
 int ATreeRoot::RandRange(int Min, int Max, FRandomStream& Stream) {
@@ -9,10 +9,10 @@
 #include "ProceduralMeshComponent.h"
 #include "Tree.h"
 #include "../Loaders/TreeLoader.h"
+#include "../GenerationCore/TreeSkeleton.h"
 #include "TreeRoot.generated.h"
 
 class ATree;
-class LogData;
 class UProceduralMeshComponent;
 struct FRandomStream;
 struct FProcMeshInfo;
@@ -29,6 +29,7 @@ protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
@@ -45,48 +46,62 @@ public:
 	void GenerateTree(EChunkQuality TreeQuality, FTreeChunkRenderData* NewAssignedTreeLoaderChunk, bool* NewAssignedTreeLoaderTree);
 
 	/*
-		Initiates the recursive call of BuildTreeData() and returns a LogData array
+		Builds the tree's skeleton into Skeleton, parents before their children
 	*/
-	TArray<ULogData*> GenerateTreeData();
-	
+	void GenerateTreeData();
+
 	/*
-		Called by first branch to notify that the tree is fully generated and rendered
+		Settings of one branch of the skeleton, the species settings with the branch's shape applied
 	*/
-	void OnFinishGeneration();
+	FData GetBranchData(int32 BranchIndex) const;
 
-
-/*
-	Generation functions
-*/
-private:
+	/*
+		Builds the tree's low quality meshes into LogMeshInfo and LeavesMeshInfo without creating any mesh sections,
+		for trees that are drawn as instances of a shared mesh
+	*/
+	void BuildLowQualityMesh();
 
 	/*
-		Recursively builds information of each log in the tree, excluding mesh data and populates LogDatas array
+		Builds only the tree's mesh without any collision or new actors, very computationally cheap but should
+		be used for outer unimportant chunks. Continues the stream GenerateTreeData left, so it has to run first
 	*/
-	void BuildTreeData(int MaxDepth, int CurrentDepth, ULogData* Parent, bool Extension, TArray<ULogData*>& LogDatas);
+	void GenerateMeshOnly();
 	
 	/*
-		Builds only the tree's mesh without any collision or new actors, very computationally cheap but should
-		be used for outer unimportant chunks
+		Called by first branch to notify that the tree is fully generated and rendered
 	*/
-	void GenerateMeshOnlyRecursive(ULogData* NextData);
+	void OnFinishGeneration();
 
 	/*
-		Spawns the physical tree, very computationally expensive and should be used in moderation
+		Destroys the tree's logs, pieces cut off them included, and then the tree itself
 	*/
-	void SpawnLogsRecursive(ULogData* NextData, ATree* ParentTree);
+	void DestroyTree();
+
 
 /*
-	Getter functions
+	Generation functions
 */
 private:
-	TArray<ULogData*> GetTreeLogData();
+
+	/*
+		Spawns the physical tree, very computationally expensive and should be used in moderation
+	*/
+	void SpawnLogs();
 
 public:	
+	// Tree roots that have begun play and not ended it yet, over every world
+	static int32 NumInWorld;
+
 	ATree* Root;
 
+	// Logs spawned for the tree and the pieces cut off them, some may have been destroyed since
+	TArray<TWeakObjectPtr<ATree>> Logs;
+
 	int TreeSeed;
 
+	// Index of the chunk this tree was spawned for, INDEX_NONE if it wasn't spawned by the tree loader
+	int32 SourceChunk = INDEX_NONE;
+
 	TSubclassOf<ATree> TreeClass;
 
 	FRandomStream NumberStream;
@@ -105,7 +120,8 @@ public:
 	TSharedPtr<FJsonObject> SerializeObject() override;
 	void DeserializeAndLoadObject(TSharedPtr<FJsonObject> ObjectData) override;
 
-	TArray<ULogData*> AllLogData;
+	// Branches of the tree, only held while the tree's meshes or logs are being made
+	LumberCore::FTreeSkeleton Skeleton;
 
 public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TreeStaticMesh.h"
+#include "Engine/StaticMesh.h"
+#include "StaticMeshResources.h"
+#include "Materials/MaterialInterface.h"
+#include "MeshDescription.h"
+#include "MeshDescriptionBuilder.h"
+#include "StaticMeshAttributes.h"
+
+static const FName LogMaterialSlot(TEXT("Log"));
+static const FName LeafMaterialSlot(TEXT("Leaf"));
+
+/*
+Appends one procedural mesh to a polygon group, every vertex gets its own vertex instance like in a procedural mesh section
+*/
+static void AppendProcMesh(FMeshDescriptionBuilder& Builder, const FProcMeshInfo& MeshInfo, const FPolygonGroupID& PolygonGroup)
+{
+	TArray<FVertexInstanceID> VertexInstances;
+	VertexInstances.Reserve(MeshInfo.Vertices.Num());
+
+	for (int32 i = 0; i < MeshInfo.Vertices.Num(); i++) {
+		const FVertexInstanceID VertexInstance = Builder.AppendInstance(Builder.AppendVertex(MeshInfo.Vertices[i]));
+		const FVector Normal = MeshInfo.Normals.IsValidIndex(i) ? MeshInfo.Normals[i] : FVector::UpVector;
+
+		if (MeshInfo.MeshTangents.IsValidIndex(i)) {
+			Builder.SetInstanceTangentSpace(VertexInstance, Normal, MeshInfo.MeshTangents[i].TangentX, MeshInfo.MeshTangents[i].bFlipTangentY);
+		}
+		else {
+			Builder.SetInstanceNormal(VertexInstance, Normal);
+		}
+
+		// Low quality logs have a UV more than vertices in each row, for the seam
+		if (MeshInfo.UVs.IsValidIndex(i)) {
+			Builder.SetInstanceUV(VertexInstance, MeshInfo.UVs[i], 0);
+		}
+		VertexInstances.Add(VertexInstance);
+	}
+
+	for (int32 i = 0; i + 2 < MeshInfo.Triangles.Num(); i += 3) {
+		Builder.AppendTriangle(VertexInstances[MeshInfo.Triangles[i]], VertexInstances[MeshInfo.Triangles[i + 1]], VertexInstances[MeshInfo.Triangles[i + 2]], PolygonGroup);
+	}
+}
+
+void FTreeStaticMesh::BuildMeshDescription(FMeshDescription& OutMeshDescription, const FProcMeshInfo& LogMeshInfo, const FProcMeshInfo& LeavesMeshInfo)
+{
+	FStaticMeshAttributes Attributes(OutMeshDescription);
+	Attributes.Register();
+
+	FMeshDescriptionBuilder Builder;
+	Builder.SetMeshDescription(&OutMeshDescription);
+	Builder.EnablePolyGroups();
+	Builder.SetNumUVLayers(1);
+
+	// Group order matches the procedural mesh's section order
+	const FPolygonGroupID LogGroup = Builder.AppendPolygonGroup(LogMaterialSlot);
+	const FPolygonGroupID LeavesGroup = Builder.AppendPolygonGroup(LeafMaterialSlot);
+
+	AppendProcMesh(Builder, LogMeshInfo, LogGroup);
+	AppendProcMesh(Builder, LeavesMeshInfo, LeavesGroup);
+}
+
+UStaticMesh* FTreeStaticMesh::Build(UObject* Outer, const TArray<FTreeMeshLOD>& LODs, UMaterialInterface* LogMaterial, UMaterialInterface* LeafMaterial)
+{
+	check(IsInGameThread());
+	check(LODs.Num() > 0 && LODs.Num() <= MAX_STATIC_MESH_LODS);
+
+	TArray<FMeshDescription> MeshDescriptions;
+	MeshDescriptions.SetNum(LODs.Num());
+	TArray<const FMeshDescription*> LODMeshDescriptions;
+	for (int32 LODIndex = 0; LODIndex < LODs.Num(); LODIndex++) {
+		BuildMeshDescription(MeshDescriptions[LODIndex], LODs[LODIndex].LogMeshInfo, LODs[LODIndex].LeavesMeshInfo);
+		LODMeshDescriptions.Add(&MeshDescriptions[LODIndex]);
+	}
+
+	UStaticMesh* StaticMesh = NewObject<UStaticMesh>(Outer, NAME_None, RF_Transient);
+	StaticMesh->GetStaticMaterials().Add(FStaticMaterial(LogMaterial, LogMaterialSlot));
+	StaticMesh->GetStaticMaterials().Add(FStaticMaterial(LeafMaterial, LeafMaterialSlot));
+
+	// Trees drawn from a static mesh are never collided with, an interactive tree is spawned as an actor instead
+	UStaticMesh::FBuildMeshDescriptionsParams Params;
+	Params.bBuildSimpleCollision = false;
+	Params.bFastBuild = true;
+	StaticMesh->BuildFromMeshDescriptions(LODMeshDescriptions, Params);
+
+	// Built at runtime there are no source models to take the screen sizes from
+	for (int32 LODIndex = 1; LODIndex < LODs.Num(); LODIndex++) {
+		StaticMesh->GetRenderData()->ScreenSize[LODIndex].Default = LODs[LODIndex].ScreenSize;
+	}
+
+	return StaticMesh;
+}
+
+FProcMeshInfo FTreeStaticMesh::ThinLeaves(const FProcMeshInfo& LeavesMeshInfo, int32 KeepOneIn)
+{
+	// Every leaf is three quads of their own vertices, made one after another by ATree::CreateLeavesMeshData
+	const int32 VerticesPerLeaf = 12;
+	const int32 IndicesPerLeaf = 18;
+
+	const int32 NumLeaves = LeavesMeshInfo.Vertices.Num() / VerticesPerLeaf;
+	if (KeepOneIn <= 1 || LeavesMeshInfo.Vertices.Num() % VerticesPerLeaf != 0 || LeavesMeshInfo.Triangles.Num() != NumLeaves * IndicesPerLeaf) {
+		return LeavesMeshInfo;
+	}
+
+	FProcMeshInfo Thinned;
+	Thinned.Index = LeavesMeshInfo.Index;
+	for (int32 Leaf = 0; Leaf < NumLeaves; Leaf += KeepOneIn) {
+		const int32 FirstVertex = Leaf * VerticesPerLeaf;
+		const int32 IndexOffset = Thinned.Vertices.Num() - FirstVertex;
+
+		for (int32 i = FirstVertex; i < FirstVertex + VerticesPerLeaf; i++) {
+			Thinned.Vertices.Add(LeavesMeshInfo.Vertices[i]);
+			if (LeavesMeshInfo.Normals.IsValidIndex(i)) { Thinned.Normals.Add(LeavesMeshInfo.Normals[i]); }
+			if (LeavesMeshInfo.UVs.IsValidIndex(i)) { Thinned.UVs.Add(LeavesMeshInfo.UVs[i]); }
+			if (LeavesMeshInfo.Colors.IsValidIndex(i)) { Thinned.Colors.Add(LeavesMeshInfo.Colors[i]); }
+			if (LeavesMeshInfo.MeshTangents.IsValidIndex(i)) { Thinned.MeshTangents.Add(LeavesMeshInfo.MeshTangents[i]); }
+		}
+		for (int32 i = Leaf * IndicesPerLeaf; i < (Leaf + 1) * IndicesPerLeaf; i++) {
+			Thinned.Triangles.Add(LeavesMeshInfo.Triangles[i] + IndexOffset);
+		}
+	}
+	return Thinned;
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tree.h"
+
+class UMaterialInterface;
+class UObject;
+class UStaticMesh;
+struct FMeshDescription;
+
+/*
+	One level of detail of a tree's static mesh
+*/
+struct FTreeMeshLOD {
+	FProcMeshInfo LogMeshInfo;
+	FProcMeshInfo LeavesMeshInfo;
+
+	// Fraction of the screen the tree has to fill for this LOD to be drawn, the first LOD's is ignored
+	float ScreenSize = 1.0f;
+};
+
+/*
+	Turns the procedural meshes of a tree into a static mesh at runtime, so one generated tree can be drawn many times
+	by instanced static mesh components
+*/
+class LUMBER_API FTreeStaticMesh {
+public:
+	/*
+		Writes a tree's log and leaves meshes into a mesh description, as polygon group 0 and 1 to match the
+		log and leaf material slots
+	*/
+	static void BuildMeshDescription(FMeshDescription& OutMeshDescription, const FProcMeshInfo& LogMeshInfo, const FProcMeshInfo& LeavesMeshInfo);
+
+	/*
+		Builds a static mesh without collision with a LOD for each of a tree's meshes, game thread only
+	*/
+	static UStaticMesh* Build(UObject* Outer, const TArray<FTreeMeshLOD>& LODs, UMaterialInterface* LogMaterial, UMaterialInterface* LeafMaterial);
+
+	/*
+		Copy of a leaves mesh with only one in every KeepOneIn leaves, for the lower LODs of a tree
+	*/
+	static FProcMeshInfo ThinLeaves(const FProcMeshInfo& LeavesMeshInfo, int32 KeepOneIn);
+};
@@ -0,0 +1,541 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+/*
+	Standalone benchmark and tests of the generation core, without the engine.
+
+	GenerationBenchmark [--iterations N] [--filter <name>]   times the generation hot paths
+	GenerationBenchmark --test                                 checks the core's invariants and golden hashes, exits nonzero on failure
+	GenerationBenchmark --print-hashes                         prints the content hashes, to update the goldens after an intended change
+*/
+
+#include "TerrainGeneration.h"
+#include "TreeSkeleton.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace LumberCore;
+
+// Chunk settings of the chunk loader, and a layer setup like the default world's
+static const int32_t ChunkSize = 100;
+static const int32_t TileSize = 600;
+
+static const FNoiseLayer DefaultLayers[] = {
+	{ 0.00002f, 0.00002f, 0, 0, 60000, ENoiseOperation::Additive },
+	{ 0.0002f, 0.0002f, 100, 100, 3000, ENoiseOperation::Additive },
+	{ 0.002f, 0.002f, 200, 200, 100, ENoiseOperation::Additive },
+};
+static const int32_t NumDefaultLayers = int32_t(sizeof(DefaultLayers) / sizeof(DefaultLayers[0]));
+
+struct FChunkQualitySize {
+	const char* Name;
+	int32_t GridSize;
+	int32_t TileSize;
+};
+
+// Mirrors AChunkLoader::GetChunkSizesFromQuality
+static const FChunkQualitySize Qualities[] = {
+	{ "Low", ChunkSize / 10, TileSize * 10 },
+	{ "Medium", ChunkSize / 5, TileSize * 5 },
+	{ "High", ChunkSize, TileSize },
+};
+
+static std::vector<float> SampleHeightfield(int32_t GridSize, int32_t QualityTileSize, double OriginX, double OriginY, FHeightRange* OutRange = nullptr) {
+	const int32_t BorderedSize = GridSize + 3;
+	std::vector<float> Heights(size_t(BorderedSize) * BorderedSize);
+	const FHeightRange Range = SampleHeightfieldRows(DefaultLayers, NumDefaultLayers, OriginX, OriginY, QualityTileSize, BorderedSize, 0, BorderedSize, Heights.data());
+	if (OutRange != nullptr) { *OutRange = Range; }
+	return Heights;
+}
+
+/*
+	Benchmarks
+*/
+
+// Keeps results alive so the optimizer can't drop the work being timed
+static volatile double Sink = 0;
+
+static void RunBenchmark(const std::string& Name, const std::string& Filter, int32_t Iterations, const std::function<double()>& Body) {
+	if (!Filter.empty() && Name.find(Filter) == std::string::npos) { return; }
+
+	std::vector<double> Milliseconds;
+	Milliseconds.reserve(Iterations);
+	for (int32_t i = 0; i < Iterations; i++) {
+		const auto Start = std::chrono::steady_clock::now();
+		Sink = Sink + Body();
+		const auto End = std::chrono::steady_clock::now();
+		Milliseconds.push_back(std::chrono::duration<double, std::milli>(End - Start).count());
+	}
+
+	std::sort(Milliseconds.begin(), Milliseconds.end());
+	std::printf("%-36s min %9.3f ms  median %9.3f ms  max %9.3f ms\n", Name.c_str(), Milliseconds.front(), Milliseconds[Milliseconds.size() / 2], Milliseconds.back());
+}
+
+static int RunBenchmarks(int32_t Iterations, const std::string& Filter) {
+	for (const FChunkQualitySize& Quality : Qualities) {
+		RunBenchmark(std::string("Heightfield/") + Quality.Name, Filter, Iterations, [&Quality]() {
+			return double(SampleHeightfield(Quality.GridSize, Quality.TileSize, 0, 0)[0]);
+		});
+	}
+
+	RunBenchmark("GridTriangles/High", Filter, Iterations, []() {
+		std::vector<int32_t> Triangles(size_t(ChunkSize) * ChunkSize * 6);
+		BuildGridTriangleRows(ChunkSize, 0, ChunkSize, Triangles.data());
+		return double(Triangles.back());
+	});
+
+	const std::vector<float> Heights = SampleHeightfield(ChunkSize, TileSize, 0, 0);
+	RunBenchmark("HeightfieldNormals/High", Filter, Iterations, [&Heights]() {
+		double Sum = 0;
+		for (int32_t Row = 0; Row <= ChunkSize; Row++) {
+			for (int32_t Col = 0; Col <= ChunkSize; Col++) {
+				Sum += GetHeightfieldNormal(Heights.data(), ChunkSize + 3, TileSize, Row, Col).Z;
+			}
+		}
+		return Sum;
+	});
+
+	RunBenchmark("TreeSkeleton/1000Seeds", Filter, Iterations, []() {
+		FTreeSkeleton Skeleton;
+		double NumBranches = 0;
+		for (int32_t Seed = 0; Seed < 1000; Seed++) {
+			FGenerationStream Stream(Seed);
+			BuildTreeSkeleton(FTreeParams(), Stream, Skeleton);
+			NumBranches += double(Skeleton.Num());
+		}
+		return NumBranches;
+	});
+
+	return 0;
+}
+
+/*
+	Tests
+*/
+
+static int32_t NumFailures = 0;
+
+static void Expect(bool bCondition, const char* Description) {
+	if (!bCondition) {
+		std::printf("FAILED: %s\n", Description);
+		NumFailures++;
+	}
+}
+
+static void TestPerlinNoise() {
+	bool bInRange = true;
+	bool bZeroOnLattice = true;
+	for (int32_t i = -200; i < 200; i++) {
+		for (int32_t j = -200; j < 200; j++) {
+			const float Value = PerlinNoise2D(float(i) * 0.173f, float(j) * 0.311f);
+			bInRange &= Value > -1.0f && Value < 1.0f;
+		}
+		bZeroOnLattice &= PerlinNoise2D(float(i), float(i * 3)) == 0.0f;
+	}
+	Expect(bInRange, "Perlin noise stays in (-1, 1)");
+	Expect(bZeroOnLattice, "Perlin noise is zero on lattice points");
+}
+
+static void TestHeightfield() {
+	const FChunkQualitySize& Quality = Qualities[2];
+	const int32_t BorderedSize = Quality.GridSize + 3;
+
+	FHeightRange WholeRange;
+	const std::vector<float> Whole = SampleHeightfield(Quality.GridSize, Quality.TileSize, 60000, -120000, &WholeRange);
+
+	// Sampling in blocks of rows, in any order, gives the same heightfield
+	std::vector<float> Blocks(Whole.size());
+	FHeightRange BlocksRange;
+	for (int32_t BeginRow = ((BorderedSize - 1) / 8) * 8; BeginRow >= 0; BeginRow -= 8) {
+		BlocksRange.Add(SampleHeightfieldRows(DefaultLayers, NumDefaultLayers, 60000, -120000, Quality.TileSize, BorderedSize, BeginRow, std::min(BeginRow + 8, BorderedSize), Blocks.data()));
+	}
+	Expect(Whole == Blocks, "Heightfield sampled in blocks matches the whole heightfield");
+	Expect(WholeRange.Min == BlocksRange.Min && WholeRange.Max == BlocksRange.Max, "Height range sampled in blocks matches");
+
+	// Edges of neighbouring chunks share heights, so there are no seams
+	const std::vector<float> Neighbour = SampleHeightfield(Quality.GridSize, Quality.TileSize, 60000 + double(Quality.GridSize) * Quality.TileSize, -120000);
+	bool bSharedEdge = true;
+	for (int32_t Col = 0; Col < BorderedSize; Col++) {
+		bSharedEdge &= Whole[size_t(BorderedSize - 2) * BorderedSize + Col] == Neighbour[size_t(1) * BorderedSize + Col];
+	}
+	Expect(bSharedEdge, "Neighbouring chunks share their edge heights");
+
+	bool bUnitNormals = true;
+	for (int32_t Row = 0; Row <= Quality.GridSize; Row++) {
+		for (int32_t Col = 0; Col <= Quality.GridSize; Col++) {
+			const FVec3 Normal = GetHeightfieldNormal(Whole.data(), BorderedSize, Quality.TileSize, Row, Col);
+			bUnitNormals &= std::abs(Normal.SizeSquared() - 1.0) < 1e-6 && Normal.Z > 0;
+		}
+	}
+	Expect(bUnitNormals, "Heightfield normals are unit length and point up");
+
+	const std::vector<float> Flat(Whole.size(), 42.0f);
+	const FVec3 FlatNormal = GetHeightfieldNormal(Flat.data(), BorderedSize, Quality.TileSize, 5, 5);
+	Expect(FlatNormal.X == 0 && FlatNormal.Y == 0 && FlatNormal.Z == 1, "Flat heightfield normals point straight up");
+}
+
+static void TestGridTriangles() {
+	const int32_t GridSize = 13;
+	std::vector<int32_t> Triangles(size_t(GridSize) * GridSize * 6, -1);
+	BuildGridTriangleRows(GridSize, 0, 5, Triangles.data());
+	BuildGridTriangleRows(GridSize, 5, GridSize, Triangles.data());
+
+	const int32_t NumVertices = (GridSize + 1) * (GridSize + 1);
+	bool bInRange = true;
+	bool bNonDegenerate = true;
+	for (size_t i = 0; i < Triangles.size(); i += 3) {
+		for (size_t j = 0; j < 3; j++) {
+			bInRange &= Triangles[i + j] >= 0 && Triangles[i + j] < NumVertices;
+		}
+		bNonDegenerate &= Triangles[i] != Triangles[i + 1] && Triangles[i] != Triangles[i + 2] && Triangles[i + 1] != Triangles[i + 2];
+	}
+	Expect(bInRange, "Grid triangle indices are all written and in range");
+	Expect(bNonDegenerate, "Grid triangles are not degenerate");
+}
+
+static void TestTreeSkeleton() {
+	bool bDeterministic = true;
+	bool bParentsFirst = true;
+	bool bHasLeaves = false;
+	size_t NumDifferentFromFirst = 0;
+
+	FTreeSkeleton First;
+	FGenerationStream FirstStream(0);
+	BuildTreeSkeleton(FTreeParams(), FirstStream, First);
+
+	for (int32_t Seed = 0; Seed < 200; Seed++) {
+		FTreeSkeleton A;
+		FTreeSkeleton B;
+		FGenerationStream StreamA(Seed);
+		FGenerationStream StreamB(Seed);
+		BuildTreeSkeleton(FTreeParams(), StreamA, A);
+		BuildTreeSkeleton(FTreeParams(), StreamB, B);
+
+		bDeterministic &= A.Num() == B.Num() && StreamA.GetCurrentSeed() == StreamB.GetCurrentSeed();
+		for (size_t i = 0; i < A.Num() && i < B.Num(); i++) {
+			bDeterministic &= A.Parents[i] == B.Parents[i] && A.LocalLocations[i].X == B.LocalLocations[i].X && A.UpVectors[i].Z == B.UpVectors[i].Z;
+			bParentsFirst &= i == 0 ? A.Parents[i] == -1 : (A.Parents[i] >= 0 && size_t(A.Parents[i]) < i);
+			bHasLeaves |= A.MakesLeaves(i);
+		}
+		NumDifferentFromFirst += A.Num() != First.Num() || A.LocalLocations.back().X != First.LocalLocations.back().X;
+	}
+
+	// Reusing a skeleton gives the same branches as a fresh one
+	FTreeSkeleton Reused;
+	for (int32_t Seed : { 7, 0 }) {
+		FGenerationStream Stream(Seed);
+		BuildTreeSkeleton(FTreeParams(), Stream, Reused);
+	}
+	bool bReuseMatches = Reused.Num() == First.Num();
+	for (size_t i = 0; bReuseMatches && i < First.Num(); i++) {
+		const FTreeBranch Branch = Reused.GetBranch(i);
+		bReuseMatches &= Branch.Parent == First.Parents[i] && Branch.BranchHeight == First.Lengths[i] && Branch.bMakeLeaves == First.MakesLeaves(i);
+	}
+	Expect(bReuseMatches, "Reused tree skeletons are rebuilt from scratch");
+
+	Expect(bDeterministic, "Tree skeletons are the same for the same seed");
+	Expect(bParentsFirst, "Tree skeleton parents come before their children");
+	Expect(bHasLeaves, "Tree skeletons have leaf branches");
+	Expect(NumDifferentFromFirst > 150, "Different seeds give different trees");
+}
+
+static void TestTreeVariants() {
+	const int32_t NumVariants = 16;
+	const int32_t NumTrees = 16000;
+
+	bool bInRange = true;
+	bool bStable = true;
+	int32_t NumSameAsSpecies = 0;
+	std::vector<int32_t> TreesPerVariant(NumVariants, 0);
+	for (int32_t i = 0; i < NumTrees; i++) {
+		const int32_t TreeSeed = GetTreeSeed(1234, i * 600, (i % 7) * 600);
+		const int32_t Variant = GetTreeVariant(TreeSeed, NumVariants);
+		bInRange &= Variant >= 0 && Variant < NumVariants;
+		bStable &= Variant == GetTreeVariant(TreeSeed, NumVariants);
+		NumSameAsSpecies += Variant == GetTreeSpecies(TreeSeed, NumVariants);
+		if (Variant >= 0 && Variant < NumVariants) {
+			TreesPerVariant[Variant]++;
+		}
+	}
+
+	// Every variant gets within a fifth of its share
+	bool bEven = true;
+	for (int32_t Count : TreesPerVariant) {
+		bEven &= Count > NumTrees / NumVariants * 4 / 5 && Count < NumTrees / NumVariants * 6 / 5;
+	}
+
+	bool bSeedsDiffer = true;
+	for (int32_t Variant = 1; Variant < NumVariants; Variant++) {
+		bSeedsDiffer &= GetVariantSeed(0x1234u, Variant) != GetVariantSeed(0x1234u, Variant - 1);
+	}
+
+	Expect(bInRange && bStable, "Tree variants are in range and the same for the same seed");
+	Expect(bEven, "Trees are spread evenly over the variants");
+	Expect(NumSameAsSpecies < NumTrees / NumVariants * 3 / 2, "Tree variant and species picks are independent");
+	Expect(bSeedsDiffer, "Variants of a species have different seeds");
+	Expect(GetTreeVariant(42, 1) == 0 && GetTreeVariant(42, 0) == 0, "A single variant is always picked");
+}
+
+static void TestGenerationStream() {
+	FGenerationStream Stream(1234);
+	bool bFractionInRange = true;
+	bool bRangeInclusive = true;
+	bool bHitMin = false;
+	bool bHitMax = false;
+	for (int32_t i = 0; i < 10000; i++) {
+		const float Fraction = Stream.GetFraction();
+		bFractionInRange &= Fraction >= 0.0f && Fraction < 1.0f;
+
+		const int32_t Value = Stream.RandRange(-3, 3);
+		bRangeInclusive &= Value >= -3 && Value <= 3;
+		bHitMin |= Value == -3;
+		bHitMax |= Value == 3;
+	}
+	Expect(bFractionInRange, "Stream fractions are in [0, 1)");
+	Expect(bRangeInclusive && bHitMin && bHitMax, "Stream ranges are inclusive at both ends");
+}
+
+/*
+	Determinism: generated content is hashed while the work is split across 1, 2 and N threads, like the job system splits it.
+	The hashes must agree with each other and with the goldens, so parallelisation can't silently change the world
+*/
+
+static const uint64_t GoldenTerrainHash = 0x9817567aeef4d8dbULL;
+static const uint64_t GoldenTreeHash = 0x98bdb0130fb7305dULL;
+
+struct FContentHash {
+	uint64_t Value = 14695981039346656037ULL;
+
+	void Add(const void* Data, size_t NumBytes) {
+		const unsigned char* Bytes = static_cast<const unsigned char*>(Data);
+		for (size_t i = 0; i < NumBytes; i++) {
+			Value = (Value ^ Bytes[i]) * 1099511628211ULL;
+		}
+	}
+
+	template<typename ElementType>
+	void Add(const std::vector<ElementType>& Elements) { Add(Elements.data(), Elements.size() * sizeof(ElementType)); }
+
+	// Every float is rounded to a thousandth, so a last bit difference in the maths library doesn't count as different content
+	void AddRounded(double Number) {
+		const int64_t Rounded = int64_t(std::llround(Number * 1000.0));
+		Add(&Rounded, sizeof(Rounded));
+	}
+
+	void AddRounded(const std::vector<float>& Numbers) {
+		for (float Number : Numbers) {
+			AddRounded(Number);
+		}
+	}
+};
+
+/*
+	Runs Body(Index) for every index in [0, Num) on NumThreads threads, each pulling the next index when it is free
+*/
+template<typename BodyType>
+static void ParallelFor(int32_t Num, int32_t NumThreads, const BodyType& Body) {
+	std::atomic<int32_t> NextIndex(0);
+	const auto Worker = [&]() {
+		for (int32_t Index = NextIndex++; Index < Num; Index = NextIndex++) {
+			Body(Index);
+		}
+	};
+
+	std::vector<std::thread> Threads;
+	for (int32_t i = 1; i < NumThreads; i++) {
+		Threads.emplace_back(Worker);
+	}
+	Worker();
+	for (std::thread& Thread : Threads) {
+		Thread.join();
+	}
+}
+
+struct FGeneratedChunk {
+	std::vector<float> Heights;
+	std::vector<int32_t> Triangles;
+	std::vector<float> Normals;
+	FHeightRange HeightRange;
+};
+
+/*
+	Generates a grid of chunks at every quality, with each chunk's rows split into blocks across the threads
+*/
+static uint64_t HashTerrain(int32_t NumThreads) {
+	const int32_t GridChunks = 4;
+	const int32_t RowsPerBlock = 8;
+	FContentHash Hash;
+
+	for (const FChunkQualitySize& Quality : Qualities) {
+		const int32_t BorderedSize = Quality.GridSize + 3;
+		const int32_t NumRows = Quality.GridSize + 1;
+
+		for (int32_t ChunkIndex = 0; ChunkIndex < GridChunks * GridChunks; ChunkIndex++) {
+			const double OriginX = double(ChunkIndex / GridChunks) * ChunkSize * TileSize;
+			const double OriginY = double(ChunkIndex % GridChunks) * ChunkSize * TileSize;
+
+			FGeneratedChunk Chunk;
+			Chunk.Heights.resize(size_t(BorderedSize) * BorderedSize);
+			Chunk.Triangles.resize(size_t(Quality.GridSize) * Quality.GridSize * 6);
+			Chunk.Normals.resize(size_t(NumRows) * NumRows * 3);
+
+			const int32_t NumHeightBlocks = (BorderedSize + RowsPerBlock - 1) / RowsPerBlock;
+			std::vector<FHeightRange> BlockRanges(NumHeightBlocks);
+			ParallelFor(NumHeightBlocks, NumThreads, [&](int32_t Block) {
+				BlockRanges[Block] = SampleHeightfieldRows(DefaultLayers, NumDefaultLayers, OriginX, OriginY, Quality.TileSize, BorderedSize,
+					Block * RowsPerBlock, std::min((Block + 1) * RowsPerBlock, BorderedSize), Chunk.Heights.data());
+			});
+			for (const FHeightRange& BlockRange : BlockRanges) {
+				Chunk.HeightRange.Add(BlockRange);
+			}
+
+			ParallelFor((Quality.GridSize + RowsPerBlock - 1) / RowsPerBlock, NumThreads, [&](int32_t Block) {
+				BuildGridTriangleRows(Quality.GridSize, Block * RowsPerBlock, std::min((Block + 1) * RowsPerBlock, Quality.GridSize), Chunk.Triangles.data());
+			});
+
+			ParallelFor(NumRows, NumThreads, [&](int32_t Row) {
+				for (int32_t Col = 0; Col < NumRows; Col++) {
+					const FVec3 Normal = GetHeightfieldNormal(Chunk.Heights.data(), BorderedSize, Quality.TileSize, Row, Col);
+					float* Out = &Chunk.Normals[(size_t(Row) * NumRows + Col) * 3];
+					Out[0] = float(Normal.X);
+					Out[1] = float(Normal.Y);
+					Out[2] = float(Normal.Z);
+				}
+			});
+
+			Hash.AddRounded(Chunk.Heights);
+			Hash.Add(Chunk.Triangles);
+			Hash.AddRounded(Chunk.Normals);
+			Hash.AddRounded(Chunk.HeightRange.Min);
+			Hash.AddRounded(Chunk.HeightRange.Max);
+		}
+	}
+
+	return Hash.Value;
+}
+
+/*
+	Generates the trees of a patch of placements, spread over the threads tree by tree
+*/
+static uint64_t HashTrees(int32_t NumThreads) {
+	const int32_t WorldSeed = 1337;
+	const int32_t PlacementsPerSide = 12;
+	const int32_t PlacementSpacing = TileSize * 10;
+
+	std::vector<FTreeSkeleton> Trees(size_t(PlacementsPerSide) * PlacementsPerSide);
+	std::vector<int32_t> EndSeeds(Trees.size());
+	ParallelFor(int32_t(Trees.size()), NumThreads, [&](int32_t TreeIndex) {
+		const int64_t PlacementX = int64_t(TreeIndex / PlacementsPerSide) * PlacementSpacing;
+		const int64_t PlacementY = int64_t(TreeIndex % PlacementsPerSide) * PlacementSpacing;
+		FGenerationStream Stream(GetTreeSeed(WorldSeed, PlacementX, PlacementY));
+		BuildTreeSkeleton(FTreeParams(), Stream, Trees[TreeIndex]);
+		EndSeeds[TreeIndex] = Stream.GetCurrentSeed();
+	});
+
+	FContentHash Hash;
+	Hash.Add(EndSeeds);
+	for (const FTreeSkeleton& Skeleton : Trees) {
+		for (size_t BranchIndex = 0; BranchIndex < Skeleton.Num(); BranchIndex++) {
+			const FTreeBranch Branch = Skeleton.GetBranch(BranchIndex);
+			const int32_t Ints[] = { Branch.Parent, Branch.Rows, Branch.Width, Branch.BranchHeight, Branch.bPartOfRoot, Branch.bMakeLeaves };
+			Hash.Add(Ints, sizeof(Ints));
+			Hash.AddRounded(Branch.LocalLocation.X);
+			Hash.AddRounded(Branch.LocalLocation.Y);
+			Hash.AddRounded(Branch.LocalLocation.Z);
+			Hash.AddRounded(Branch.UpVector.X);
+			Hash.AddRounded(Branch.UpVector.Y);
+			Hash.AddRounded(Branch.UpVector.Z);
+		}
+	}
+	return Hash.Value;
+}
+
+static std::vector<int32_t> GetThreadCounts() {
+	const int32_t NumHardwareThreads = int32_t(std::thread::hardware_concurrency());
+	return { 1, 2, std::max(NumHardwareThreads, 3) };
+}
+
+static void TestDeterminism() {
+	for (int32_t NumThreads : GetThreadCounts()) {
+		const uint64_t TerrainHash = HashTerrain(NumThreads);
+		const uint64_t TreeHash = HashTrees(NumThreads);
+
+		if (TerrainHash != GoldenTerrainHash) {
+			std::printf("Terrain hash on %d threads is 0x%016llx, golden 0x%016llx\n", NumThreads, (unsigned long long)TerrainHash, (unsigned long long)GoldenTerrainHash);
+		}
+		if (TreeHash != GoldenTreeHash) {
+			std::printf("Tree hash on %d threads is 0x%016llx, golden 0x%016llx\n", NumThreads, (unsigned long long)TreeHash, (unsigned long long)GoldenTreeHash);
+		}
+		Expect(TerrainHash == GoldenTerrainHash, "Terrain matches its golden hash");
+		Expect(TreeHash == GoldenTreeHash, "Trees match their golden hash");
+	}
+
+	// Seeds come from placements alone
+	Expect(GetTreeSeed(1337, 6000, -12000) == GetTreeSeed(1337, 6000, -12000), "Tree seeds are stable");
+	Expect(GetTreeSeed(1337, 6000, -12000) != GetTreeSeed(1337, -12000, 6000), "Tree seeds depend on placement order of axes");
+	Expect(GetTreeSeed(1337, 6000, -12000) != GetTreeSeed(1338, 6000, -12000), "Tree seeds depend on the world seed");
+}
+
+static int PrintHashes() {
+	for (int32_t NumThreads : GetThreadCounts()) {
+		std::printf("%2d threads: terrain 0x%016llx  trees 0x%016llx\n", NumThreads, (unsigned long long)HashTerrain(NumThreads), (unsigned long long)HashTrees(NumThreads));
+	}
+	return 0;
+}
+
+static int RunTests() {
+	TestPerlinNoise();
+	TestHeightfield();
+	TestGridTriangles();
+	TestTreeSkeleton();
+	TestTreeVariants();
+	TestGenerationStream();
+	TestDeterminism();
+
+	if (NumFailures > 0) {
+		std::printf("%d generation core tests failed\n", NumFailures);
+		return 1;
+	}
+	std::printf("All generation core tests passed\n");
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	int32_t Iterations = 20;
+	std::string Filter;
+	bool bTest = false;
+	bool bPrintHashes = false;
+
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--test") == 0) {
+			bTest = true;
+		}
+		else if (std::strcmp(argv[i], "--print-hashes") == 0) {
+			bPrintHashes = true;
+		}
+		else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+			Iterations = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+			Filter = argv[++i];
+		}
+		else {
+			std::printf("Usage: %s [--test] [--print-hashes] [--iterations N] [--filter <name>]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	if (bPrintHashes) {
+		return PrintHashes();
+	}
+	return bTest ? RunTests() : RunBenchmarks(Iterations, Filter);
+}